@@ -0,0 +1,80 @@
+#ifndef ARBITRAGE_DETECTOR_H
+#define ARBITRAGE_DETECTOR_H
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "exchange.h"
+#include "latency_histogram.h"
+#include "order_book.h"
+#include "strategy.h"
+
+// Real-time cross-exchange arbitrage detection over normalized book updates.
+// Keeps the latest top ORDERBOOK_DEPTH levels per (venue, symbol) and, on
+// every update, checks the updated venue against every other fresh venue in
+// both directions. Symbols are matched across venues without separators, so
+// OKX "BTC-USDT" and Bybit "BTCUSDT" are the same market.
+//
+// Thresholds come from exchange.h: MIN_PROFIT_PERCENTAGE (net of fees),
+// MAX_PRICE_DEVIATION (how far past the best price a trade may walk the
+// book), PRICE_UPDATE_TIMEOUT (seconds the exchange times of two quotes may be
+// apart, whichever came first) and MAX_POSITION_SIZE. RBITRAGE_STRATEGY picks
+// how many levels a trade may walk: "small" only the top, "medium" three,
+// "large" all of them.
+//
+// Exchanges deliver from their own dispatch threads, so updates are serialized
+// by a mutex; the opportunity callback runs under it.
+class ArbitrageDetector
+{
+public:
+    using OpportunityCallback = std::function<void(const ArbitrageOpportunity&)>;
+
+    ArbitrageDetector();
+
+    // Taker fee of a venue as a fraction, 0.001 unless set
+    void setTakerFee(const std::string& exchange, double fee);
+    void setOpportunityCallback(OpportunityCallback callback);
+
+    // Feed one book update from any exchange
+    void handle_orderbook_data(const CommonFormatData& data);
+
+    uint64_t getOpportunityCount() const;
+    // Time spent per update, from entry to the end of evaluation
+    const LatencyHistogram& getLatencyHistogram() const;
+
+private:
+    struct VenueQuote {
+        std::string exchange;
+        std::array<PriceLevel, ORDERBOOK_DEPTH> bids;
+        std::array<PriceLevel, ORDERBOOK_DEPTH> asks;
+        size_t bidCount = 0;
+        size_t askCount = 0;
+        int64_t timestamp = 0;
+        double fee = 0;
+    };
+
+    // All venues quoting one normalized symbol, a handful at most
+    struct Market {
+        std::string symbol;
+        std::vector<VenueQuote> venues;
+    };
+
+    double feeFor(const std::string& exchange) const;
+    // Buys on `buy`, sells on `sell`, emits if it pays
+    void evaluate(const Market& market, const VenueQuote& buy, const VenueQuote& sell, int64_t now);
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Market, StringViewHash, std::equal_to<>> markets;
+    std::unordered_map<std::string, double> takerFees;
+    size_t maxLevels;
+    OpportunityCallback opportunityCallback;
+    std::atomic<uint64_t> opportunityCount;
+    LatencyHistogram latency;
+};
+
+#endif // ARBITRAGE_DETECTOR_H
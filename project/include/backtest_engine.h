@@ -3,20 +3,13 @@
 #include <memory> 
 #include <vector> 
 #include <string> 
+#include <span>
 #include "strategy.h" 
 #include "position.h" 
 #include "data_types.h"
-struct BacktestResult{
-    double initialBalance;
-    double finalBalance;
-    double totalReturn;
-    double maxDrawdown;
-    int totalTrades; 
-    int winningTrades; 
-    int losingTrades; 
-    double winRate;
-    std::vector<double> equityCurve;
-};
+#include "bar_series.h"
+#include "performance_metrics.h"
+#include <functional>
 struct Trade
 {
     std::string symbol; 
@@ -26,8 +19,52 @@ struct Trade
     double quantity;
     std::time_t entryTime;
     std::time_t exitTime;
-    double profit; 
+    double profit;          // Net of entry and exit fees
     double profitPercent; 
+    double fees;
+    // Worst and best unrealized move while open, fractions of the entry price
+    double mae;
+    double mfe;
+};
+// Why a fill happened
+enum class FillReason {
+    ENTRY,
+    TAKE_PROFIT,
+    STOP_LOSS,
+    EXIT,         // Strategy exit signal
+    END_OF_DATA,  // Position closed at the last price
+    LIQUIDATION   // Closed on a margin call
+};
+// One executed order
+struct FillEvent
+{
+    std::string symbol;
+    OrderSide side;
+    OrderType orderType;
+    FillReason reason;
+    double price;       // Slippage included
+    double quantity;
+    double fee;
+    std::time_t timestamp;
+};
+struct BacktestResult{
+    double initialBalance;
+    double finalBalance;
+    double totalReturn;
+    double maxDrawdown;
+    int totalTrades; 
+    int winningTrades; 
+    int losingTrades; 
+    double winRate;
+    double totalFees;
+    // Stop and limit entries the price never reached
+    int cancelledOrders;
+    // Computed over every bar whether or not the curve is kept
+    PerformanceSummary metrics;
+    // Marked to market at bar closes, see BacktestEngine::setEquityCurveStep
+    std::vector<double> equityCurve;
+    std::vector<Trade> trades;
+    std::vector<FillEvent> fills;
 };
 
 class BacktestEngine
@@ -37,17 +74,61 @@ public:
 
     void setInitialCapital(double capital);
     void setCommissionRate(double rate);
+    // Adverse price move on market and stop fills as a fraction, 0.0005 = 5bp
+    void setSlippage(double fraction);
+    // Called for every fill as it happens
+    void setFillCallback(std::function<void(const FillEvent&)> callback);
+    // Per-trade logging, off for bulk runs such as parameter sweeps
+    void setVerbose(bool enabled);
+    // Keep every step-th bar of the equity curve (and the last), 1 keeps
+    // all of them, 0 none; the metrics always see every bar
+    void setEquityCurveStep(size_t step);
+    // Leading bars that only feed the strategy: their signals are dropped
+    // and the metrics and curve start at the last of them. The first bar
+    // always is one.
+    void setWarmupBars(size_t bars);
 
+    // Bars are fed to the strategy one at a time through Strategy::onBar,
+    // data is only viewed, never copied. Only the signals onBar returns for
+    // the current bar are acted on, earlier bars' signals are never replayed.
+    //
+    // Fills are event driven: each bar is walked as open -> nearer extreme
+    // -> farther extreme -> close and orders fill where that path reaches
+    // them (see FillSimulator). One position at a time, no leverage.
+    BacktestResult runBacktest(
+        std::shared_ptr<Strategy> strategy,
+        std::span<const OHLCV> data,
+        double initialCapital = 10000.0
+    );
+    // Columnar variant, the strategy reads the series columns directly
+    BacktestResult runBacktest(
+        std::shared_ptr<Strategy> strategy,
+        const BarSeriesView& data,
+        double initialCapital = 10000.0
+    );
+    // Tick-level variant: ticks (in time order) are rolled into barSeconds
+    // bars for the strategy, and fills walk the ticks themselves instead
+    // of the four point bar path. Quote ticks buy at the ask and sell at
+    // the bid, stops fill at the tick that triggers them.
     BacktestResult runBacktest(
         std::shared_ptr<Strategy> strategy,
-        const std::vector<OHLCV>& data,
+        std::span<const Tick> ticks,
+        const std::string& symbol,
+        int barSeconds,
         double initialCapital = 10000.0
     );
     std::string generateReport(const BacktestResult & result) const;
 private:
     double initialCapital = 10000.0;
     double commissionRate = 0.001;
+    double slippage = 0.0;
+    bool verbose = true;
+    size_t equityCurveStep = 1;
+    size_t warmupBars = 1;
+    std::function<void(const FillEvent&)> fillCallback;
 
-    double calculateMaxDrawDown(const std::vector<double>& equityCurve) const;
+    // Shared loop behind both runBacktest overloads
+    template <typename Bars>
+    BacktestResult runBars(std::shared_ptr<Strategy> strategy, const Bars& bars, double initialCapital);
 };
 #endif 
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef BAR_FILE_H
+#define BAR_FILE_H
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <span>
+#include <string>
+#include "bar_series.h"
+
+// On-disk layout of a bar file (native little-endian):
+//   header          BarFileHeader, 256 bytes
+//   6 columns       timestamp (int64 seconds), open, high, low, close, volume
+//                   (double), capacity slots each, every column 64-byte aligned
+//   time index      timestamp of every indexStride-th bar, for range seeks
+// Bars are stored in strictly increasing time order. barCount is written
+// after the bar data, so a reader never sees a partially appended bar.
+struct BarFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t indexStride;
+    uint64_t barCount;
+    uint64_t capacity;
+    int64_t timeframeSeconds;
+    int64_t firstTimestamp;
+    int64_t lastTimestamp;
+    uint64_t columnOffsets[6];
+    uint64_t indexOffset;
+    char symbol[64];
+    uint8_t reserved[80];
+};
+
+// Read-only, memory-mapped bar file. The columns are used in place: opening
+// is a header check and an mmap, and processes mapping the same file share
+// its pages. The view is a snapshot of the bars present at open().
+class BarFile
+{
+public:
+    BarFile() = default;
+    ~BarFile();
+    BarFile(const BarFile&) = delete;
+    BarFile& operator=(const BarFile&) = delete;
+    BarFile(BarFile&& other) noexcept;
+    BarFile& operator=(BarFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return mapping != nullptr; }
+
+    size_t size() const { return bars.size(); }
+    const std::string& symbol() const { return bars.symbolName(); }
+    std::time_t timeframeSeconds() const { return timeframe; }
+
+    // All bars, valid until close()
+    BarSeriesView series() const { return bars; }
+    // Bars with timestamp in [startTime, endTime]
+    BarSeriesView range(std::time_t startTime, std::time_t endTime) const;
+    // Index of the first bar at or after timestamp, size() if none
+    size_t lowerBound(std::time_t timestamp) const;
+
+    // Write bars (time ordered) as a new file, replacing any existing one
+    static bool write(const std::string& path, const BarSeriesView& bars, std::time_t timeframeSeconds = 0);
+
+private:
+    void moveFrom(BarFile& other);
+
+    const uint8_t* mapping = nullptr;
+    size_t mappingSize = 0;
+    BarSeriesView bars;
+    std::span<const std::time_t> index;
+    size_t indexStride = 1;
+    std::time_t timeframe = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// Appends bars to a bar file, creating it if needed. Column capacity is
+// reserved ahead and doubled when full, so appends are in-place writes.
+class BarFileAppender
+{
+public:
+    BarFileAppender() = default;
+    ~BarFileAppender();
+    BarFileAppender(const BarFileAppender&) = delete;
+    BarFileAppender& operator=(const BarFileAppender&) = delete;
+
+    bool open(const std::string& path, const std::string& symbol, std::time_t timeframeSeconds = 0);
+    // Bars must be newer than the last one in the file
+    bool append(const OHLCV& bar);
+    bool append(const BarSeriesView& bars);
+    bool flush();
+    void close();
+
+    bool isOpen() const { return file.is_open(); }
+    size_t size() const { return static_cast<size_t>(header.barCount); }
+
+private:
+    bool reserve(size_t count);
+    bool writeHeader();
+
+    std::string path;
+    std::fstream file;
+    BarFileHeader header = {};
+};
+
+#endif // BAR_FILE_H
@@ -0,0 +1,118 @@
+#ifndef BAR_SERIES_H
+#define BAR_SERIES_H
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+#include "data_types.h"
+
+// Process-wide symbol interning, bars carry a 32-bit id instead of a string
+class SymbolTable {
+public:
+    static uint32_t intern(const std::string& symbol);
+    // Reference stays valid for the lifetime of the process
+    static const std::string& name(uint32_t id);
+
+private:
+    static std::mutex mutex;
+    static std::map<std::string, uint32_t> ids;
+    static std::deque<std::string> names;
+};
+
+// Struct-of-arrays bar store for one symbol: every field lives in its own
+// contiguous column, 48 bytes per bar and no per-bar string.
+class BarSeries {
+public:
+    BarSeries() = default;
+    explicit BarSeries(const std::string& symbol);
+
+    // Adapter for fetchHistoricalData output. Bars end up in time order
+    // (exchanges such as OKX return newest first); an empty symbol keeps
+    // the one on the first bar.
+    static BarSeries fromOHLCV(const std::vector<OHLCV>& bars, const std::string& symbol = "");
+    std::vector<OHLCV> toOHLCV() const;
+
+    void reserve(size_t count);
+    void append(const OHLCV& bar);
+    void append(std::time_t timestamp, double open, double high, double low, double close, double volume);
+    void clear();
+
+    size_t size() const { return timestamps.size(); }
+    bool empty() const { return timestamps.empty(); }
+
+    uint32_t symbolId() const { return symbol; }
+    const std::string& symbolName() const { return SymbolTable::name(symbol); }
+    void setSymbol(const std::string& name) { symbol = SymbolTable::intern(name); }
+
+    // Row access, materializes one OHLCV
+    OHLCV bar(size_t index) const;
+
+    // Columns
+    const std::vector<std::time_t>& timestamp() const { return timestamps; }
+    const std::vector<double>& open() const { return opens; }
+    const std::vector<double>& high() const { return highs; }
+    const std::vector<double>& low() const { return lows; }
+    const std::vector<double>& close() const { return closes; }
+    const std::vector<double>& volume() const { return volumes; }
+
+private:
+    uint32_t symbol = 0;
+    std::vector<std::time_t> timestamps;
+    std::vector<double> opens;
+    std::vector<double> highs;
+    std::vector<double> lows;
+    std::vector<double> closes;
+    std::vector<double> volumes;
+};
+
+// Non-owning view over bars in time order, either a BarSeries or columns
+// that live elsewhere such as a memory-mapped BarFile. The viewed storage
+// must outlive the view.
+class BarSeriesView {
+public:
+    BarSeriesView() = default;
+    // Implicit so a BarSeries can be passed wherever a view is expected
+    BarSeriesView(const BarSeries& series);
+    BarSeriesView(uint32_t symbolId,
+                  std::span<const std::time_t> timestamps,
+                  std::span<const double> opens,
+                  std::span<const double> highs,
+                  std::span<const double> lows,
+                  std::span<const double> closes,
+                  std::span<const double> volumes);
+
+    size_t size() const { return timestamps.size(); }
+    bool empty() const { return timestamps.empty(); }
+
+    uint32_t symbolId() const { return symbol; }
+    const std::string& symbolName() const { return SymbolTable::name(symbol); }
+
+    // Bars [offset, offset + count), clamped to the view
+    BarSeriesView subview(size_t offset, size_t count) const;
+    // Copy into an owning series
+    BarSeries toSeries() const;
+
+    OHLCV bar(size_t index) const;
+
+    std::span<const std::time_t> timestamp() const { return timestamps; }
+    std::span<const double> open() const { return opens; }
+    std::span<const double> high() const { return highs; }
+    std::span<const double> low() const { return lows; }
+    std::span<const double> close() const { return closes; }
+    std::span<const double> volume() const { return volumes; }
+
+private:
+    uint32_t symbol = 0;
+    std::span<const std::time_t> timestamps;
+    std::span<const double> opens;
+    std::span<const double> highs;
+    std::span<const double> lows;
+    std::span<const double> closes;
+    std::span<const double> volumes;
+};
+
+#endif // BAR_SERIES_H
@@ -3,11 +3,15 @@
 
 #include "exchange.h"
 #include <string>
-#include <curl/curl.h>
+#include <string_view>
 #include <memory>
 #include <functional>
+#include <mutex>
+#include <vector>
 #include "data_types.h"
 #include "websocket_client.h"
+#include "market_data_recorder.h"
+#include "market_data_parser.h"
 // Forward declaration
 class WebSocketClient;
 
@@ -22,6 +26,8 @@ public:
                                           const std::string& timeframe,
                                           const std::string& start_time,
                                           const std::string& end_time) override;
+    bool fetchHistoricalRange(const std::string& symbol, const std::string& timeframe,
+                              std::time_t startTime, std::time_t endTime, std::vector<OHLCV>& bars) override;
     double getCurrentPrice(const std::string& symbol) override;
     
     bool placeBuyOrder(const std::string& symbol, double quantity, double price = 0) override;
@@ -37,11 +43,13 @@ public:
     void setRealTimePriceCallback(std::function<void(const std::string&, double)> callback);
     void setRealTimeCandleCallback(std::function<void(const OHLCV&)> callback);
     
+    // Record the raw WebSocket stream, call before connectWebSocket()
+    void setMarketDataRecorder(MarketDataRecorder* recorder);
+
     // WebSocket message handler
-    void handleWebSocketMessage(const std::string& message);
+    void handleWebSocketMessage(std::string_view message);
     
 private:
-    CURL* curl;
     std::string apiKey;
     std::string apiSecret;
     // Implementation of helper methods
@@ -49,9 +57,10 @@ private:
     std::string signRequest(const std::string& data) override;
     
     // Helper functions for API requests
-    static size_t WriteCallBack(void* contents, size_t size, size_t nmemb, std::string* s);
     std::string makeRequest(const std::string& url, const std::string& method = "GET", 
                           const std::string& data = "");
+    // Appends the klines of a response, false on an API error
+    bool parseCandles(const std::string& response, std::vector<OHLCV>& candles);
 
     // Get server time for timestamp
     long long getServerTime();
@@ -61,6 +70,14 @@ private:
     
     // WebSocket support
     std::unique_ptr<WebSocketClient> websocket;
+    RecorderStream* recorderStream = nullptr;
+    // Streams subscribed over the one connection
+    std::mutex subscriptionMutex;
+    std::vector<std::string> subscriptions;
+    int subscriptionRequestId = 0;
+    void sendSubscription(const std::string& method, const std::vector<std::string>& streams);
+    // Reused by the fast path, dispatch thread only
+    MarketDataMessage parsedMessage;
     std::function<void(const std::string&, double)> priceUpdateCallback;
     std::function<void(const OHLCV&)> candleUpdateCallback;
 };
@@ -0,0 +1,89 @@
+#ifndef CANDLE_CACHE_H
+#define CANDLE_CACHE_H
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "bar_series.h"
+#include "exchange.h"
+
+// Persistent candle store keyed by (exchange, symbol, timeframe). Every key
+// keeps its bars and the time ranges already downloaded; a request only goes
+// to the exchange for the parts of the range that are not on disk yet.
+// Bars are stored as a BarFile, the downloaded ranges in a text file next to it.
+// Timestamps are bar open times in seconds. Keys download concurrently,
+// calls for the same key wait for each other.
+class CandleCache
+{
+public:
+    explicit CandleCache(const std::string& directory = "candle_cache");
+
+    // Bars with open time in [startTime, endTime], in time order. Empty when a
+    // missing part of the range could not be downloaded; the parts that did
+    // come back are kept for the next call.
+    BarSeries getSeries(Exchange& exchange, const std::string& symbol, const std::string& timeframe,
+                        std::time_t startTime, std::time_t endTime);
+    std::vector<OHLCV> getCandles(Exchange& exchange, const std::string& symbol, const std::string& timeframe,
+                                  std::time_t startTime, std::time_t endTime);
+
+private:
+    // Inclusive ranges of bar open times
+    using TimeRange = std::pair<std::time_t, std::time_t>;
+
+    struct Entry
+    {
+        BarSeries bars;
+        std::vector<TimeRange> covered;
+        std::time_t timeframeSeconds = 0;
+        bool loaded = false;
+        // Held while the key loads or downloads
+        std::mutex mutex;
+    };
+
+    std::string directory;
+    std::mutex mutex;   // Guards the map only
+    std::map<std::string, Entry> entries;
+
+    std::string pathFor(const std::string& key) const;
+    Entry& entryFor(const std::string& key);
+    bool load(const std::string& key, Entry& entry);
+    bool save(const std::string& key, const Entry& entry);
+
+    static void mergeBars(Entry& entry, const std::vector<OHLCV>& fetched);
+    static void addCoverage(std::vector<TimeRange>& covered, TimeRange range, std::time_t step);
+    static std::vector<TimeRange> missingRanges(const std::vector<TimeRange>& covered, TimeRange range,
+                                                std::time_t step);
+};
+
+// Exchange decorator that serves fetchHistoricalData through a CandleCache.
+// Everything else is forwarded to the wrapped exchange.
+class CachedExchange : public Exchange
+{
+public:
+    CachedExchange(std::shared_ptr<Exchange> inner, std::shared_ptr<CandleCache> cache);
+
+    bool initialize(const std::string& api_key, const std::string& api_secret) override;
+    // start_time/end_time in milliseconds; an empty range is not cacheable and is forwarded as is
+    std::vector<OHLCV> fetchHistoricalData(const std::string& symbol,
+                                           const std::string& timeframe,
+                                           const std::string& start_time,
+                                           const std::string& end_time) override;
+    double getCurrentPrice(const std::string& symbol) override;
+    bool placeBuyOrder(const std::string& symbol, double quantity, double price = 0) override;
+    bool placeSellOrder(const std::string& symbol, double quantity, double price = 0) override;
+    std::vector<Order> getOpenOrders(const std::string& symbol) override;
+
+protected:
+    // Requests are built and signed by the wrapped exchange
+    std::string buildApiUrl(const std::string& endpoint) override { return ""; }
+    std::string signRequest(const std::string& data) override { return ""; }
+
+private:
+    std::shared_ptr<Exchange> inner;
+    std::shared_ptr<CandleCache> cache;
+};
+
+#endif // CANDLE_CACHE_H
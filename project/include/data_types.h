@@ -3,6 +3,7 @@
 #include <string> 
 #include <vector>
 #include<ctime> 
+#include <cstdint>
 struct OHLCV{
     std::time_t timestamp;
     double open; 
@@ -18,7 +19,17 @@ struct OHLCV{
 };
 enum class OrderType{
     MARKET,
-    LIMIT
+    LIMIT,
+    STOP
+};
+// One trade print (price set, bid/ask 0) or top-of-book quote (bid and ask
+// set, price 0)
+struct Tick{
+    int64_t timestamp; // Milliseconds
+    double price;
+    double size;
+    double bid;
+    double ask;
 };
 enum class OrderSide{
     BUY,
@@ -1,5 +1,8 @@
 #ifndef EXCHANGE_H
 #define EXCHANGE_H
+#include <array>
+#include <cstdint>
+#include <ctime>
 #include <string>
 #include <vector>
 #include <map>
@@ -7,12 +10,24 @@
 #include "data_types.h"
 using namespace std;
 
+#define ORDERBOOK_DEPTH 5
+
+struct PriceLevel
+{
+    double price;
+    double size;
+};
+
+// Top of an order book, held inline so an update never touches the heap.
+// Only the first bidCount/askCount levels are set, best price first.
 struct CommonFormatData
 {
     std::string exchange;
     std::string symbol;
-    std::vector<std::string> bids;
-    std::vector<std::string> asks;
+    std::array<PriceLevel, ORDERBOOK_DEPTH> bids;
+    std::array<PriceLevel, ORDERBOOK_DEPTH> asks;
+    size_t bidCount = 0;
+    size_t askCount = 0;
     int64_t timestamp; 
 };
 
@@ -32,8 +47,6 @@ struct OrderBookData
 // 'small', 'medium', 'large'
 #define RBITRAGE_STRATEGY "medium"
 
-#define ORDERBOOK_DEPTH 5
-
 // 套利参数 (基础配置，会被深度策略覆盖)
 #define MIN_PROFIT_PERCENTAGE  0.0001  
 #define MAX_POSITION_SIZE  1.0         
@@ -48,6 +61,11 @@ class Exchange
         virtual ~Exchange() = default;
         virtual bool initialize(const string& api_key, const string& api_secret)  = 0;
         virtual vector<OHLCV> fetchHistoricalData(const string& symbol, const string& timeframe, const string& start_time, const string& end_time) = 0;
+        // Bars opening in [startTime, endTime] (seconds). True only if the whole
+        // range came back, so an empty result then means there are no bars in it.
+        // The default goes through fetchHistoricalData and can only trust a
+        // non-empty answer.
+        virtual bool fetchHistoricalRange(const string& symbol, const string& timeframe, time_t startTime, time_t endTime, vector<OHLCV>& bars);
         virtual double getCurrentPrice(const string& symbol) = 0;
         virtual bool placeBuyOrder(const string& symbol, double quantity, double price = 0) = 0;
         virtual bool placeSellOrder(const string& symbol, double quantity, double price =0) = 0 ; 
@@ -61,6 +79,8 @@ class Exchange
         string api_secret;
         virtual string buildApiUrl(const string& endpoint) = 0;
         virtual string signRequest(const string& data) = 0;
+        // fetchHistoricalData bounds in milliseconds to seconds, false if one is not a number
+        static bool parseTimeRange(const string& start_time, const string& end_time, time_t& startTime, time_t& endTime);
 };
 
 
@@ -0,0 +1,150 @@
+#ifndef FILL_SIMULATOR_H
+#define FILL_SIMULATOR_H
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+#include "backtest_engine.h"
+#include "performance_metrics.h"
+#include "strategy.h"
+
+// One step of a bar's price path: what a buy and a sell trade at
+struct PathPoint
+{
+    double buy;
+    double sell;
+    std::time_t time;
+};
+
+// Open -> nearer extreme -> farther extreme -> close, the usual assumption
+// when only OHLC is known
+void ohlcPath(std::time_t time, double open, double high, double low, double close, std::vector<PathPoint>& path);
+
+// Cash, fees and risk limits shared by every position of a backtest. Each
+// FillSimulator keeps its position's value and exposure in here current, so
+// equity and limits are O(1) however many symbols trade.
+class TradingAccount
+{
+public:
+    explicit TradingAccount(double capital);
+
+    void setCommissionRate(double rate);
+    // Adverse price move on market and stop fills as a fraction
+    void setSlippage(double fraction);
+    // Gross exposure cap as a multiple of equity, 1 = no leverage
+    void setMaxLeverage(double leverage);
+    // Cap of one position's notional as a fraction of equity
+    void setMaxPositionFraction(double fraction);
+    // Equity below this fraction of gross exposure is a margin call, 0 = never
+    void setMaintenanceMargin(double fraction);
+    void setFillCallback(std::function<void(const FillEvent&)> callback);
+
+    double equity() const { return cash + positionsValue; }
+    double grossExposure() const { return exposure; }
+    double totalFees() const { return fees; }
+    bool isMarginCall() const;
+    // Largest new position at price the limits leave room for, fee included
+    double maxQuantity(double price) const;
+
+private:
+    friend class FillSimulator;
+
+    double cash;
+    double positionsValue = 0;
+    double exposure = 0;
+    double fees = 0;
+    double commissionRate = 0.001;
+    double slippage = 0.0;
+    double maxLeverage = 1.0;
+    double maxPositionFraction = 1.0;
+    double maintenanceMargin = 0.0;
+    std::function<void(const FillEvent&)> fillCallback;
+};
+
+// Orders and the position of one symbol, walked bar by bar along its price
+// path. Stops and limits rest from the start of the bar that emitted them
+// and fill at their price when the path crosses it, or at the open when the
+// bar gaps through; orders not reached within that bar are cancelled.
+// Market orders fill at the next bar's open. An entry's take-profit and
+// stop-loss are watched from the fill on, the stop first when one move
+// reaches both. One position at a time, sized by Signal::suggestedQuantity
+// (2% of equity if 0) within the account limits.
+class FillSimulator
+{
+public:
+    // Counters, trades and fills go to result; with recordHistory false only
+    // the counters are kept and fills are left to the account callback
+    FillSimulator(TradingAccount& account, BacktestResult& result, bool verbose, bool recordHistory = true);
+
+    // Orders of the signals of the bar about to be walked
+    void queue(const Signal& signal);
+    // `continuous` paths move through every price between two points (OHLC),
+    // tick paths jump from print to print
+    void walk(const std::vector<PathPoint>& path, bool continuous);
+    // Closes the position at the last price
+    void closeOut(FillReason reason = FillReason::END_OF_DATA);
+
+    // Every closed trade is added to it, nullptr to stop
+    void setMetrics(PerformanceMetrics* tradeMetrics) { metrics = tradeMetrics; }
+
+    bool hasPosition() const { return position.open; }
+    // Realized and unrealized profit of this symbol, net of fees
+    double profit() const;
+
+private:
+    struct RestingOrder
+    {
+        Signal signal;
+        bool filled;
+    };
+    struct OpenPosition
+    {
+        bool open = false;
+        std::string symbol;
+        OrderSide side = OrderSide::BUY;
+        double quantity = 0;
+        double entryPrice = 0;
+        std::time_t entryTime = 0;
+        double entryFee = 0;
+        double takeProfit = 0;
+        double stopLoss = 0;
+        // Least and most favorable price seen while open
+        double worstPrice = 0;
+        double bestPrice = 0;
+    };
+
+    double adverse(OrderSide side, double price) const;
+    // Order filled at `price` before slippage
+    void execute(const Signal& order, double price, OrderType type, std::time_t time);
+    void open(const Signal& order, double price, OrderType type, std::time_t time);
+    void close(double price, OrderType type, FillReason reason, std::time_t time);
+    void checkBracket(const PathPoint& from, const PathPoint& to, bool continuous);
+    // Books the cash and fee of a fill, returns the fee
+    double fill(OrderSide side, OrderType type, FillReason reason, double price, double quantity, std::time_t time);
+    // Widens the position's excursion to a price it could exit at
+    void trackExcursion(double price);
+    void trackExcursion(const PathPoint& point);
+    // Re-marks the position in the account at the last path point
+    void mark();
+    void markAt(double price);
+
+    TradingAccount& account;
+    BacktestResult& result;
+    PerformanceMetrics* metrics = nullptr;
+    bool verbose;
+    bool recordHistory;
+
+    OpenPosition position;
+    double realizedProfit = 0;
+    // What the position currently adds to the account
+    double markedValue = 0;
+    double markedExposure = 0;
+    std::vector<RestingOrder> restingOrders;
+    std::vector<Signal> pendingMarketOrders;
+    std::vector<Signal> nextMarketOrders;
+    // Where the path was last, carried across bars on tick paths
+    PathPoint last{0, 0, 0};
+    bool hasLast = false;
+};
+
+#endif // FILL_SIMULATOR_H
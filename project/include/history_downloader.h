@@ -0,0 +1,67 @@
+#ifndef HISTORY_DOWNLOADER_H
+#define HISTORY_DOWNLOADER_H
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "data_types.h"
+
+struct DownloadProgress
+{
+    size_t pagesDone = 0;
+    size_t pagesTotal = 0;
+    size_t bars = 0;
+};
+
+// Spaces calls evenly so at most requestsPerSecond pass per second
+class RateLimiter
+{
+public:
+    explicit RateLimiter(double requestsPerSecond);
+    // Blocks until the caller may send its request
+    void acquire();
+    // Holds back every later request, used to back off after errors
+    void pause(std::chrono::steady_clock::duration duration);
+
+private:
+    std::mutex mutex;
+    std::chrono::steady_clock::duration interval;
+    std::chrono::steady_clock::time_point nextSlot;
+};
+
+// Bulk candle download: splits [start, end] into page sized windows, keeps
+// several page requests in flight on the HttpEngine under the exchange's rate
+// limit and merges the pages into one time ordered, de-duplicated series.
+class HistoryDownloader
+{
+public:
+    // URL of the page with the candles opening in [pageStart, pageEnd] (seconds)
+    using PageUrl = std::function<std::string(std::time_t pageStart, std::time_t pageEnd)>;
+    // Appends the candles of a response body, false if the page should be retried
+    using PageParser = std::function<bool(const std::string& response, std::vector<OHLCV>& bars)>;
+    using ProgressCallback = std::function<void(const DownloadProgress&)>;
+
+    HistoryDownloader(size_t maxInFlight, double requestsPerSecond);
+
+    // Defaults to a progress line on stdout for downloads of several pages
+    void setProgressCallback(ProgressCallback callback);
+    void setMaxRetries(int retries);
+
+    // False with no bars when a page still fails after the retries, a range
+    // with a hole in it is never returned as complete
+    bool download(std::time_t startTime, std::time_t endTime, std::time_t barSeconds, size_t pageSize,
+                  const PageUrl& pageUrl, const PageParser& parsePage, std::vector<OHLCV>& bars);
+
+    // Bar length for "1m", "5m", "15m", "30m", "1h", "4h", "1d"; 0 if unknown
+    static std::time_t timeframeSeconds(const std::string& timeframe);
+
+private:
+    size_t maxInFlight;
+    double requestsPerSecond;
+    int maxRetries = 3;
+    ProgressCallback progressCallback;
+};
+
+#endif // HISTORY_DOWNLOADER_H
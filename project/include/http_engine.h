@@ -0,0 +1,75 @@
+#ifndef HTTP_ENGINE_H
+#define HTTP_ENGINE_H
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <curl/curl.h>
+
+struct HttpRequest
+{
+    std::string method = "GET";
+    std::string url;
+    std::vector<std::string> headers;
+    std::string body;
+    long timeoutMs = 30000;
+};
+
+struct HttpResponse
+{
+    long status = 0;
+    std::string body;
+    // Transport error, empty when the request reached the server
+    std::string error;
+
+    bool ok() const { return error.empty() && status >= 200 && status < 300; }
+};
+
+// Asynchronous HTTP client shared by all exchanges. One I/O thread drives a
+// curl multi handle, so any number of requests run concurrently; connections
+// are kept alive and reused per host, and DNS results and TLS sessions are
+// cached across requests.
+class HttpEngine
+{
+public:
+    using Callback = std::function<void(HttpResponse)>;
+
+    explicit HttpEngine(long maxConnectionsPerHost = 8);
+    ~HttpEngine();
+
+    HttpEngine(const HttpEngine&) = delete;
+    HttpEngine& operator=(const HttpEngine&) = delete;
+
+    // Process-wide engine
+    static HttpEngine& instance();
+
+    std::future<HttpResponse> send(HttpRequest request);
+    // The callback runs on the I/O thread and should return quickly
+    void send(HttpRequest request, Callback callback);
+    // Blocking convenience wrapper around send()
+    HttpResponse perform(HttpRequest request);
+
+private:
+    struct Transfer;
+
+    void eventLoop();
+    void startTransfer(std::unique_ptr<Transfer> transfer);
+    void finishTransfer(CURL* easy, CURLcode result);
+
+    CURLM* multi = nullptr;
+    CURLSH* share = nullptr;
+    // Easy handles of finished transfers, reset and reused
+    std::vector<CURL*> idleHandles;
+
+    std::mutex queueMutex;
+    std::deque<std::unique_ptr<Transfer>> queue;
+    std::atomic<bool> running;
+    std::thread ioThread;
+};
+
+#endif // HTTP_ENGINE_H
@@ -0,0 +1,81 @@
+#ifndef INDICATOR_CACHE_H
+#define INDICATOR_CACHE_H
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "bar_series.h"
+
+struct IndicatorCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;       // Columns computed
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+};
+
+// Derived per-bar columns keyed by (dataset, indicator, params), where the
+// dataset id is a hash of the bars' content: equal bars share their columns
+// however many series or views hold them. Each column is computed once, by
+// the first caller, while concurrent callers of the same key wait for it;
+// after that every backtest worker reads the same immutable vector.
+//
+// Least recently used columns are dropped when the cached bytes exceed the
+// memory budget. A dropped column stays alive for whoever still holds it.
+class IndicatorCache {
+public:
+    using Column = std::shared_ptr<const std::vector<double>>;
+
+    // 0 = no limit
+    explicit IndicatorCache(size_t memoryBudget = size_t(256) << 20);
+
+    // Hash of the bar columns, the symbol is not part of it
+    static uint64_t datasetId(const BarSeriesView& bars);
+
+    // The column for the key, compute() runs on a miss. An exception from it
+    // reaches every caller waiting on the key and nothing is cached.
+    Column get(uint64_t dataset, const std::string& indicator, const std::vector<double>& params,
+               const std::function<std::vector<double>()>& compute);
+
+    // Indicators::trueRange and Indicators::atrSMA over the dataset's bars, the
+    // ATR in exact order so it matches VolatilityBreakout::calculateATR
+    Column trueRange(const BarSeriesView& bars, uint64_t dataset);
+    Column atr(const BarSeriesView& bars, uint64_t dataset, int period);
+    // Indicators::trendMask and Indicators::rangeExpansionMask as 0/1 columns
+    Column trendMask(const BarSeriesView& bars, uint64_t dataset, int lookback);
+    Column rangeExpansionMask(const BarSeriesView& bars, uint64_t dataset, int window, double factor);
+
+    void setMemoryBudget(size_t bytes);
+    IndicatorCacheStats getStats() const;
+    // Drops every computed column, ones being computed are kept
+    void clear();
+
+private:
+    struct Key {
+        uint64_t dataset;
+        std::string indicator;
+        std::vector<double> params;
+        bool operator<(const Key& other) const;
+    };
+    struct Entry {
+        std::shared_future<Column> value;
+        size_t bytes = 0;          // 0 while it is being computed
+        std::list<const Key*>::iterator recent;
+    };
+
+    // Drops least recently used computed entries down to bytes
+    void evictTo(size_t bytes);
+
+    mutable std::mutex mutex;
+    std::map<Key, Entry> entries;
+    std::list<const Key*> recentlyUsed; // Most recent first
+    size_t memoryBudget;
+    IndicatorCacheStats stats;
+};
+
+#endif // INDICATOR_CACHE_H
@@ -0,0 +1,65 @@
+#ifndef INDICATORS_H
+#define INDICATORS_H
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "bar_series.h"
+
+enum class SimdLevel {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+// Indicator kernels over columnar bar data. Every kernel has a scalar version
+// and SSE2/AVX2 versions picked at runtime for the CPU. The vector kernels
+// keep the scalar order of operations, so all levels return bit-identical
+// results.
+//
+// Window sums (ATR, mean range) slide in O(n): every 256 bars restart from a
+// full newest-first sum, in between each bar adds its value and drops the
+// oldest. That can differ from a newest-first sum in the last bits, so the
+// columns VolatilityBreakout compares against (exactOrder ATR, the range
+// expansion mask) keep its newest-first sums at O(n x window).
+//
+// Outputs have one value per input bar. Bars without enough history are 0
+// (or a 0 mask entry), except the rolling max/min which use the bars available.
+class Indicators {
+public:
+    // Best level this CPU supports
+    static SimdLevel detectSimdLevel();
+    // Level used by the kernels, defaults to the detected one. Requests above
+    // what the CPU supports are clamped.
+    static SimdLevel getSimdLevel();
+    static void setSimdLevel(SimdLevel level);
+
+    // tr[i] = max(high[i], close[i-1]) - min(low[i], close[i-1]), tr[0] = high[0] - low[0]
+    static std::vector<double> trueRange(std::span<const double> high, std::span<const double> low,
+                                         std::span<const double> close);
+    static std::vector<double> trueRange(const BarSeriesView& bars);
+
+    // Simple average of the last period true ranges; valid from bar period.
+    // exactOrder sums newest first like VolatilityBreakout::calculateATR.
+    static std::vector<double> atrSMA(std::span<const double> trueRanges, int period, bool exactOrder = false);
+    // Wilder smoothing seeded with the SMA at bar period (recursive, scalar only)
+    static std::vector<double> atrWilder(std::span<const double> trueRanges, int period);
+
+    // Max/min over the last window values including the current one
+    static std::vector<double> rollingMax(std::span<const double> values, int window);
+    static std::vector<double> rollingMin(std::span<const double> values, int window);
+
+    // Mean of high - low over the last window bars including the current one
+    static std::vector<double> rollingMeanRange(std::span<const double> high, std::span<const double> low,
+                                                int window);
+
+    // 1 where the bar range exceeds factor x the mean range of the previous window bars
+    static std::vector<uint8_t> rangeExpansionMask(std::span<const double> high, std::span<const double> low,
+                                                   int window = 5, double factor = 1.2);
+
+    // 1 where the lookback bars before the current one all made higher highs and
+    // higher lows, or all made lower highs and lower lows
+    static std::vector<uint8_t> trendMask(std::span<const double> high, std::span<const double> low,
+                                          int lookback = 5);
+};
+
+#endif // INDICATORS_H
@@ -0,0 +1,43 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Log-linear latency histogram in nanoseconds: every power of two is split in
+// 8 buckets, so reported values are within 12.5% of the true latency.
+// record() is wait-free; one thread may record while others read.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(uint64_t nanoseconds);
+    void record(std::chrono::steady_clock::duration latency);
+    void reset();
+
+    uint64_t count() const;
+    uint64_t max() const;
+    double mean() const;
+    // Upper edge of the bucket holding the given percentile (0-100)
+    uint64_t percentile(double percent) const;
+
+    // "n=1200 mean=14.2us p50=12.0us p90=20.0us p99=44.0us p99.9=90.0us max=130.4us"
+    std::string summary() const;
+
+private:
+    static const int kSubBucketBits = 3;
+    static const size_t kBucketCount = 64 << kSubBucketBits;
+
+    static size_t bucketFor(uint64_t nanoseconds);
+    static uint64_t bucketUpperBound(size_t bucket);
+
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> maximum;
+};
+
+#endif // LATENCY_HISTOGRAM_H
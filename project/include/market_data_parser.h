@@ -0,0 +1,59 @@
+#ifndef MARKET_DATA_PARSER_H
+#define MARKET_DATA_PARSER_H
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// One book level as sent: the parsed numbers plus the original text, which
+// OKX checksums are computed over
+struct ParsedLevel
+{
+    double price;
+    double size;
+    std::string_view priceText;
+    std::string_view sizeText;
+};
+
+// Fields of one market data stream message. Views point into the message and
+// are only valid as long as it is. Reused across messages, the level vectors
+// keep their capacity so steady-state parsing does not allocate.
+struct MarketDataMessage
+{
+    std::string_view channel;   // OKX arg.channel, Bybit topic prefix, Binance "e"
+    std::string_view symbol;    // OKX instId, Bybit data.s or topic suffix, Binance "s"
+    std::string_view type;      // OKX action, Bybit type ("snapshot", "update", "delta")
+    int64_t timestamp = 0;      // exchange time in milliseconds
+    int64_t sequence = 0;       // OKX seqId, Bybit u
+    int64_t prevSequence = 0;   // OKX prevSeqId
+    bool hasPrevSequence = false;
+    int64_t checksum = 0;       // OKX checksum
+    bool hasChecksum = false;
+    double price = 0;           // ticker price: OKX last/markPx, Bybit lastPrice, Binance c
+    bool hasPrice = false;
+    std::vector<ParsedLevel> bids;
+    std::vector<ParsedLevel> asks;
+
+    void clear();
+};
+
+enum class ParseResult {
+    PARSED,       // message filled
+    UNSUPPORTED,  // valid but not a shape the fast path handles (events, candles, ...)
+    MALFORMED
+};
+
+// Single-pass parsers for the hot stream messages of each exchange. They walk
+// the JSON text once, keep strings as views, convert numbers with from_chars
+// and build no DOM. Anything outside the book and ticker schemas is reported
+// UNSUPPORTED so the caller can fall back to a full JSON parse.
+class MarketDataParser {
+public:
+    // {"arg":{"channel","instId"},"action"?,"data":[{...}]} with exactly one data item
+    static ParseResult parseOkx(std::string_view text, MarketDataMessage& message);
+    // {"topic":"orderbook.50.BTCUSDT"|"tickers.BTCUSDT","type","ts","data":{...}}
+    static ParseResult parseBybit(std::string_view text, MarketDataMessage& message);
+    // Raw 24hrTicker stream events {"e":"24hrTicker","E","s","c",...}
+    static ParseResult parseBinance(std::string_view text, MarketDataMessage& message);
+};
+
+#endif // MARKET_DATA_PARSER_H
@@ -0,0 +1,211 @@
+#ifndef MARKET_DATA_RECORDER_H
+#define MARKET_DATA_RECORDER_H
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "market_data_parser.h"
+
+// On-disk layout of a market data recording (native little-endian):
+//   header          RecordingFileHeader
+//   blocks          RecordingBlockHeader followed by compressedSize bytes of
+//                   zlib data, which inflate to rawSize bytes of records
+// A record is a RecordingRecordHeader and `length` payload bytes. STREAM
+// records name a stream id (payload = exchange name) and start every file,
+// FRAME records carry one WebSocket frame as received, in receive time order
+// across all streams of the file. Files are only ever appended whole blocks,
+// so a reader stops cleanly at a cut-off last block.
+struct RecordingFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    int64_t createdNs;
+};
+
+struct RecordingBlockHeader
+{
+    uint32_t magic;
+    uint32_t compressedSize;
+    uint32_t rawSize;
+    uint32_t recordCount;
+    int64_t firstReceiveNs;
+    int64_t lastReceiveNs;
+};
+
+enum class RecordKind : uint8_t {
+    STREAM = 0,
+    FRAME = 1
+};
+
+struct RecordingRecordHeader
+{
+    int64_t receiveNs;     // local wall clock, nanoseconds since the epoch
+    int64_t exchangeMs;    // exchange timestamp from the message, 0 if none
+    uint32_t length;
+    uint16_t streamId;
+    RecordKind kind;
+    uint8_t reserved;
+};
+
+// Producer side of one recorded connection. record() is called on the
+// connection's I/O thread, copies the frame into a lock-free byte ring and
+// never blocks; a full ring drops the frame and counts it.
+class RecorderStream
+{
+public:
+    RecorderStream(uint16_t id, const std::string& exchange, size_t ringBytes);
+
+    bool record(std::string_view frame);
+
+    uint16_t id() const { return streamId; }
+    const std::string& exchange() const { return exchangeName; }
+
+private:
+    friend class MarketDataRecorder;
+
+    // Writer thread: next frame into `frame`, false when the ring is empty
+    bool pop(std::string& frame, int64_t& receiveNs);
+    // Writer thread: receive time of the next frame without taking it
+    bool peek(int64_t& receiveNs);
+    void write(size_t position, const void* data, size_t length);
+    void read(size_t position, void* data, size_t length) const;
+
+    uint16_t streamId;
+    std::string exchangeName;
+    std::vector<char> ring;
+    const size_t mask;
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t cachedHead = 0;
+    alignas(64) std::atomic<size_t> head{0};
+    size_t cachedTail = 0;
+    alignas(64) std::atomic<uint64_t> recorded{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+struct RecorderStats {
+    uint64_t frames = 0;    // frames written to disk
+    uint64_t dropped = 0;   // frames lost to full rings
+    uint64_t rawBytes = 0;
+    uint64_t fileBytes = 0; // compressed bytes written, headers included
+    uint64_t files = 0;
+};
+
+// Captures raw WebSocket frames to rotating, block-compressed, append-only
+// files "<directory>/<prefix>-<UTC time>.mdr". A background thread drains
+// every stream's ring, stamps each frame with the exchange time parsed from
+// it, and writes a compressed block whenever the block is full or a flush
+// interval has passed, so nothing on the I/O thread waits for the disk.
+// Frames of all streams are merged by receive time; a frame is written once
+// it is older than a short reorder window, so a frame stamped on another I/O
+// thread but not yet in its ring cannot end up behind newer ones.
+class MarketDataRecorder
+{
+public:
+    MarketDataRecorder(const std::string& directory, const std::string& prefix = "md");
+    ~MarketDataRecorder();
+
+    MarketDataRecorder(const MarketDataRecorder&) = delete;
+    MarketDataRecorder& operator=(const MarketDataRecorder&) = delete;
+
+    // All take effect on the next start()
+    void setRingBytes(size_t bytes);
+    void setBlockBytes(size_t bytes);
+    void setMaxFileBytes(uint64_t bytes);
+
+    // One stream per connection; exchange is "OKX", "Bybit" or "Binance"
+    // for exchange timestamps, any other name records without them
+    RecorderStream* addStream(const std::string& exchange);
+
+    bool start();
+    // Writes out everything queued and closes the file
+    void stop();
+    bool isRunning() const { return running; }
+
+    RecorderStats getStats() const;
+
+private:
+    void writerLoop();
+    // Moves queued frames past the reorder window into the block in receive
+    // time order, all of them when flushing everything; true if any were found
+    bool drain(bool everything);
+    void appendRecord(RecordKind kind, uint16_t streamId, int64_t receiveNs, int64_t exchangeMs,
+                      std::string_view payload);
+    bool flushBlock();
+    bool openFile();
+    void closeFile();
+
+    std::string directory;
+    std::string prefix;
+    size_t ringBytes;
+    size_t blockBytes;
+    uint64_t maxFileBytes;
+
+    mutable std::mutex streamsMutex;
+    std::vector<std::unique_ptr<RecorderStream>> streams;
+
+    std::thread writerThread;
+    std::atomic<bool> running;
+
+    // Writer thread state
+    FILE* file;
+    uint64_t fileSize;
+    std::vector<char> block;
+    uint32_t blockRecords;
+    int64_t blockFirstNs;
+    int64_t blockLastNs;
+    std::vector<unsigned char> compressed;
+    std::vector<RecorderStream*> activeStreams;
+    std::vector<std::pair<int64_t, size_t>> streamHeap;
+    std::string frame;
+    MarketDataMessage parsed;
+
+    std::atomic<uint64_t> framesWritten;
+    std::atomic<uint64_t> rawBytesWritten;
+    std::atomic<uint64_t> fileBytesWritten;
+    std::atomic<uint64_t> filesWritten;
+};
+
+// One recorded frame as read back
+struct RecordedFrame
+{
+    int64_t receiveNs = 0;
+    int64_t exchangeMs = 0;
+    uint16_t streamId = 0;
+    std::string exchange;
+    std::string payload;
+};
+
+// Sequential reader over one recording file
+class MarketDataReader
+{
+public:
+    MarketDataReader() = default;
+    ~MarketDataReader();
+    MarketDataReader(const MarketDataReader&) = delete;
+    MarketDataReader& operator=(const MarketDataReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+    // Next frame in file order, false at the end of the file or of the
+    // last complete block
+    bool next(RecordedFrame& frame);
+
+private:
+    bool readBlock();
+
+    FILE* file = nullptr;
+    std::vector<unsigned char> compressed;
+    std::vector<char> block;
+    size_t blockPosition = 0;
+    // Exchange names by stream id
+    std::vector<std::string> streamNames;
+};
+
+#endif // MARKET_DATA_RECORDER_H
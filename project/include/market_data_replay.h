@@ -0,0 +1,81 @@
+#ifndef MARKET_DATA_REPLAY_H
+#define MARKET_DATA_REPLAY_H
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "market_data_recorder.h"
+
+enum class ReplayMode {
+    AS_FAST_AS_POSSIBLE,
+    REAL_TIME,
+    SCALED  // real time sped up by the speed factor
+};
+
+struct ReplayStats {
+    uint64_t frames = 0;     // frames delivered to a handler
+    uint64_t unrouted = 0;   // frames of exchanges without a handler
+    int64_t firstReceiveNs = 0;  // earliest and latest receive time replayed
+    int64_t lastReceiveNs = 0;
+    int64_t wallNs = 0;      // time the replay took
+};
+
+// Plays market data recordings back through the exchange message handlers,
+// e.g. OKXExchange::handleWebSocketMessage, with no network. The recorder
+// writes each file in receive time order, so every file is a source of a
+// k-way merge on the recorded receive time; ties go to the source added
+// first, so the same files always replay in the same order. Handlers run on
+// the thread calling run().
+class MarketDataReplay
+{
+public:
+    using MessageHandler = std::function<void(std::string_view)>;
+    using FrameCallback = std::function<void(const RecordedFrame&)>;
+
+    MarketDataReplay();
+    ~MarketDataReplay();
+
+    // False if the file is not a recording
+    bool addFile(const std::string& path);
+    // Every .mdr file in the directory whose name starts with prefix, in name
+    // order; the number of files added
+    size_t addDirectory(const std::string& directory, const std::string& prefix = "");
+
+    // Frames of streams recorded under this exchange name ("OKX", "Bybit", "Binance")
+    void setHandler(const std::string& exchange, MessageHandler handler);
+    // Called before the handler of every frame, for clocks and bookkeeping
+    void setFrameCallback(FrameCallback callback);
+    // speed only applies to SCALED, 10 plays ten times faster than recorded
+    void setMode(ReplayMode mode, double speed = 1.0);
+
+    // Plays every added file to the end, or until stop()
+    ReplayStats run();
+    // Safe from any thread, run() returns after the current frame
+    void stop();
+
+private:
+    struct Source {
+        MarketDataReader reader;
+        RecordedFrame frame;
+        // Handler of the current frame's exchange, looked up when it changes
+        const MessageHandler* handler = nullptr;
+        std::string handlerExchange;
+        bool handlerResolved = false;
+    };
+
+    // Loads the source's next frame, false at its end
+    bool advance(Source& source);
+
+    std::vector<std::unique_ptr<Source>> sources;
+    std::unordered_map<std::string, MessageHandler> handlers;
+    FrameCallback frameCallback;
+    ReplayMode mode;
+    double speed;
+    std::atomic<bool> stopRequested;
+};
+
+#endif // MARKET_DATA_REPLAY_H
@@ -2,11 +2,15 @@
 #define OKX_EXCHANGE_H
 #include "exchange.h"
 #include <string>
-#include <curl/curl.h>
+#include <string_view>
 #include <openssl/hmac.h>
 #include <ctime>
 #include "websocket_client.h"
+#include "market_data_recorder.h"
+#include "order_book.h"
+#include "market_data_parser.h"
 #include <map>
+#include <mutex>
 #include <vector>
 class OKXExchange : public Exchange
 {
@@ -18,6 +22,8 @@ class OKXExchange : public Exchange
                                               const std::string& timeframe,
                                               const std::string& start_time,
                                               const std::string& end_time) override;
+        bool fetchHistoricalRange(const std::string& symbol, const std::string& timeframe,
+                                  std::time_t startTime, std::time_t endTime, std::vector<OHLCV>& bars) override;
         double getCurrentPrice(const std::string& symbol) override;
         
         bool placeBuyOrder(const std::string& symbol, double quantity, double price = 0) override;
@@ -34,26 +40,34 @@ class OKXExchange : public Exchange
         void setRealTimePriceCallback(std::function<void(const std::string&, double, const std::string&)> callback);
         void setRealTimeCandleCallback(std::function<void(const OHLCV&)> callback);
         void setRealTimeOrderBookCallback(std::function<void(const CommonFormatData&)> callback);
+        // Full book after every applied "books" message, on the WebSocket dispatch thread
+        void setOrderBookUpdateCallback(std::function<void(const OrderBook&)> callback);
+
+        // Record the raw WebSocket stream, call before connectWebSocket()
+        void setMarketDataRecorder(MarketDataRecorder* recorder);
 
         // WebSocket message handler
-        void handleWebSocketMessage(const std::string& message);
+        void handleWebSocketMessage(std::string_view message);
         
         // WebSocket login for private channels (authenticated)
         bool webSocketLogin();
     private:
-    CURL* curl;
     std::string passphrase; // OKX requires a passphrase in addition to key/secret
     std::string apiKey;
     std::string apiSecret;
     // Implementation of helper methods
     std::string buildApiUrl(const std::string& endpoint) override;
     std::string signRequest(const std::string& data) override;
-    static size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* s);
     std::string makeRequest(const std::string& url, const std::string& method = "GET", 
                             const std::string& data = "", const std::string& timestamp = "");
     
+    // Appends the candles of a market data response, false on an API error
+    bool parseCandles(const std::string& response, std::vector<OHLCV>& candles);
+
     // Helper to format symbol for OKX (e.g., BTC-USDT instead of BTCUSDT)
     std::string formatSymbol(const std::string& symbol);
+    // OKX bar parameter for a timeframe, empty if unsupported
+    static std::string barInterval(const std::string& timeframe);
     
     // HMAC-SHA256 signing function
     std::string generateHMAC(const std::string& key, const std::string& data);
@@ -61,9 +75,25 @@ class OKXExchange : public Exchange
     // Get timestamp in ISO8601 format for OKX API
     std::string getTimestamp();
     std::unique_ptr<WebSocketClient> websocket;
+    RecorderStream* recorderStream = nullptr;
+    // channel/instId pairs streamed over the one connection
+    std::mutex subscriptionMutex;
+    std::vector<std::pair<std::string, std::string>> subscriptions;
+    void sendSubscription(const std::string& op, const std::vector<std::pair<std::string, std::string>>& pairs);
     std::function<void(const std::string&, double, const std::string&)> priceUpdateCallback;
     std::function<void(const OHLCV&)> candleUpdateCallback;
     std::function<void(const CommonFormatData&)> orderbookCallback;
+    std::function<void(const OrderBook&)> bookUpdateCallback;
+
+    // Dispatch thread state: the reused fast path message and the L2 books by instId
+    MarketDataMessage parsedMessage;
+    OrderBookMap books;
+    // False if the message has to go through the full JSON parse
+    bool handleParsedMessage(const MarketDataMessage& message);
+    void handleBookMessage(const MarketDataMessage& message);
+    // Drops the book and resubscribes, OKX answers with a fresh snapshot
+    void resyncOrderBook(OrderBook& book);
+    void publishOrderBook(const OrderBook& book);
 
 };
 
@@ -0,0 +1,86 @@
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "data_types.h"
+#include "market_data_parser.h"
+
+struct CommonFormatData;
+
+// One price level. The exchange's text is kept next to the parsed numbers
+// because OKX checksums are computed over the strings as sent.
+struct BookLevel
+{
+    double price;
+    double size;
+    char priceText[24];
+    char sizeText[24];
+};
+
+// Lets the per-symbol book maps be searched with a string_view
+struct StringViewHash
+{
+    using is_transparent = void;
+    size_t operator()(std::string_view text) const { return std::hash<std::string_view>{}(text); }
+};
+
+// In-memory L2 book for one (exchange, symbol), built from a snapshot and
+// kept current by deltas. Each side is a flat sorted array with the best
+// level at the back, so the top of book is O(1) and the frequent changes
+// near it move only a few levels. Not thread-safe: the exchange handler
+// owns it on its dispatch thread.
+class OrderBook
+{
+public:
+    OrderBook() = default;
+    OrderBook(const std::string& exchange, const std::string& symbol);
+
+    // Drops all levels; the book is invalid until the next snapshot
+    void clear();
+    // Set after a snapshot has been applied
+    void setValid(bool value) { valid = value; }
+    bool isValid() const { return valid; }
+
+    // Sets the size at a price, size 0 removes the level. False if either
+    // number does not parse or does not fit the level text.
+    bool update(OrderSide side, std::string_view price, std::string_view size);
+    // Same with the numbers already parsed from the text
+    bool update(OrderSide side, double price, double size, std::string_view priceText, std::string_view sizeText);
+    // The asks then the bids of a book message. False if any level failed,
+    // the book is out of sync then.
+    bool apply(const std::vector<ParsedLevel>& askLevels, const std::vector<ParsedLevel>& bidLevels);
+
+    // nullptr when the side is empty
+    const BookLevel* bestBid() const { return bids.empty() ? nullptr : &bids.back(); }
+    const BookLevel* bestAsk() const { return asks.empty() ? nullptr : &asks.back(); }
+    size_t depth(OrderSide side) const;
+    // The index-th level from the top, index < depth(side)
+    const BookLevel& level(OrderSide side, size_t index) const;
+    // Exchange, symbol, time and the top ORDERBOOK_DEPTH levels of each side
+    void copyTop(CommonFormatData& out) const;
+
+    // OKX checksum: signed CRC32 of "bidPx:bidSz:askPx:askSz:..." over the
+    // top 25 levels of each side
+    int32_t okxChecksum() const;
+
+    // Exchange sequence number of the last applied message
+    int64_t sequence = 0;
+    // Exchange time of the last applied message in milliseconds
+    int64_t timestamp = 0;
+    std::string exchange;
+    std::string symbol;
+
+private:
+    // Bids ascending and asks descending, best level last
+    std::vector<BookLevel> bids;
+    std::vector<BookLevel> asks;
+    bool valid = false;
+};
+
+using OrderBookMap = std::unordered_map<std::string, OrderBook, StringViewHash, std::equal_to<>>;
+
+#endif // ORDER_BOOK_H
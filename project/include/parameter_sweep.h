@@ -0,0 +1,70 @@
+#ifndef PARAMETER_SWEEP_H
+#define PARAMETER_SWEEP_H
+#include <functional>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include "backtest_engine.h"
+#include "indicator_cache.h"
+#include "strategy.h"
+#include "thread_pool.h"
+
+struct SweepResult
+{
+    std::map<std::string, double> parameters;
+    BacktestResult result;
+};
+
+// Runs one backtest per parameter set in parallel. Every job gets its own
+// strategy clone and engine, the market data is shared read-only. On
+// columnar data the jobs also share an IndicatorCache, so sets that only
+// differ in trade parameters compute their indicators once.
+class ParameterSweep
+{
+public:
+    // 0 threads = one per hardware thread
+    explicit ParameterSweep(size_t threadCount = 0);
+
+    void setInitialCapital(double capital);
+    void setCommissionRate(double rate);
+    // Shared with other sweeps or optimizers over the same bars, each
+    // sweep has its own otherwise
+    void setIndicatorCache(std::shared_ptr<IndicatorCache> cache);
+    std::shared_ptr<IndicatorCache> getIndicatorCache() const { return indicatorCache; }
+
+    // Cartesian product of the values given per parameter name
+    static std::vector<std::map<std::string, double>> buildGrid(
+        const std::map<std::string, std::vector<double>>& axes);
+
+    // Results ranked best first: highest total return, then lowest drawdown
+    std::vector<SweepResult> run(
+        const Strategy& prototype,
+        std::span<const OHLCV> data,
+        const std::vector<std::map<std::string, double>>& parameterSets
+    );
+    std::vector<SweepResult> run(
+        const Strategy& prototype,
+        const BarSeriesView& data,
+        const std::vector<std::map<std::string, double>>& parameterSets
+    );
+    std::string generateReport(const std::vector<SweepResult>& results, size_t maxRows = 20) const;
+
+    // The order run() returns, stable for equal results
+    static void rank(std::vector<SweepResult>& results);
+private:
+    using BacktestJob = std::function<BacktestResult(BacktestEngine&, std::shared_ptr<Strategy>, double)>;
+
+    std::vector<SweepResult> runJobs(
+        const Strategy& prototype,
+        const std::vector<std::map<std::string, double>>& parameterSets,
+        const BacktestJob& backtest
+    );
+
+    double initialCapital = 10000.0;
+    double commissionRate = 0.001;
+    std::shared_ptr<IndicatorCache> indicatorCache;
+    std::unique_ptr<ThreadPool> pool;
+};
+#endif
@@ -0,0 +1,84 @@
+#ifndef PERFORMANCE_METRICS_H
+#define PERFORMANCE_METRICS_H
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+struct Trade;
+
+// Risk and trade statistics of one run. Ratios are annualized from the bar
+// spacing; excursions are fractions of the entry price.
+struct PerformanceSummary
+{
+    double annualizedReturn = 0;
+    double volatility = 0;          // Annualized standard deviation of bar returns
+    double sharpe = 0;              // Risk-free rate 0
+    double sortino = 0;
+    double calmar = 0;              // Annualized return over max drawdown
+    double maxDrawdown = 0;         // Fraction of the peak
+    std::time_t maxDrawdownDuration = 0; // Longest time below a peak, seconds
+    double exposure = 0;            // Share of the time with a position open
+    double profitFactor = 0;        // Gross profit over gross loss, 0 without losses
+    double averageTrade = 0;
+    double averageWin = 0;
+    double averageLoss = 0;
+    double averageMAE = 0;          // Maximum adverse excursion
+    double averageMFE = 0;          // Maximum favorable excursion
+    double worstMAE = 0;
+    double bestMFE = 0;
+    uint64_t bars = 0;
+    uint64_t trades = 0;
+};
+
+// Online accumulator for PerformanceSummary: every update is O(1) and the
+// state is a few running sums, so nothing per bar has to be kept.
+class PerformanceMetrics
+{
+public:
+    PerformanceMetrics() = default;
+
+    void reset(double initialEquity);
+    // Bars per year for annualizing, 0 infers it from the bar timestamps
+    void setPeriodsPerYear(double periods);
+
+    // Equity at the end of a bar and whether a position was open during it
+    void addBar(std::time_t time, double equity, bool inMarket);
+    void addTrade(const Trade& trade);
+    // Adds the trade statistics of another accumulator, e.g. per symbol
+    void mergeTrades(const PerformanceMetrics& other);
+
+    PerformanceSummary summary() const;
+    // Report lines in the style of the backtest reports
+    static std::string format(const PerformanceSummary& summary);
+
+private:
+    double periodsPerYear = 0;
+    double initialEquity = 0;
+    double lastEquity = 0;
+    uint64_t bars = 0;
+    std::time_t firstTime = 0;
+    std::time_t lastTime = 0;
+    std::time_t timeInMarket = 0;
+
+    // Welford mean and variance of bar returns, plus the downside square sum
+    uint64_t returnCount = 0;
+    double returnMean = 0;
+    double returnM2 = 0;
+    double downsideSquares = 0;
+
+    double peakEquity = 0;
+    std::time_t peakTime = 0;
+    double maxDrawdown = 0;
+    std::time_t maxDrawdownDuration = 0;
+
+    uint64_t trades = 0;
+    uint64_t wins = 0;
+    double grossProfit = 0;
+    double grossLoss = 0;
+    double totalMAE = 0;
+    double totalMFE = 0;
+    double worstMAE = 0;
+    double bestMFE = 0;
+};
+
+#endif // PERFORMANCE_METRICS_H
@@ -0,0 +1,103 @@
+#ifndef PORTFOLIO_BACKTEST_H
+#define PORTFOLIO_BACKTEST_H
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "backtest_engine.h"
+#include "bar_series.h"
+#include "strategy.h"
+
+// What one symbol contributed. Counters and fees are its own; the result
+// reads as if the symbol had traded the portfolio's initial capital alone:
+// finalBalance, metrics, maxDrawdown and equityCurve (at
+// PortfolioResult::curveTimes) are the initial capital plus its profit.
+// Trades and fills are only kept with PortfolioBacktest::setRecordHistory(true).
+struct SymbolResult
+{
+    std::string symbol;
+    double profit = 0;          // Net of fees
+    BacktestResult result;
+};
+
+struct PortfolioResult
+{
+    double initialBalance = 0;
+    double finalBalance = 0;
+    double totalReturn = 0;
+    double maxDrawdown = 0;     // Over every timestamp, not just the curve samples
+    int totalTrades = 0;
+    int winningTrades = 0;
+    int losingTrades = 0;
+    double winRate = 0;
+    double totalFees = 0;
+    int cancelledOrders = 0;
+    int marginCalls = 0;
+    size_t maxOpenPositions = 0;
+    double maxLeverageUsed = 0; // Peak gross exposure over equity
+    PerformanceSummary metrics;
+    // Aggregate equity sampled once per curve interval
+    std::vector<std::time_t> curveTimes;
+    std::vector<double> equityCurve;
+    std::vector<SymbolResult> symbols;
+};
+
+// Runs many symbols' bar streams against one shared account. Bars of all
+// symbols are merged in time order (ties in the order symbols were added)
+// and each goes to its own strategy and FillSimulator, so positions in
+// different symbols are held concurrently within the account's leverage,
+// per-position and maintenance margin limits. A margin call closes every
+// position at its last price.
+//
+// Bars are only viewed (a memory-mapped BarFile works), and the per-bar
+// state is the open orders and positions, so memory grows with the number
+// of symbols and curve samples, not with the length of the history.
+class PortfolioBacktest
+{
+public:
+    PortfolioBacktest();
+
+    void setCommissionRate(double rate);
+    void setSlippage(double fraction);
+    // Gross exposure cap as a multiple of equity, 1 = no leverage
+    void setMaxLeverage(double leverage);
+    // Cap of one position's notional as a fraction of equity
+    void setMaxPositionFraction(double fraction);
+    // Equity below this fraction of gross exposure liquidates, 0 = never
+    void setMaintenanceMargin(double fraction);
+    // Seconds between equity curve samples, one day unless set
+    void setCurveInterval(std::time_t seconds);
+    // Keep every trade and fill per symbol, off by default
+    void setRecordHistory(bool enabled);
+    void setFillCallback(std::function<void(const FillEvent&)> callback);
+    void setVerbose(bool enabled);
+
+    // One strategy instance per symbol (e.g. prototype.clone()); the viewed
+    // bars must outlive run()
+    void addSymbol(std::shared_ptr<Strategy> strategy, const BarSeriesView& bars);
+    size_t symbolCount() const { return streams.size(); }
+
+    PortfolioResult run(double initialCapital = 10000.0);
+    std::string generateReport(const PortfolioResult& result, size_t maxSymbols = 20) const;
+
+private:
+    struct Stream
+    {
+        std::shared_ptr<Strategy> strategy;
+        BarSeriesView bars;
+    };
+
+    std::vector<Stream> streams;
+    double commissionRate = 0.001;
+    double slippage = 0.0;
+    double maxLeverage = 1.0;
+    double maxPositionFraction = 0.1;
+    double maintenanceMargin = 0.0;
+    std::time_t curveInterval = 86400;
+    bool recordHistory = false;
+    bool verbose = false;
+    std::function<void(const FillEvent&)> fillCallback;
+};
+
+#endif // PORTFOLIO_BACKTEST_H
@@ -0,0 +1,61 @@
+#ifndef SESSION_CALENDAR_H
+#define SESSION_CALENDAR_H
+#include <cstdint>
+#include <ctime>
+#include <limits>
+#include <string>
+#include <vector>
+
+// UTC offset in effect from `from` (UTC seconds) on
+struct OffsetTransition {
+    std::time_t from;
+    int32_t offset;
+};
+
+// Day bucketing and wall-clock time for one exchange time zone without the
+// C library: offsets come from a precomputed transition table, day and
+// minute-of-day are integer arithmetic on the local time. Const methods
+// touch no shared state, so one calendar can serve any number of threads,
+// and results never depend on the TZ of the machine.
+//
+// Trading days start at the session start (local wall clock, midnight by
+// default) and are named after the local date they start on.
+class SessionCalendar {
+public:
+    // UTC
+    SessionCalendar() = default;
+
+    static SessionCalendar fixedOffset(int32_t offsetSeconds);
+    // Offsets before the first transition are the first one's
+    static SessionCalendar fromTransitions(std::vector<OffsetTransition> transitions);
+
+    // IANA zone such as "America/New_York" from the TZif files under
+    // directory, extended with the file's DST rule up to 2100. Keeps the
+    // current offsets and returns false when the zone cannot be read.
+    bool loadZone(const std::string& name, const std::string& directory = "/usr/share/zoneinfo");
+
+    // Local wall-clock minute the trading day starts at, 0 = midnight
+    void setSessionStart(int minuteOfDay);
+    int getSessionStart() const { return sessionStart / 60; }
+
+    int32_t utcOffset(std::time_t time) const;
+    // Days since 1970-01-01 of the trading day containing time
+    int64_t dayIndex(std::time_t time) const;
+    // UTC time the trading day containing time started at
+    std::time_t startOfDay(std::time_t time) const;
+    // Local wall-clock minutes since midnight, 0-1439
+    int minuteOfDay(std::time_t time) const;
+    // YYYY-MM-DD of the trading day containing time
+    std::string formatDate(std::time_t time) const;
+
+    // Fingerprint of the offsets and session start, e.g. for cache keys
+    uint64_t id() const;
+
+private:
+    // Sorted, transitionTimes[0] is the lowest time_t
+    std::vector<std::time_t> transitionTimes{std::numeric_limits<std::time_t>::min()};
+    std::vector<int32_t> offsets{0};
+    int32_t sessionStart = 0;   // Seconds after local midnight
+};
+
+#endif // SESSION_CALENDAR_H
@@ -0,0 +1,124 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Capacity is rounded up to a power of two. Neither side ever blocks:
+// tryPush fails when the ring is full and tryPop when it is empty.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t minCapacity)
+        : slots(roundUp(minCapacity)), mask(slots.size() - 1) {
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer thread only
+    bool tryPush(T&& value) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - cachedHead == slots.size()) {
+            // Looks full, refresh the consumer's position before giving up
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead == slots.size()) {
+                return false;
+            }
+        }
+        slots[position & mask] = std::move(value);
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer thread only: the free slot at the tail, or nullptr when full.
+    // The slot keeps whatever the consumer left in it, so buffers inside can
+    // be refilled without reallocating. Nothing is visible to the consumer
+    // until commitPush().
+    T* producerSlot() {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - cachedHead == slots.size()) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead == slots.size()) {
+                return nullptr;
+            }
+        }
+        return &slots[position & mask];
+    }
+
+    void commitPush() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer thread only
+    bool tryPop(T& value) {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position == cachedTail) {
+                return false;
+            }
+        }
+        value = std::move(slots[position & mask]);
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only: the oldest queued slot, or nullptr when empty.
+    // It stays valid and owned by the consumer until commitPop().
+    T* consumerSlot() {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position == cachedTail) {
+                return nullptr;
+            }
+        }
+        return &slots[position & mask];
+    }
+
+    void commitPop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Runs fn on every slot, for presizing buffers. Only while neither side
+    // is running.
+    template <typename Fn>
+    void forEachSlot(Fn fn) {
+        for (T& slot : slots) {
+            fn(slot);
+        }
+    }
+
+    // Approximate when called while the other side is running
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return slots.size(); }
+
+private:
+    static size_t roundUp(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    std::vector<T> slots;
+    const size_t mask;
+
+    // Producer and consumer state on separate cache lines. Each side keeps a
+    // cached copy of the other's index and only reloads it when it looks full
+    // or empty, so the shared lines are touched as little as possible.
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t cachedHead = 0;
+    alignas(64) std::atomic<size_t> head{0};
+    size_t cachedTail = 0;
+};
+
+#endif // SPSC_RING_H
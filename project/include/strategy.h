@@ -7,7 +7,9 @@
 #include <map>
 #include "exchange.h"
 #include "data_types.h"
+#include "bar_series.h"
 using namespace std;
+class IndicatorCache;
 struct Signal{
     string symbol;
     OrderSide side;
@@ -15,20 +17,28 @@ struct Signal{
     double suggestedQuantity;
     time_t timestamp;
     string reason; 
+    // How the backtest fills it: MARKET at the next bar's open, LIMIT and
+    // STOP at suggestedPrice once the price path reaches it
+    OrderType orderType = OrderType::MARKET;
+    // Exit levels attached to an entry, 0 for none
+    double takeProfit = 0;
+    double stopLoss = 0;
+    // Only reduces an open position, never opens one
+    bool closesPosition = false;
 };
 
-class ArbitrageOpportunity
+// A cross-venue trade found by ArbitrageDetector: buy max_volume on
+// buy_exchange up to buy_price, sell it on sell_exchange down to sell_price
+struct ArbitrageOpportunity
 {
     std::string symbol;
     std::string buy_exchange;
     std::string sell_exchange;
-    float buy_price;
-    float sell_price;
-    float profit_percentage; // Profit in percentage
-    float max_volume;
+    double buy_price;
+    double sell_price;
+    double profit_percentage; // Net of fees over the whole volume, 0.001 = 0.1%
+    double max_volume;
     int64_t timestamp; // Timestamp in milliseconds
-
-    void handle_orderbook_data(const CommonFormatData& data);
 };
 
 class Strategy{
@@ -36,7 +46,23 @@ public:
     virtual ~Strategy() = default;
     virtual bool initialize(const map<string, double>& parameters) = 0;
     virtual vector<Signal> processData(const vector<OHLCV>& data) = 0;
+    // Incremental path: feed one completed bar (in time order), get the signals it triggers
+    virtual vector<Signal> onBar(const OHLCV& bar) = 0;
+    // Columnar variant: feed bar `index` of the series (a BarSeries or a mapped BarFile). The default materializes
+    // an OHLCV, strategies override it to read the columns directly.
+    virtual vector<Signal> onBar(const BarSeriesView& series, size_t index) {
+        return onBar(series.bar(index));
+    }
+    // Drop all per-run state so the next bar starts a fresh series
+    virtual void reset() = 0;
+    // Derived columns of the bars the next columnar runs feed (from index 0),
+    // which are the dataset datasetId of the cache. Strategies that use it
+    // take their indicators from there instead of rolling their own, the
+    // others ignore it. nullptr drops it. Kept across reset(), not clone().
+    virtual void setIndicatorCache(std::shared_ptr<IndicatorCache> cache, uint64_t datasetId) {}
     virtual string getName() const = 0; 
+    // Independent copy with the same parameters and a fresh series state
+    virtual std::shared_ptr<Strategy> clone() const = 0;
     void setExchange(std::shared_ptr<Exchange> exch) {
         exchange = exch;
     }
@@ -44,9 +70,14 @@ public:
     std::map<std::string, double> getParameters() const {
         return parameters;
     }
+    // Console logging of levels and signals, off for bulk runs
+    void setVerbose(bool enabled) {
+        verbose = enabled;
+    }
 protected:
     std::map<std::string, double> parameters;
     std::shared_ptr<Exchange> exchange;
+    bool verbose = true;
 };
 
 
@@ -0,0 +1,60 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a task deque: it pops its own
+// work from the back and steals from the front of the other workers' deques
+// when it runs dry, so long and short jobs even out across all cores.
+class ThreadPool {
+public:
+    // 0 threads = one per hardware thread
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a job, the future carries its result or exception
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F&& job) {
+        using ResultType = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(job));
+        std::future<ResultType> result = task->get_future();
+        enqueue([task]() { (*task)(); });
+        return result;
+    }
+
+    size_t size() const { return workers.size(); }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> nextQueue;
+    std::atomic<size_t> pendingTasks;
+
+    // Sleeping workers wait here until a task is queued or the pool stops
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    bool stopping;
+
+    void enqueue(std::function<void()> task);
+    bool popTask(size_t index, std::function<void()>& task);
+    void workerLoop(size_t index);
+};
+
+#endif // THREAD_POOL_H
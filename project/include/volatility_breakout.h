@@ -1,8 +1,12 @@
 #ifndef VOLATILITY_BREAKOUT_H
 #define VOLATILITY_BREAKOUT_H
 #include "strategy.h"
+#include "indicator_cache.h"
+#include "session_calendar.h"
 #include <map>
 #include <ctime>
+#include <deque>
+#include <vector>
 
 class VolatilityBreakout: public Strategy {
 public:
@@ -11,7 +15,16 @@ public:
     
     bool initialize(const std::map<std::string, double>& parameters) override;
     std::vector<Signal> processData(const std::vector<OHLCV>& data) override;
+    std::vector<Signal> onBar(const OHLCV& bar) override;
+    std::vector<Signal> onBar(const BarSeriesView& series, size_t index) override;
+    void reset() override;
+    // Day boundaries, previous-day high/low and the ATR come from the cache
+    void setIndicatorCache(std::shared_ptr<IndicatorCache> cache, uint64_t datasetId) override;
     std::string getName() const override {return "Larry Williams Volatility Breakout"; }
+    std::shared_ptr<Strategy> clone() const override;
+    // Days, the exit time and the trading hour filters follow this
+    // calendar's wall clock, UTC unless set
+    void setSessionCalendar(const SessionCalendar& sessionCalendar);
     
 private:
     // Strategy parameters
@@ -27,6 +40,13 @@ private:
     int exitHour;
     int exitMinute;
     
+    // Optional trading hour filters, read from the parameters on initialize
+    bool skipFirstHour;
+    bool avoidLastHalfHour;
+    bool trendFilter;
+    bool rangeFilter;
+    SessionCalendar calendar;
+    
     // Struct to track trading day info
     struct TradingDay {
         std::time_t date;
@@ -49,27 +69,22 @@ private:
         double quantity;
     };
     
+    // Shared per-bar step behind both onBar overloads
+    std::vector<Signal> processBar(std::time_t timestamp, double open, double high, double low,
+                                   double close, const std::string& barSymbol);
+    
     // Helper functions
     bool isNewDay(const OHLCV& current, const OHLCV& previous) const;
     std::time_t getStartOfDay(std::time_t timestamp) const;
     std::string formatTimestamp(std::time_t timestamp) const;
     bool isLongSignal(double price, double upperBound) const;
     bool isShortSignal(double price, double lowerBound) const;
-    bool isPastExitTime(const OHLCV& currentBar) const;
+    bool isPastExitTime(std::time_t barTime) const;
     double calculatePositionSize(double accountBalance, double riskPercent, 
                                 double entryPrice, double stopLossPrice) const;
-    double calculateATR(const std::vector<OHLCV>& data, int period) const;
-    
-    // Price action filters
-    bool isStrongTrend(const std::vector<OHLCV>& data, size_t index, int lookback) const;
-    bool isRangeExpansion(const std::vector<OHLCV>& data, size_t index) const;
-    
-    // Time filters
-    bool isValidTradingTime(const OHLCV& bar) const;
-    
-    // State tracking
-    std::map<std::time_t, TradingDay> tradingDays;
-    std::map<std::string, ActiveTrade> activeTrades;
+    double calculateATR(int period) const;
+    // Columns for the run over series, or none if they do not fit it
+    void loadIndicatorColumns(const BarSeriesView& series);
     
     // Internal tracking variables
     struct BarStats {
@@ -77,6 +92,30 @@ private:
         double low;
         std::time_t timestamp;
     };
+    
+    // Price action filters (recentBars.back() is the current bar)
+    bool isStrongTrend(const std::deque<BarStats>& recentBars, int lookback) const;
+    bool isRangeExpansion(const std::deque<BarStats>& recentBars) const;
+    
+    // Time filters
+    bool isValidTradingTime(std::time_t barTime) const;
+    
+    // State tracking
+    TradingDay currentTradingDay;
+    bool hasTradingDay;
+    std::map<std::string, ActiveTrade> activeTrades;
+    
+    // Rolling state for the streaming path, all bounded in size
+    std::string symbol;
+    size_t barCount;                 // Bars seen since the last reset
+    std::time_t currentDay;          // Start of the day the last bar belongs to
+    double currentDayHigh;
+    double currentDayLow;
+    double lastClose;
+    std::vector<double> trueRanges;  // Ring buffer of the last atrPeriod true ranges
+    size_t trueRangeHead;
+    size_t trueRangeCount;
+    std::deque<BarStats> recentBars; // Last few bars for the price action filters
     BarStats previousDayHigh;
     BarStats previousDayLow;
     std::map<std::string, double> upperBreakoutLevels;
@@ -84,6 +123,17 @@ private:
     std::map<std::string, double> profitTargets;
     std::map<std::string, double> stopLosses;
     std::map<std::string, std::time_t> positionEntryTimes;
+    
+    // Shared columns of the current run, they replace the rolling state above
+    std::shared_ptr<IndicatorCache> indicatorCache;
+    uint64_t datasetId = 0;
+    IndicatorCache::Column dayStarts;
+    IndicatorCache::Column previousDayHighs;
+    IndicatorCache::Column previousDayLows;
+    IndicatorCache::Column atrValues;
+    // 0/1 per bar, what isStrongTrend and isRangeExpansion return there
+    IndicatorCache::Column trendFlags;
+    IndicatorCache::Column rangeExpansionFlags;
 };
 
 #endif // VOLATILITY_BREAKOUT_H
\ No newline at end of file
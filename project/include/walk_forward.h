@@ -0,0 +1,107 @@
+#ifndef WALK_FORWARD_H
+#define WALK_FORWARD_H
+#include <ctime>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "backtest_engine.h"
+#include "bar_series.h"
+#include "indicator_cache.h"
+#include "parameter_sweep.h"
+#include "strategy.h"
+#include "thread_pool.h"
+
+// One step of the walk: the set that ranked best in-sample and how it did on
+// the bars right after. Bar ranges index the series given to run().
+struct WalkForwardWindow
+{
+    size_t inSampleStart = 0;
+    size_t inSampleEnd = 0;         // Also where the out-of-sample bars start
+    size_t outOfSampleEnd = 0;
+    std::time_t outOfSampleStartTime = 0;
+    std::time_t outOfSampleEndTime = 0;
+    std::map<std::string, double> parameters;
+    BacktestResult inSample;
+    BacktestResult outOfSample;
+};
+
+// The out-of-sample windows compounded into one run. Trade statistics mix
+// the windows' dollar amounts, each window trades from the initial capital.
+struct WalkForwardResult
+{
+    double initialBalance = 0;
+    double finalBalance = 0;
+    double totalReturn = 0;
+    double maxDrawdown = 0;
+    int totalTrades = 0;
+    int winningTrades = 0;
+    int losingTrades = 0;
+    double winRate = 0;
+    double totalFees = 0;
+    // Annualized out-of-sample return over the windows' mean annualized
+    // in-sample return, 0 when in-sample did not make money
+    double efficiency = 0;
+    PerformanceSummary metrics;
+    // Stitched out-of-sample equity, one point per bar
+    std::vector<std::time_t> curveTimes;
+    std::vector<double> equityCurve;
+    std::vector<WalkForwardWindow> windows;
+};
+
+// Rolling walk-forward optimization: every window ranks the parameter sets
+// on inSampleBars bars (as ParameterSweep does) and trades the best one on
+// the outOfSampleBars bars that follow, then the windows move on by
+// outOfSampleBars so the out-of-sample parts tile the history.
+//
+// The in-sample runs of all windows share one thread pool and each
+// window's out-of-sample run starts as soon as its own ranking is done.
+// All runs of a window share its indicators through an IndicatorCache, so
+// e.g. sets with the same atrPeriod compute that ATR once per window.
+class WalkForwardOptimizer
+{
+public:
+    // 0 threads = one per hardware thread
+    explicit WalkForwardOptimizer(size_t threadCount = 0);
+
+    void setInitialCapital(double capital);
+    void setCommissionRate(double rate);
+    void setSlippage(double fraction);
+    void setWindows(size_t inSampleBars, size_t outOfSampleBars);
+    // Bars before each window fed to the strategy only (see
+    // BacktestEngine::setWarmupBars), so it starts with its history built
+    void setWarmupBars(size_t bars);
+    // Shared with sweeps over the same bars, the optimizer has its own otherwise
+    void setIndicatorCache(std::shared_ptr<IndicatorCache> cache);
+
+    // The viewed bars must outlive run()
+    WalkForwardResult run(
+        const Strategy& prototype,
+        const BarSeriesView& data,
+        const std::vector<std::map<std::string, double>>& parameterSets
+    );
+    std::string generateReport(const WalkForwardResult& result, size_t maxWindows = 20) const;
+
+private:
+    // Bars [start, end) with the warm-up bars before start
+    BarSeriesView windowBars(const BarSeriesView& data, size_t start, size_t end) const;
+    BacktestResult runWindow(
+        const Strategy& prototype,
+        const BarSeriesView& bars,
+        size_t warmup,
+        uint64_t datasetId,
+        const std::map<std::string, double>& parameters,
+        bool keepCurve
+    ) const;
+
+    double initialCapital = 10000.0;
+    double commissionRate = 0.001;
+    double slippage = 0.0;
+    size_t inSampleBars = 0;
+    size_t outOfSampleBars = 0;
+    size_t warmupBars = 0;
+    std::shared_ptr<IndicatorCache> indicatorCache;
+    std::unique_ptr<ThreadPool> pool;
+};
+
+#endif // WALK_FORWARD_H
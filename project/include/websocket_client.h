@@ -2,87 +2,201 @@
 #define WEBSOCKET_CLIENT_H
 
 #include <string>
+#include <string_view>
 #include <functional>
 #include <thread>
 #include <atomic>
 #include <mutex>
-#include <queue>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <vector>
+#include <cstdint>
+#include <chrono>
 #include "data_types.h"
-#include <libwebsockets.h>
+#include "latency_histogram.h"
+#include "spsc_ring.h"
 
 // Forward declarations
 struct lws;
 struct lws_context;
-struct PerSessionData;
+class WebSocketHub;
+class RecorderStream;
 
+// What the I/O thread does when the dispatch thread falls behind
+enum class OverflowPolicy {
+    PAUSE_READS,   // stop reading the socket until the queue drains (TCP backpressure)
+    DROP_NEWEST    // keep reading and drop frames that do not fit
+};
+
+struct WebSocketStats {
+    uint64_t received = 0;    // complete frames read from the socket
+    uint64_t delivered = 0;   // frames passed to the message callback
+    uint64_t dropped = 0;     // frames lost because the queue was full
+    uint64_t readPauses = 0;  // times reads were paused for backpressure
+    size_t queued = 0;
+    size_t highWater = 0;     // most frames ever waiting in the queue
+    size_t capacity = 0;
+};
+
+// One WebSocket connection. The socket is serviced by the shared
+// WebSocketHub; received frames are handed through a lock-free ring to this
+// connection's dispatch thread, which runs all callbacks, so a slow handler
+// neither blocks the network thread nor other connections.
+//
+// Frames are reassembled straight into the ring slot that carries them and
+// slot and send buffers are reused, so once the buffers have grown to the
+// largest message seen no message costs an allocation.
 class WebSocketClient {
 public:
     // Callback types
-    using MessageCallback = std::function<void(const std::string&)>;
+    // The view is only valid during the call
+    using MessageCallback = std::function<void(std::string_view)>;
     using ConnectionCallback = std::function<void(bool)>;
     using ErrorCallback = std::function<void(const std::string&)>;
-    
-    WebSocketClient();
+
+    // Uses WebSocketHub::instance() unless another hub is given
+    explicit WebSocketClient(WebSocketHub* hub = nullptr);
     ~WebSocketClient();
-    
+
     // Initialize the WebSocket client
     bool initialize();
-    
-    // Connect to a WebSocket endpoint
+
+    // Connect to a WebSocket endpoint. Completes asynchronously, success is
+    // reported through the connection callback, failure through the error callback.
     bool connect(const std::string& url);
-    
-    // Disconnect from the server
+
+    // Close the connection and wait for it to go away. Not from a callback.
     void disconnect();
-    
+
     // Send a message to the server
-    bool send(const std::string& message);
-    
+    bool send(std::string_view message);
+
     // Check if connected
     bool isConnected() const;
-    
-    // Set callbacks
+
+    // Set callbacks, all of them run on the dispatch thread
     void setMessageCallback(MessageCallback callback);
     void setConnectionCallback(ConnectionCallback callback);
     void setErrorCallback(ErrorCallback callback);
-    
-    // Call the message callback (called by the static callback)
-    void onMessage(const std::string& message);
-    
+
+    // All take effect on the next connect()
+    void setReceiveQueueCapacity(size_t frames);
+    // Bytes reserved up front in every queue slot, larger frames grow their slot
+    void setReceiveBufferSize(size_t bytes);
+    void setOverflowPolicy(OverflowPolicy policy);
+
+    // Copies every complete frame to the recorder on the I/O thread, nullptr
+    // to stop. Set before connect().
+    void setRecorder(RecorderStream* stream);
+
+    WebSocketStats getStats() const;
+    // Time from a frame's first bytes on the I/O thread to its message callback
+    const LatencyHistogram& getLatencyHistogram() const;
+
     // Get connection status
     bool getConnectionStatus() const;
-    void setConnectionStatus(bool status);
-    static int callbackFunction(struct lws* wsi, enum lws_callback_reasons reason,
-        void* user, void* in, size_t len);
-    // Static callback for libwebsockets
-    static struct lws_protocols protocols[];
+
 private:
-    // libwebsockets context and connection
-    lws_context* context;
+    friend class WebSocketHub;
+
+    struct ReceivedFrame {
+        std::string payload;
+        std::chrono::steady_clock::time_point receivedAt;
+    };
+
+    // Connection state changes, delivered in order on the dispatch thread
+    struct ConnectionEvent {
+        bool connected;
+        std::string error;
+    };
+
+    // Service thread side, called by the hub
+    void serviceRequests(lws_context* context);
+    void openConnection(lws_context* context);
+    void onEstablished();
+    void onReceive(struct lws* wsi, const void* in, size_t len);
+    int onWriteable(struct lws* wsi);
+    void onClosed(const std::string& error);
+    void onDestroyed();
+    // Publish the frame reassembled in pendingFrame to the dispatch thread
+    void onMessage();
+    void pushEvent(ConnectionEvent event);
+
+    // Runs the callbacks for queued events and frames
+    void dispatchLoop();
+    void stopDispatch();
+
+    WebSocketHub* hub;
+    bool registered;
+
+    // Endpoint of the current connection
+    std::string host;
+    std::string path;
+    int port;
+    bool secure;
+
+    // Owned by the service thread
     lws* connection;
-    
-    // Thread for WebSocket event loop
-    std::thread eventThread;
+    bool closeReported;
+    // Queue slot the current frame is reassembled into
+    ReceivedFrame* pendingFrame;
+    // The queue was full when the current frame started, skip its fragments
+    bool droppingFrame;
+    RecorderStream* recorder;
+    // LWS_PRE padded message being written
+    std::vector<unsigned char> writeBuffer;
+
     std::atomic<bool> running;
     std::atomic<bool> connected;
-    
-    // Mutex for thread safety
-    std::mutex mutex;
-    
+
+    // Requests for the service thread
+    std::atomic<bool> connectRequested;
+    std::atomic<bool> closeRequested;
+    std::atomic<bool> writeRequested;
+    // The close timed out: cut the connection loose from this client
+    std::atomic<bool> detachRequested;
+
+    // Set once the connection is gone, disconnect() waits for it
+    std::mutex closeMutex;
+    std::condition_variable closeCondition;
+    bool closed;
+
     // Callbacks
     MessageCallback messageCallback;
     ConnectionCallback connectionCallback;
     ErrorCallback errorCallback;
-    
-    // Message queue for sending
-    std::queue<std::string> sendQueue;
+
+    // Messages waiting to be sent, a ring of LWS_PRE padded buffers that
+    // only grows when every buffer is in use
+    std::vector<std::vector<unsigned char>> sendBuffers;
+    size_t sendHead;
+    size_t sendCount;
     std::mutex sendMutex;
-    
-    // Event loop
-    void eventLoop();
-    
-    // Pointer to the session data
-    PerSessionData* sessionData;
+
+    // Receive queue, produced by the service thread and consumed by dispatchThread
+    std::unique_ptr<SpscRing<ReceivedFrame>> receiveQueue;
+    size_t receiveQueueCapacity;
+    size_t receiveBufferSize;
+    OverflowPolicy overflowPolicy;
+    std::thread dispatchThread;
+    // Bumped on every push so the dispatch thread can sleep on it when idle
+    std::atomic<uint32_t> receiveSignal;
+    // Reads paused by the I/O thread, resume requested by the dispatch thread
+    std::atomic<bool> readsPaused;
+    std::atomic<bool> resumeRequested;
+
+    // Rare, so a plain locked queue
+    std::mutex eventMutex;
+    std::deque<ConnectionEvent> events;
+    std::atomic<bool> eventsPending;
+
+    std::atomic<uint64_t> receivedCount;
+    std::atomic<uint64_t> deliveredCount;
+    std::atomic<uint64_t> droppedCount;
+    std::atomic<uint64_t> readPauseCount;
+    std::atomic<size_t> queueHighWater;
+    LatencyHistogram dispatchLatency;
 };
 
-#endif // WEBSOCKET_CLIENT_H
\ No newline at end of file
+#endif // WEBSOCKET_CLIENT_H
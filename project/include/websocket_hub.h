@@ -0,0 +1,57 @@
+#ifndef WEBSOCKET_HUB_H
+#define WEBSOCKET_HUB_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <libwebsockets.h>
+
+class WebSocketClient;
+
+// One libwebsockets context and one service thread shared by every
+// WebSocketClient in the process. lws is not thread-safe, so clients never
+// touch it directly: they flag what they need (connect, write, close, resume
+// reads) and wake the service thread, which applies the requests of every
+// registered client. No user callback runs on the service thread; frames and
+// connection events go to each client's dispatch thread.
+class WebSocketHub
+{
+public:
+    WebSocketHub();
+    ~WebSocketHub();
+
+    WebSocketHub(const WebSocketHub&) = delete;
+    WebSocketHub& operator=(const WebSocketHub&) = delete;
+
+    // Process-wide hub
+    static WebSocketHub& instance();
+
+    // False if the lws context could not be created
+    bool isRunning() const;
+
+    void addClient(WebSocketClient* client);
+    void removeClient(WebSocketClient* client);
+    size_t clientCount() const;
+
+    // Makes the service thread pick up pending client requests
+    void wake();
+
+private:
+    static int callbackFunction(struct lws* wsi, enum lws_callback_reasons reason,
+                                void* user, void* in, size_t len);
+    static struct lws_protocols protocols[];
+
+    void serviceLoop();
+    // Service thread: applies the pending requests of all clients
+    void serviceRequests();
+
+    lws_context* context;
+    std::thread serviceThread;
+    std::atomic<bool> running;
+
+    mutable std::mutex clientsMutex;
+    std::vector<WebSocketClient*> clients;
+};
+
+#endif // WEBSOCKET_HUB_H
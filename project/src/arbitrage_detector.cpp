@@ -0,0 +1,182 @@
+#include "arbitrage_detector.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    const double kDefaultTakerFee = 0.001;
+    const int64_t kQuoteTimeoutMs = PRICE_UPDATE_TIMEOUT * 1000;
+
+    size_t levelsForStrategy(const char* strategy) {
+        if (strcmp(strategy, "small") == 0) {
+            return 1;
+        }
+        if (strcmp(strategy, "large") == 0) {
+            return ORDERBOOK_DEPTH;
+        }
+        return std::min<size_t>(3, ORDERBOOK_DEPTH);
+    }
+
+    // "BTC-USDT", "btc/usdt" and "BTCUSDT" all become "BTCUSDT"
+    std::string_view normalizeSymbol(const std::string& symbol, char (&buffer)[32]) {
+        size_t length = 0;
+        for (char c : symbol) {
+            if (c == '-' || c == '/' || c == '_') {
+                continue;
+            }
+            if (length == sizeof(buffer)) {
+                break;
+            }
+            buffer[length++] = (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+        }
+        return std::string_view(buffer, length);
+    }
+}
+
+ArbitrageDetector::ArbitrageDetector()
+    : maxLevels(levelsForStrategy(RBITRAGE_STRATEGY)), opportunityCount(0) {
+}
+
+void ArbitrageDetector::setTakerFee(const std::string& exchange, double fee) {
+    std::lock_guard<std::mutex> lock(mutex);
+    takerFees[exchange] = fee;
+    for (auto& entry : markets) {
+        for (VenueQuote& venue : entry.second.venues) {
+            if (venue.exchange == exchange) {
+                venue.fee = fee;
+            }
+        }
+    }
+}
+
+void ArbitrageDetector::setOpportunityCallback(OpportunityCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    opportunityCallback = callback;
+}
+
+uint64_t ArbitrageDetector::getOpportunityCount() const {
+    return opportunityCount.load(std::memory_order_relaxed);
+}
+
+const LatencyHistogram& ArbitrageDetector::getLatencyHistogram() const {
+    return latency;
+}
+
+double ArbitrageDetector::feeFor(const std::string& exchange) const {
+    auto found = takerFees.find(exchange);
+    return found != takerFees.end() ? found->second : kDefaultTakerFee;
+}
+
+void ArbitrageDetector::handle_orderbook_data(const CommonFormatData& data) {
+    auto start = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    char buffer[32];
+    std::string_view symbol = normalizeSymbol(data.symbol, buffer);
+    auto found = markets.find(symbol);
+    if (found == markets.end()) {
+        Market market;
+        market.symbol = std::string(symbol);
+        found = markets.emplace(market.symbol, std::move(market)).first;
+    }
+    Market& market = found->second;
+
+    // Replace the venue's quote
+    auto venue = std::find_if(market.venues.begin(), market.venues.end(),
+                              [&](const VenueQuote& quote) { return quote.exchange == data.exchange; });
+    if (venue == market.venues.end()) {
+        VenueQuote quote;
+        quote.exchange = data.exchange;
+        quote.fee = feeFor(data.exchange);
+        market.venues.push_back(quote);
+        venue = market.venues.end() - 1;
+    }
+    venue->bids = data.bids;
+    venue->asks = data.asks;
+    venue->bidCount = data.bidCount;
+    venue->askCount = data.askCount;
+    venue->timestamp = data.timestamp;
+
+    // Exchange times are the clock, so replays detect the same way. A late
+    // update can be the older quote of the pair, so the gap counts both ways
+    // and the newer time stamps the opportunity.
+    for (const VenueQuote& other : market.venues) {
+        if (&other == &*venue || std::abs(venue->timestamp - other.timestamp) > kQuoteTimeoutMs) {
+            continue;
+        }
+        int64_t now = std::max(venue->timestamp, other.timestamp);
+        evaluate(market, *venue, other, now);
+        evaluate(market, other, *venue, now);
+    }
+    latency.record(std::chrono::steady_clock::now() - start);
+}
+
+void ArbitrageDetector::evaluate(const Market& market, const VenueQuote& buy, const VenueQuote& sell,
+                                 int64_t now) {
+    size_t askLevels = std::min(buy.askCount, maxLevels);
+    size_t bidLevels = std::min(sell.bidCount, maxLevels);
+    if (askLevels == 0 || bidLevels == 0) {
+        return;
+    }
+
+    double bestAsk = buy.asks[0].price;
+    double bestBid = sell.bids[0].price;
+    if (bestBid <= bestAsk) {
+        return;
+    }
+    // Levels further than MAX_PRICE_DEVIATION from the best price are not taken
+    double askCap = bestAsk * (1 + MAX_PRICE_DEVIATION);
+    double bidFloor = bestBid * (1 - MAX_PRICE_DEVIATION);
+
+    // Walk both books while the next unit still pays after fees
+    size_t askIndex = 0;
+    size_t bidIndex = 0;
+    double askLeft = buy.asks[0].size;
+    double bidLeft = sell.bids[0].size;
+    double volume = 0;
+    double cost = 0;
+    double proceeds = 0;
+    double buyLimit = bestAsk;
+    double sellLimit = bestBid;
+    while (askIndex < askLevels && bidIndex < bidLevels && volume < MAX_POSITION_SIZE
+           && buy.asks[askIndex].price <= askCap && sell.bids[bidIndex].price >= bidFloor) {
+        double paid = buy.asks[askIndex].price * (1 + buy.fee);
+        double received = sell.bids[bidIndex].price * (1 - sell.fee);
+        if ((received - paid) / paid < MIN_PROFIT_PERCENTAGE) {
+            break;
+        }
+        double quantity = std::min({askLeft, bidLeft, MAX_POSITION_SIZE - volume});
+        volume += quantity;
+        cost += quantity * paid;
+        proceeds += quantity * received;
+        buyLimit = buy.asks[askIndex].price;
+        sellLimit = sell.bids[bidIndex].price;
+
+        askLeft -= quantity;
+        bidLeft -= quantity;
+        if (askLeft <= 0 && ++askIndex < askLevels) {
+            askLeft = buy.asks[askIndex].size;
+        }
+        if (bidLeft <= 0 && ++bidIndex < bidLevels) {
+            bidLeft = sell.bids[bidIndex].size;
+        }
+    }
+    if (volume <= 0) {
+        return;
+    }
+
+    opportunityCount.fetch_add(1, std::memory_order_relaxed);
+    if (opportunityCallback) {
+        ArbitrageOpportunity opportunity;
+        opportunity.symbol = market.symbol;
+        opportunity.buy_exchange = buy.exchange;
+        opportunity.sell_exchange = sell.exchange;
+        opportunity.buy_price = buyLimit;
+        opportunity.sell_price = sellLimit;
+        opportunity.profit_percentage = (proceeds - cost) / cost;
+        opportunity.max_volume = volume;
+        opportunity.timestamp = now;
+        opportunityCallback(opportunity);
+    }
+}
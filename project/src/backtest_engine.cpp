@@ -1,4 +1,5 @@
 #include "backtest_engine.h"
+#include "fill_simulator.h"
 #include <iostream>
 #include <algorithm>
 #include <numeric> 
@@ -6,6 +7,91 @@
 #include <sstream> 
 #include <iomanip> 
 
+namespace {
+// Bar sources for the shared backtest loop. `continuous` paths move through
+// every price between two points, tick paths jump from print to print.
+struct OHLCVBars
+{
+    static constexpr bool continuous = true;
+    std::span<const OHLCV> data;
+    size_t size() const { return data.size(); }
+    std::vector<Signal> feed(Strategy& strategy, size_t i) const { return strategy.onBar(data[i]); }
+    void path(size_t i, std::vector<PathPoint>& out) const
+    {
+        const OHLCV& bar = data[i];
+        ohlcPath(bar.timestamp, bar.open, bar.high, bar.low, bar.close, out);
+    }
+};
+struct SeriesBars
+{
+    static constexpr bool continuous = true;
+    BarSeriesView data;
+    size_t size() const { return data.size(); }
+    std::vector<Signal> feed(Strategy& strategy, size_t i) const { return strategy.onBar(data, i); }
+    void path(size_t i, std::vector<PathPoint>& out) const
+    {
+        ohlcPath(data.timestamp()[i], data.open()[i], data.high()[i], data.low()[i], data.close()[i], out);
+    }
+};
+struct TickBars
+{
+    static constexpr bool continuous = false;
+    std::span<const Tick> ticks;
+    std::vector<OHLCV> bars;
+    // First tick of every bar, then ticks.size()
+    std::vector<size_t> starts;
+
+    TickBars(std::span<const Tick> data, const std::string& symbol, int barSeconds) : ticks(data)
+    {
+        const int64_t barMs = std::max(barSeconds, 1) * int64_t(1000);
+        int64_t currentBucket = 0;
+        for (size_t i = 0; i < ticks.size(); i++)
+        {
+            const Tick& tick = ticks[i];
+            double price = tickPrice(tick);
+            int64_t bucket = tick.timestamp / barMs;
+            if (bars.empty() || bucket != currentBucket)
+            {
+                currentBucket = bucket;
+                starts.push_back(i);
+                bars.push_back(OHLCV{static_cast<std::time_t>(bucket * barMs / 1000),
+                                     price, price, price, price, 0.0, symbol});
+            }
+            OHLCV& bar = bars.back();
+            bar.high = std::max(bar.high, price);
+            bar.low = std::min(bar.low, price);
+            bar.close = price;
+            bar.volume += tick.size;
+        }
+        starts.push_back(ticks.size());
+    }
+    // Trades at their price, quotes at the mid
+    static double tickPrice(const Tick& tick)
+    {
+        return tick.price > 0 ? tick.price : (tick.bid + tick.ask) / 2;
+    }
+    size_t size() const { return bars.size(); }
+    std::vector<Signal> feed(Strategy& strategy, size_t i) const { return strategy.onBar(bars[i]); }
+    void path(size_t i, std::vector<PathPoint>& out) const
+    {
+        out.clear();
+        for (size_t t = starts[i]; t < starts[i + 1]; t++)
+        {
+            const Tick& tick = ticks[t];
+            std::time_t time = static_cast<std::time_t>(tick.timestamp / 1000);
+            if (tick.price > 0)
+            {
+                out.push_back({tick.price, tick.price, time});
+            }
+            else
+            {
+                out.push_back({tick.ask, tick.bid, time});
+            }
+        }
+    }
+};
+}
+
 BacktestEngine::BacktestEngine() = default;
 
 void BacktestEngine::setInitialCapital(double capital)
@@ -16,125 +102,125 @@ void BacktestEngine::setCommissionRate(double rate)
 {
     commissionRate = rate;
 }
+void BacktestEngine::setSlippage(double fraction)
+{
+    slippage = fraction;
+}
+void BacktestEngine::setFillCallback(std::function<void(const FillEvent&)> callback)
+{
+    fillCallback = std::move(callback);
+}
+void BacktestEngine::setVerbose(bool enabled)
+{
+    verbose = enabled;
+}
+void BacktestEngine::setEquityCurveStep(size_t step)
+{
+    equityCurveStep = step;
+}
+void BacktestEngine::setWarmupBars(size_t bars)
+{
+    warmupBars = std::max<size_t>(bars, 1);
+}
+BacktestResult BacktestEngine::runBacktest(
+    std::shared_ptr<Strategy> strategy,
+    std::span<const OHLCV> data,
+    double initialCapital
+)
+{
+    return runBars(strategy, OHLCVBars{data}, initialCapital);
+}
+BacktestResult BacktestEngine::runBacktest(
+    std::shared_ptr<Strategy> strategy,
+    const BarSeriesView& data,
+    double initialCapital
+)
+{
+    return runBars(strategy, SeriesBars{data}, initialCapital);
+}
 BacktestResult BacktestEngine::runBacktest(
     std::shared_ptr<Strategy> strategy,
-    const std::vector<OHLCV>& data,
+    std::span<const Tick> ticks,
+    const std::string& symbol,
+    int barSeconds,
+    double initialCapital
+)
+{
+    return runBars(strategy, TickBars(ticks, symbol, barSeconds), initialCapital);
+}
+template <typename Bars>
+BacktestResult BacktestEngine::runBars(
+    std::shared_ptr<Strategy> strategy,
+    const Bars& bars,
     double initialCapital
 )
 {
     this->initialCapital = initialCapital;
     BacktestResult result;
+    result.initialBalance = initialCapital;
     result.totalTrades = 0;
     result.winningTrades = 0;
     result.losingTrades = 0;
+    result.totalFees = 0;
+    result.cancelledOrders = 0;
 
-    result.equityCurve.push_back(initialCapital);
-    double currentBalance = initialCapital;
-    std::vector<Trade> activeTrades;
-    for (size_t i = 1; i < data.size(); ++i)
+    if (equityCurveStep > 0)
     {
-        const OHLCV& current = data[i];
-        result.equityCurve.push_back(currentBalance);
-        std::vector<Signal> signals;
-        std::vector<OHLCV> historicalData(data.begin(), data.begin() + i + 1);
-        signals = strategy->processData(historicalData);
-        for (const auto& signal: signals)
-        {
-            if(activeTrades.empty())
-            {
-                double positionSize = currentBalance * 0.02/current.close;
-                Trade trade; 
-                trade.symbol = signal.symbol;
-                trade.side = signal.side; 
-                trade.entryPrice = current.close;
-                trade.entryTime = current.timestamp;
-                trade.quantity = positionSize;
-                double commission = trade.entryPrice * trade.quantity * commissionRate;
-                currentBalance -= commission;
-                activeTrades.push_back(trade);
-                result.totalTrades++;
-                std::cout << "Opening trade at " << trade.entryPrice << ", Quantity: " << trade.quantity << std::endl;
-            }
-        }
-        //simple exit strategy: close after 5 bars 
-        if(!activeTrades.empty() && i - activeTrades[0].entryTime > 5)
-        {
-            Trade& trade = activeTrades[0];
-            trade.exitPrice = current.close;
-            trade.exitTime = current.timestamp;
-            //Calculate profit 
-            double profit = (trade.side == OrderSide::BUY) 
-            ? (trade.exitPrice - trade.entryPrice) * trade.quantity 
-            : (trade.entryPrice - trade.exitPrice) * trade.quantity;
-            //Apply commision 
-            double commission = trade.exitPrice * trade.quantity * commissionRate; 
-            profit -= commission;
-
-            trade.profit = profit; 
-            trade.profitPercent = (profit / (trade.entryPrice * trade.quantity)) * 100.0;
-
-            currentBalance += (trade.exitPrice * trade.quantity)  + profit; 
-            if (trade.profit > 0) 
-            {
-                result.winningTrades++; 
-            }
-            else
-            {
-                result.losingTrades++;
-            }
-            std::cout << "Closing trade at " << trade.exitPrice <<" , Profit: " << trade.profit <<" (" << trade.profitPercent << std::endl;
-            activeTrades.clear();
-        }
+        result.equityCurve.push_back(initialCapital);
     }
-    if(!activeTrades.empty())
+    TradingAccount account(initialCapital);
+    account.setCommissionRate(commissionRate);
+    account.setSlippage(slippage);
+    account.setFillCallback(fillCallback);
+    PerformanceMetrics metrics;
+    metrics.reset(initialCapital);
+    FillSimulator simulator(account, result, verbose);
+    simulator.setMetrics(&metrics);
+    std::vector<PathPoint> path;
+    // Start the strategy from a clean series, the warm-up bars only seed its state
+    strategy->reset();
+    const size_t warmup = std::min(warmupBars, bars.size());
+    for (size_t i = 0; i < warmup; ++i)
     {
-        Trade& trade = activeTrades[0]; 
-        trade.exitPrice = data.back().close;
-        trade.exitTime = data.back().timestamp;
-        double profit = (trade.side == OrderSide::BUY) 
-        ? (trade.exitPrice - trade.entryPrice) * trade.quantity 
-        : (trade.entryPrice - trade.exitPrice) * trade.quantity; 
-        // Apply commission 
-        double commission = trade.exitPrice * trade.quantity * commissionRate;
-        profit -= commission; 
-
-        trade.profit = profit;
-        trade.profitPercent = (profit / (trade.entryPrice * trade.quantity)) * 100.0;
-
-        //update 
-        currentBalance += (trade.exitPrice * trade.quantity) + profit;
-        // Track win/loss 
-        if(profit > 0)
+        bars.feed(*strategy, i);
+        bars.path(i, path);
+        simulator.walk(path, Bars::continuous);
+    }
+    if (warmup > 0)
+    {
+        metrics.addBar(path.back().time, initialCapital, false);
+    }
+    for (size_t i = warmup; i < bars.size(); ++i)
+    {
+        // Signals of this bar rest from its start, market orders wait for the next one
+        for (const auto& signal : bars.feed(*strategy, i))
         {
-            result.winningTrades++;
+            simulator.queue(signal);
         }
-        else
+        bool hadPosition = simulator.hasPosition();
+        int tradesBefore = result.totalTrades;
+        bars.path(i, path);
+        simulator.walk(path, Bars::continuous);
+        bool lastBar = i + 1 == bars.size();
+        if (lastBar)
         {
-            result.losingTrades++;
+            simulator.closeOut();
         }
-        std::cout << "Closing final trade at " << trade.exitPrice << ", Profit: "
-        << profit << " (" << trade.profitPercent << "%)" << std::endl;
-        activeTrades.clear();
-    }
-    result.finalBalance = currentBalance;
-    result.totalReturn = ((currentBalance - initialCapital) / initialCapital) * 100.0;
-    result.maxDrawdown = calculateMaxDrawDown(result.equityCurve);
-    result.winRate = (result.totalTrades > 0) ? static_cast<double>(result.winningTrades) / result.totalTrades : 0.0;
-    return result;
-}
-double BacktestEngine::calculateMaxDrawDown(const std::vector<double>& equityCurve) const{
-    double maxDrawdown = 0.0;
-    double peak = equityCurve[0];
-    for(const double& equity: equityCurve)
-    {
-        if(equity > peak)
+        bool inMarket = hadPosition || simulator.hasPosition() || result.totalTrades != tradesBefore;
+        metrics.addBar(path.back().time, account.equity(), inMarket);
+        if (equityCurveStep > 0 && (i % equityCurveStep == 0 || lastBar))
         {
-            peak = equity;
+            result.equityCurve.push_back(account.equity());
         }
-        double drawdown = (peak - equity) / peak;
-        maxDrawdown = std::max(maxDrawdown, drawdown);
     }
-    return maxDrawdown;
+    simulator.closeOut();
+    double finalBalance = account.equity();
+    result.finalBalance = finalBalance;
+    result.totalReturn = ((finalBalance - initialCapital) / initialCapital) * 100.0;
+    result.metrics = metrics.summary();
+    result.maxDrawdown = result.metrics.maxDrawdown;
+    result.winRate = (result.totalTrades > 0) ? static_cast<double>(result.winningTrades) / result.totalTrades : 0.0;
+    return result;
 }
 std::string BacktestEngine::generateReport(const BacktestResult& result) const
 {
@@ -147,9 +233,12 @@ std::string BacktestEngine::generateReport(const BacktestResult& result) const
     ss << "Total Trades: " << result.totalTrades << "\n";
     ss << "Winning Trades: " << result.winningTrades << "\n";
     ss << "Losing Trades: " << result.losingTrades << "\n";
-    ss << "Win Rate: " << std::fixed << std::setprecision(2) << (result.winRate * 100.0) << "%\n\n";
+    ss << "Win Rate: " << std::fixed << std::setprecision(2) << (result.winRate * 100.0) << "%\n";
+    ss << "Fees Paid: $" << std::fixed << std::setprecision(2) << result.totalFees << "\n";
+    ss << "Cancelled Orders: " << result.cancelledOrders << "\n\n";
     
     ss << "Max Drawdown: " << std::fixed << std::setprecision(2) << (result.maxDrawdown * 100.0) << "%\n";
+    ss << PerformanceMetrics::format(result.metrics);
     
     return ss.str();
 }
\ No newline at end of file
@@ -0,0 +1,442 @@
+#include "bar_file.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char kMagic[4] = {'L', 'W', 'B', 'F'};
+    const uint32_t kVersion = 1;
+    const uint32_t kIndexStride = 1024;
+    const uint64_t kAlignment = 64;
+    const size_t kColumnCount = 6;
+    const size_t kMinCapacity = 4096;
+
+    static_assert(sizeof(BarFileHeader) == 256, "bar file header must stay 256 bytes");
+    static_assert(sizeof(std::time_t) == sizeof(int64_t), "timestamps are stored as int64");
+
+    uint64_t alignUp(uint64_t value) {
+        return (value + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    uint64_t indexEntries(uint64_t count, uint32_t stride) {
+        return (count + stride - 1) / stride;
+    }
+
+    // Column and index offsets for a given capacity, returns the file size
+    uint64_t layout(BarFileHeader& header, uint64_t capacity) {
+        header.capacity = capacity;
+        uint64_t offset = alignUp(sizeof(BarFileHeader));
+        for (size_t c = 0; c < kColumnCount; c++) {
+            header.columnOffsets[c] = offset;
+            offset = alignUp(offset + capacity * sizeof(double));
+        }
+        header.indexOffset = offset;
+        return offset + indexEntries(capacity, header.indexStride) * sizeof(int64_t);
+    }
+
+    BarFileHeader makeHeader(const std::string& symbol, std::time_t timeframeSeconds) {
+        BarFileHeader header = {};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.headerSize = sizeof(BarFileHeader);
+        header.indexStride = kIndexStride;
+        header.timeframeSeconds = timeframeSeconds;
+        std::strncpy(header.symbol, symbol.c_str(), sizeof(header.symbol) - 1);
+        return header;
+    }
+
+    bool validHeader(const BarFileHeader& header, size_t fileSize) {
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+            header.headerSize != sizeof(BarFileHeader) || header.indexStride == 0 ||
+            header.barCount > header.capacity) {
+            return false;
+        }
+        for (size_t c = 0; c < kColumnCount; c++) {
+            if (header.columnOffsets[c] % sizeof(double) != 0 ||
+                header.columnOffsets[c] + header.capacity * sizeof(double) > fileSize) {
+                return false;
+            }
+        }
+        return header.indexOffset % sizeof(int64_t) == 0 &&
+               header.indexOffset + indexEntries(header.capacity, header.indexStride) * sizeof(int64_t) <= fileSize;
+    }
+
+    // Price and volume columns of a view by file column number
+    std::span<const double> valueColumn(const BarSeriesView& bars, size_t column) {
+        switch (column) {
+            case 1: return bars.open();
+            case 2: return bars.high();
+            case 3: return bars.low();
+            case 4: return bars.close();
+            default: return bars.volume();
+        }
+    }
+}
+
+BarFile::~BarFile() {
+    close();
+}
+
+BarFile::BarFile(BarFile&& other) noexcept {
+    moveFrom(other);
+}
+
+BarFile& BarFile::operator=(BarFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        moveFrom(other);
+    }
+    return *this;
+}
+
+void BarFile::moveFrom(BarFile& other) {
+    mapping = other.mapping;
+    mappingSize = other.mappingSize;
+    bars = other.bars;
+    index = other.index;
+    indexStride = other.indexStride;
+    timeframe = other.timeframe;
+#ifdef _WIN32
+    fileHandle = other.fileHandle;
+    mappingHandle = other.mappingHandle;
+    other.fileHandle = nullptr;
+    other.mappingHandle = nullptr;
+#endif
+    other.mapping = nullptr;
+    other.mappingSize = 0;
+    other.bars = BarSeriesView();
+    other.index = {};
+}
+
+bool BarFile::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open bar file: " << path << std::endl;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(BarFileHeader))) {
+        std::cerr << "Invalid bar file: " << path << std::endl;
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = fileMapping ? MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        std::cerr << "Failed to map bar file: " << path << std::endl;
+        if (fileMapping) {
+            CloseHandle(fileMapping);
+        }
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = fileMapping;
+    mapping = static_cast<const uint8_t*>(view);
+    mappingSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open bar file: " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(BarFileHeader))) {
+        std::cerr << "Invalid bar file: " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file referenced
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        std::cerr << "Failed to map bar file: " << path << std::endl;
+        return false;
+    }
+    mapping = static_cast<const uint8_t*>(view);
+    mappingSize = static_cast<size_t>(info.st_size);
+#endif
+
+    BarFileHeader header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (!validHeader(header, mappingSize)) {
+        std::cerr << "Invalid bar file: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    size_t count = static_cast<size_t>(header.barCount);
+    auto column = [this, count, &header](size_t c) {
+        return std::span<const double>(reinterpret_cast<const double*>(mapping + header.columnOffsets[c]), count);
+    };
+    std::string symbolName(header.symbol, strnlen(header.symbol, sizeof(header.symbol)));
+    bars = BarSeriesView(SymbolTable::intern(symbolName),
+                         std::span<const std::time_t>(
+                             reinterpret_cast<const std::time_t*>(mapping + header.columnOffsets[0]), count),
+                         column(1), column(2), column(3), column(4), column(5));
+    index = std::span<const std::time_t>(reinterpret_cast<const std::time_t*>(mapping + header.indexOffset),
+                                         static_cast<size_t>(indexEntries(count, header.indexStride)));
+    indexStride = header.indexStride;
+    timeframe = static_cast<std::time_t>(header.timeframeSeconds);
+    return true;
+}
+
+void BarFile::close() {
+    if (mapping) {
+#ifdef _WIN32
+        UnmapViewOfFile(mapping);
+        CloseHandle(static_cast<HANDLE>(mappingHandle));
+        CloseHandle(static_cast<HANDLE>(fileHandle));
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+#else
+        munmap(const_cast<uint8_t*>(mapping), mappingSize);
+#endif
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    bars = BarSeriesView();
+    index = {};
+    timeframe = 0;
+}
+
+size_t BarFile::lowerBound(std::time_t timestamp) const {
+    // The index narrows the search to one stride of the timestamp column,
+    // so only a few pages of a large file are touched
+    auto entry = std::lower_bound(index.begin(), index.end(), timestamp);
+    size_t block = static_cast<size_t>(entry - index.begin());
+    size_t first = block == 0 ? 0 : (block - 1) * indexStride;
+    size_t last = std::min(block * indexStride, bars.size());
+    auto timestamps = bars.timestamp();
+    return static_cast<size_t>(
+        std::lower_bound(timestamps.begin() + first, timestamps.begin() + last, timestamp) - timestamps.begin());
+}
+
+BarSeriesView BarFile::range(std::time_t startTime, std::time_t endTime) const {
+    if (startTime > endTime) {
+        return bars.subview(0, 0);
+    }
+    size_t first = lowerBound(startTime);
+    size_t last = endTime == std::numeric_limits<std::time_t>::max() ? bars.size() : lowerBound(endTime + 1);
+    return bars.subview(first, last - first);
+}
+
+bool BarFile::write(const std::string& path, const BarSeriesView& bars, std::time_t timeframeSeconds) {
+    // Write next to the target and rename, readers keep their old mapping
+    std::string tempPath = path + ".tmp";
+    {
+        BarFileAppender appender;
+        std::error_code error;
+        std::filesystem::remove(tempPath, error);
+        if (!appender.open(tempPath, bars.symbolName(), timeframeSeconds) || !appender.append(bars) ||
+            !appender.flush()) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::cerr << "Failed to replace bar file " << path << ": " << error.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+BarFileAppender::~BarFileAppender() {
+    close();
+}
+
+bool BarFileAppender::open(const std::string& path, const std::string& symbol, std::time_t timeframeSeconds) {
+    close();
+    this->path = path;
+
+    file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (file.is_open()) {
+        file.seekg(0, std::ios::end);
+        size_t fileSize = static_cast<size_t>(file.tellg());
+        file.seekg(0);
+        if (fileSize < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            !validHeader(header, fileSize)) {
+            std::cerr << "Invalid bar file: " << path << std::endl;
+            file.close();
+            return false;
+        }
+        if (symbol != header.symbol) {
+            std::cerr << "Bar file " << path << " holds " << header.symbol << ", not " << symbol << std::endl;
+            file.close();
+            return false;
+        }
+        return true;
+    }
+
+    // New file, header only, columns are allocated by the first append
+    file.clear();
+    file.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to create bar file: " << path << std::endl;
+        return false;
+    }
+    header = makeHeader(symbol, timeframeSeconds);
+    layout(header, 0);
+    return writeHeader();
+}
+
+bool BarFileAppender::append(const OHLCV& bar) {
+    BarSeries single;
+    single.append(bar);
+    return append(BarSeriesView(single));
+}
+
+bool BarFileAppender::append(const BarSeriesView& bars) {
+    if (!file.is_open()) {
+        return false;
+    }
+    if (bars.empty()) {
+        return true;
+    }
+
+    auto timestamps = bars.timestamp();
+    for (size_t i = 0; i < bars.size(); i++) {
+        bool ordered = i == 0 ? (header.barCount == 0 || timestamps[0] > header.lastTimestamp)
+                              : timestamps[i] > timestamps[i - 1];
+        if (!ordered) {
+            std::cerr << "Bar file " << path << ": bars must be appended in increasing time order" << std::endl;
+            return false;
+        }
+    }
+    if (!reserve(static_cast<size_t>(header.barCount) + bars.size())) {
+        return false;
+    }
+
+    // One contiguous write per column
+    uint64_t count = header.barCount;
+    file.seekp(static_cast<std::streamoff>(header.columnOffsets[0] + count * sizeof(int64_t)));
+    file.write(reinterpret_cast<const char*>(timestamps.data()), static_cast<std::streamsize>(timestamps.size_bytes()));
+    for (size_t c = 1; c < kColumnCount; c++) {
+        std::span<const double> values = valueColumn(bars, c);
+        file.seekp(static_cast<std::streamoff>(header.columnOffsets[c] + count * sizeof(double)));
+        file.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size_bytes()));
+    }
+    for (uint64_t i = indexEntries(count, header.indexStride) * header.indexStride; i < count + bars.size();
+         i += header.indexStride) {
+        int64_t timestamp = timestamps[static_cast<size_t>(i - count)];
+        file.seekp(static_cast<std::streamoff>(header.indexOffset + (i / header.indexStride) * sizeof(int64_t)));
+        file.write(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
+    }
+    if (!file) {
+        std::cerr << "Failed to append to bar file: " << path << std::endl;
+        return false;
+    }
+
+    if (header.barCount == 0) {
+        header.firstTimestamp = timestamps.front();
+    }
+    header.lastTimestamp = timestamps.back();
+    header.barCount += bars.size();
+    return writeHeader();
+}
+
+bool BarFileAppender::reserve(size_t count) {
+    if (count <= header.capacity) {
+        return true;
+    }
+
+    // Growing moves every column. Build the new layout in a separate file and
+    // rename it over the old one, so readers that mapped the old file keep a
+    // consistent snapshot.
+    uint64_t capacity = std::max<uint64_t>(header.capacity * 2, kMinCapacity);
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    BarFileHeader grown = header;
+    uint64_t fileSize = layout(grown, capacity);
+
+    std::vector<std::vector<char>> columns(kColumnCount);
+    for (size_t c = 0; c < kColumnCount; c++) {
+        columns[c].resize(static_cast<size_t>(header.barCount * sizeof(double)));
+        file.seekg(static_cast<std::streamoff>(header.columnOffsets[c]));
+        file.read(columns[c].data(), static_cast<std::streamsize>(columns[c].size()));
+    }
+    std::vector<char> indexData(static_cast<size_t>(indexEntries(header.barCount, header.indexStride) * sizeof(int64_t)));
+    file.seekg(static_cast<std::streamoff>(header.indexOffset));
+    file.read(indexData.data(), static_cast<std::streamsize>(indexData.size()));
+    if (!file) {
+        std::cerr << "Failed to read bar file: " << path << std::endl;
+        return false;
+    }
+
+    std::string tempPath = path + ".grow";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&grown), sizeof(grown));
+        for (size_t c = 0; c < kColumnCount; c++) {
+            out.seekp(static_cast<std::streamoff>(grown.columnOffsets[c]));
+            out.write(columns[c].data(), static_cast<std::streamsize>(columns[c].size()));
+        }
+        out.seekp(static_cast<std::streamoff>(grown.indexOffset));
+        out.write(indexData.data(), static_cast<std::streamsize>(indexData.size()));
+        if (!out) {
+            std::cerr << "Failed to grow bar file: " << path << std::endl;
+            return false;
+        }
+    }
+
+    file.close();
+    std::error_code error;
+    std::filesystem::resize_file(tempPath, fileSize, error);
+    if (!error) {
+        std::filesystem::rename(tempPath, path, error);
+    }
+    if (error) {
+        std::cerr << "Failed to grow bar file " << path << ": " << error.message() << std::endl;
+        return false;
+    }
+    file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to reopen bar file: " << path << std::endl;
+        return false;
+    }
+    header = grown;
+    return true;
+}
+
+bool BarFileAppender::writeHeader() {
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!file) {
+        std::cerr << "Failed to write bar file header: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool BarFileAppender::flush() {
+    if (!file.is_open()) {
+        return false;
+    }
+    file.flush();
+    return static_cast<bool>(file);
+}
+
+void BarFileAppender::close() {
+    if (file.is_open()) {
+        file.flush();
+        file.close();
+    }
+}
@@ -0,0 +1,165 @@
+#include "bar_series.h"
+#include <algorithm>
+#include <numeric>
+
+// Initialize static members, id 0 is the empty symbol
+std::mutex SymbolTable::mutex;
+std::map<std::string, uint32_t> SymbolTable::ids = {{"", 0}};
+std::deque<std::string> SymbolTable::names = {""};
+
+uint32_t SymbolTable::intern(const std::string& symbol) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = ids.find(symbol);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>(names.size());
+    names.push_back(symbol);
+    ids[symbol] = id;
+    return id;
+}
+
+const std::string& SymbolTable::name(uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (id >= names.size()) {
+        return names[0];
+    }
+    return names[id];
+}
+
+BarSeries::BarSeries(const std::string& symbolName)
+    : symbol(SymbolTable::intern(symbolName)) {
+}
+
+BarSeries BarSeries::fromOHLCV(const std::vector<OHLCV>& bars, const std::string& symbolName) {
+    BarSeries series;
+    if (!symbolName.empty()) {
+        series.setSymbol(symbolName);
+    } else if (!bars.empty()) {
+        series.setSymbol(bars[0].symbol);
+    }
+
+    // Index sort so the bars themselves are never copied
+    std::vector<size_t> order(bars.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&bars](size_t a, size_t b) {
+        return bars[a].timestamp < bars[b].timestamp;
+    });
+
+    series.reserve(bars.size());
+    for (size_t index : order) {
+        series.append(bars[index]);
+    }
+    return series;
+}
+
+std::vector<OHLCV> BarSeries::toOHLCV() const {
+    std::vector<OHLCV> bars;
+    bars.reserve(size());
+    for (size_t i = 0; i < size(); i++) {
+        bars.push_back(bar(i));
+    }
+    return bars;
+}
+
+void BarSeries::reserve(size_t count) {
+    timestamps.reserve(count);
+    opens.reserve(count);
+    highs.reserve(count);
+    lows.reserve(count);
+    closes.reserve(count);
+    volumes.reserve(count);
+}
+
+void BarSeries::append(const OHLCV& bar) {
+    append(bar.timestamp, bar.open, bar.high, bar.low, bar.close, bar.volume);
+}
+
+void BarSeries::append(std::time_t timestamp, double open, double high, double low, double close, double volume) {
+    timestamps.push_back(timestamp);
+    opens.push_back(open);
+    highs.push_back(high);
+    lows.push_back(low);
+    closes.push_back(close);
+    volumes.push_back(volume);
+}
+
+void BarSeries::clear() {
+    timestamps.clear();
+    opens.clear();
+    highs.clear();
+    lows.clear();
+    closes.clear();
+    volumes.clear();
+}
+
+OHLCV BarSeries::bar(size_t index) const {
+    OHLCV result;
+    result.timestamp = timestamps[index];
+    result.open = opens[index];
+    result.high = highs[index];
+    result.low = lows[index];
+    result.close = closes[index];
+    result.volume = volumes[index];
+    result.symbol = symbolName();
+    return result;
+}
+
+BarSeriesView::BarSeriesView(const BarSeries& series)
+    : symbol(series.symbolId()),
+      timestamps(series.timestamp()),
+      opens(series.open()),
+      highs(series.high()),
+      lows(series.low()),
+      closes(series.close()),
+      volumes(series.volume()) {
+}
+
+BarSeriesView::BarSeriesView(uint32_t symbolId,
+                             std::span<const std::time_t> timestamps,
+                             std::span<const double> opens,
+                             std::span<const double> highs,
+                             std::span<const double> lows,
+                             std::span<const double> closes,
+                             std::span<const double> volumes)
+    : symbol(symbolId),
+      timestamps(timestamps),
+      opens(opens),
+      highs(highs),
+      lows(lows),
+      closes(closes),
+      volumes(volumes) {
+}
+
+BarSeriesView BarSeriesView::subview(size_t offset, size_t count) const {
+    offset = std::min(offset, size());
+    count = std::min(count, size() - offset);
+    return BarSeriesView(symbol,
+                         timestamps.subspan(offset, count),
+                         opens.subspan(offset, count),
+                         highs.subspan(offset, count),
+                         lows.subspan(offset, count),
+                         closes.subspan(offset, count),
+                         volumes.subspan(offset, count));
+}
+
+BarSeries BarSeriesView::toSeries() const {
+    BarSeries series(symbolName());
+    series.reserve(size());
+    for (size_t i = 0; i < size(); i++) {
+        series.append(timestamps[i], opens[i], highs[i], lows[i], closes[i], volumes[i]);
+    }
+    return series;
+}
+
+OHLCV BarSeriesView::bar(size_t index) const {
+    OHLCV result;
+    result.timestamp = timestamps[index];
+    result.open = opens[index];
+    result.high = highs[index];
+    result.low = lows[index];
+    result.close = closes[index];
+    result.volume = volumes[index];
+    result.symbol = symbolName();
+    return result;
+}
@@ -9,9 +9,11 @@
 #include <nlohmann/json.hpp>
 #include <algorithm>
 #include "env_loader.h"
+#include "history_downloader.h"
+#include "http_engine.h"
 using json =  nlohmann::json;
 
-BinanceExchange::BinanceExchange() : curl(nullptr), websocket(nullptr)
+BinanceExchange::BinanceExchange() : websocket(nullptr)
 {
     apiKey = EnvLoader::get("BINANCE_API_KEY");
     apiSecret = EnvLoader::get("BINANCE_API_SECRET");
@@ -20,48 +22,13 @@ BinanceExchange::BinanceExchange() : curl(nullptr), websocket(nullptr)
     }
     name = "Binance";
     connected = false;
-
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl = curl_easy_init(); 
-    if(!curl)
-    {
-        std::cerr << "Failed to initialize CURL" << std::endl;
-    }
 }
 BinanceExchange::~BinanceExchange()
 {
     disconnectWebSocket();
-    if(curl)
-    {
-        curl_easy_cleanup(curl);
-    }
-    curl_global_cleanup();
 }
 // Implement or update WebSocket methods
 bool BinanceExchange::connectWebSocket(const std::string& symbol, const std::string& channel) {
-    // Create WebSocket client if needed
-    if (!websocket) {
-        websocket = std::make_unique<WebSocketClient>();
-        
-        if (!websocket->initialize()) {
-            std::cerr << "Failed to initialize WebSocket client" << std::endl;
-            return false;
-        }
-        
-        // Set callbacks
-        websocket->setMessageCallback([this](const std::string& msg) {
-            handleWebSocketMessage(msg);
-        });
-        
-        websocket->setConnectionCallback([this](bool connected) {
-            std::cout << "Binance WebSocket " << (connected ? "connected" : "disconnected") << std::endl;
-        });
-        
-        websocket->setErrorCallback([](const std::string& error) {
-            std::cerr << "Binance WebSocket error: " << error << std::endl;
-        });
-    }
-    
     // Convert symbol to lowercase (Binance requirement)
     std::string lowercaseSymbol = symbol;
     std::transform(lowercaseSymbol.begin(), lowercaseSymbol.end(), lowercaseSymbol.begin(), ::tolower);
@@ -70,31 +37,123 @@ bool BinanceExchange::connectWebSocket(const std::string& symbol, const std::str
     lowercaseSymbol.erase(std::remove(lowercaseSymbol.begin(), lowercaseSymbol.end(), '/'), lowercaseSymbol.end());
     lowercaseSymbol.erase(std::remove(lowercaseSymbol.begin(), lowercaseSymbol.end(), '-'), lowercaseSymbol.end());
     
-    // Build WebSocket URL based on the channel
-    std::string wsUrl;
+    // Build the stream name based on the channel
+    std::string stream;
     
     if (channel == "ticker") {
-        wsUrl = "wss://stream.binance.com:9443/ws/" + lowercaseSymbol + "@ticker";
+        stream = lowercaseSymbol + "@ticker";
     } else if (channel == "trade") {
-        wsUrl = "wss://stream.binance.com:9443/ws/" + lowercaseSymbol + "@trade";
+        stream = lowercaseSymbol + "@trade";
     } else if (channel.find("kline_") == 0) {
         std::string interval = channel.substr(6); // Extract interval part
-        wsUrl = "wss://stream.binance.com:9443/ws/" + lowercaseSymbol + "@kline_" + interval;
+        stream = lowercaseSymbol + "@kline_" + interval;
     } else {
         std::cerr << "Unsupported channel: " << channel << std::endl;
         return false;
     }
+
+    // Every stream shares one connection
+    {
+        std::lock_guard<std::mutex> lock(subscriptionMutex);
+        if (std::find(subscriptions.begin(), subscriptions.end(), stream) != subscriptions.end()) {
+            return true;
+        }
+        subscriptions.push_back(stream);
+    }
+
+    // Already open: add the stream to the live connection, or it is
+    // subscribed with the others once the connection is up
+    if (websocket) {
+        if (websocket->isConnected()) {
+            sendSubscription("SUBSCRIBE", {stream});
+        }
+        return true;
+    }
+
+    websocket = std::make_unique<WebSocketClient>();
+    websocket->setRecorder(recorderStream);
+
+    if (!websocket->initialize()) {
+        std::cerr << "Failed to initialize WebSocket client" << std::endl;
+        websocket.reset();
+        return false;
+    }
+
+    // Set callbacks
+    websocket->setMessageCallback([this](std::string_view msg) {
+        handleWebSocketMessage(msg);
+    });
+
+    websocket->setConnectionCallback([this](bool connected) {
+        std::cout << "Binance WebSocket " << (connected ? "connected" : "disconnected") << std::endl;
+
+        // Subscribe to all streams after connection is established
+        if (connected) {
+            std::vector<std::string> pending;
+            {
+                std::lock_guard<std::mutex> lock(subscriptionMutex);
+                pending = subscriptions;
+            }
+            sendSubscription("SUBSCRIBE", pending);
+        }
+    });
+
+    websocket->setErrorCallback([](const std::string& error) {
+        std::cerr << "Binance WebSocket error: " << error << std::endl;
+    });
+
+    // Raw stream endpoint, streams are added with SUBSCRIBE requests
+    std::string wsUrl = "wss://stream.binance.com:9443/ws";
     
     std::cout << "Connecting to Binance WebSocket URL: " << wsUrl << std::endl;
     
     // Connect to WebSocket
-    return websocket->connect(wsUrl);
+    if (!websocket->connect(wsUrl)) {
+        websocket.reset();
+        return false;
+    }
+    return true;
+}
+
+void BinanceExchange::sendSubscription(const std::string& method, const std::vector<std::string>& streams) {
+    // Binance allows 1024 streams per connection but only 5 requests per
+    // second, so subscribe in large batches
+    const size_t batchSize = 200;
+    for (size_t first = 0; first < streams.size(); first += batchSize) {
+        json message = {
+            {"method", method},
+            {"params", json::array()},
+            {"id", ++subscriptionRequestId}
+        };
+        size_t last = std::min(first + batchSize, streams.size());
+        for (size_t i = first; i < last; i++) {
+            message["params"].push_back(streams[i]);
+        }
+        websocket->send(message.dump());
+    }
 }
 
 void BinanceExchange::disconnectWebSocket() {
     if (websocket) {
+        // Send unsubscribe message if connected
+        if (websocket->isConnected()) {
+            std::vector<std::string> active;
+            {
+                std::lock_guard<std::mutex> lock(subscriptionMutex);
+                active = subscriptions;
+            }
+            sendSubscription("UNSUBSCRIBE", active);
+        }
+
         websocket->disconnect();
+        websocket.reset();
     }
+    std::lock_guard<std::mutex> lock(subscriptionMutex);
+    subscriptions.clear();
+}
+
+void BinanceExchange::setMarketDataRecorder(MarketDataRecorder* recorder) {
+    recorderStream = recorder ? recorder->addStream(name) : nullptr;
 }
 
 bool BinanceExchange::isWebSocketConnected() const {
@@ -108,7 +167,15 @@ void BinanceExchange::setRealTimeCandleCallback(std::function<void(const OHLCV&)
     candleUpdateCallback = callback;
 }
 
-void BinanceExchange::handleWebSocketMessage(const std::string& message) {
+void BinanceExchange::handleWebSocketMessage(std::string_view message) {
+    // Tickers take the fast path, everything else the full parse
+    if (MarketDataParser::parseBinance(message, parsedMessage) == ParseResult::PARSED) {
+        if (priceUpdateCallback) {
+            priceUpdateCallback(std::string(parsedMessage.symbol), parsedMessage.price);
+        }
+        return;
+    }
+
     try {
         json data = json::parse(message);
         
@@ -166,25 +233,82 @@ std::vector<OHLCV> BinanceExchange::fetchHistoricalData(
 )
 {
     std::vector<OHLCV> result;
-    std::stringstream ss;
-    ss << "/api/v3/klines?symbol=" << symbol << "&interval=" << timeframe;
-    if(!start_time.empty())
+    // Without a range, return the latest page
+    if(start_time.empty() || end_time.empty())
+    {
+        std::stringstream ss;
+        ss << "/api/v3/klines?symbol=" << symbol << "&interval=" << timeframe;
+        if(!start_time.empty())
+        {
+            ss << "&startTime=" << start_time;
+        }
+        if(!end_time.empty())
+        {
+            ss << "&endTime=" << end_time;
+        }
+        ss << "&limit=1000";
+        parseCandles(makeRequest(buildApiUrl(ss.str())), result);
+        return result;
+    }
+
+    std::time_t startTime = 0;
+    std::time_t endTime = 0;
+    if(parseTimeRange(start_time, end_time, startTime, endTime))
     {
-        ss << "&startTime=" << start_time;
+        fetchHistoricalRange(symbol, timeframe, startTime, endTime, result);
     }
-    if(!end_time.empty())
+    return result;
+}
+
+bool BinanceExchange::fetchHistoricalRange(
+    const std::string& symbol,
+    const std::string& timeframe,
+    std::time_t startTime,
+    std::time_t endTime,
+    std::vector<OHLCV>& bars
+)
+{
+    bars.clear();
+    std::time_t barSeconds = HistoryDownloader::timeframeSeconds(timeframe);
+    if(barSeconds == 0)
     {
-        ss << "&endTime=" << end_time;
+        std::cerr << "Unsupported timeframe: " << timeframe << std::endl;
+        return false;
     }
-    ss << "&limit=1000";
-    std::string url = buildApiUrl(ss.str());
-    std::string response = makeRequest(url);
+
+    // 1000 bars per request, startTime/endTime are inclusive. The klines
+    // weight allows far more, 10 requests per second leaves room for trading.
+    auto pageUrl = [this, symbol, timeframe](std::time_t pageStart, std::time_t pageEnd)
+    {
+        std::stringstream ss;
+        ss << "/api/v3/klines?symbol=" << symbol << "&interval=" << timeframe;
+        ss << "&startTime=" << static_cast<long long>(pageStart) * 1000;
+        ss << "&endTime=" << static_cast<long long>(pageEnd) * 1000;
+        ss << "&limit=1000";
+        return buildApiUrl(ss.str());
+    };
+
+    auto parsePage = [this](const std::string& response, std::vector<OHLCV>& pageBars)
+    {
+        return parseCandles(response, pageBars);
+    };
+
+    HistoryDownloader downloader(4, 10.0);
+    return downloader.download(startTime, endTime, barSeconds, 1000, pageUrl, parsePage, bars);
+}
+bool BinanceExchange::parseCandles(const std::string& response, std::vector<OHLCV>& candles)
+{
     if(response.empty())
     {
-        return result;
+        return false;
     }
     try{
         json responseJson = json::parse(response);
+        if(!responseJson.is_array())
+        {
+            std::cerr << "Error in Binance API response: " << response << std::endl;
+            return false;
+        }
         for (const auto& item: responseJson)
         {
             if(item.size() < 6)
@@ -192,20 +316,21 @@ std::vector<OHLCV> BinanceExchange::fetchHistoricalData(
                 continue;
             }
             OHLCV candle;
-            candle.timestamp = item[0].get<long long>();
+            candle.timestamp = item[0].get<long long>() / 1000; // ms -> s
             candle.open = std::stod(item[1].get<std::string>());
             candle.high = std::stod(item[2].get<std::string>());
             candle.low = std::stod(item[3].get<std::string>());
             candle.close = std::stod(item[4].get<std::string>());
             candle.volume = std::stod(item[5].get<std::string>());
-            result.push_back(candle);
+            candles.push_back(candle);
         }
+        return true;
     }
     catch(const std::exception& e)
     {
         std::cerr << "Error parsing response: " << e.what() << std::endl;
     }
-    return result;
+    return false;
 }
 double BinanceExchange::getCurrentPrice(const std::string& symbol)
 {
@@ -369,50 +494,25 @@ std::string BinanceExchange::signRequest(const std::string& data) {
     
     return ss.str();
 }
-size_t BinanceExchange::WriteCallBack(void* contents, size_t size, size_t nmemb, std::string* s) {
-    size_t newLength = size * nmemb;
-    try {
-        s->append((char*)contents, newLength);
-        return newLength;
-    } catch (const std::bad_alloc& e) {
-        // Handle memory problem
-        return 0;
-    }
-}
 std::string BinanceExchange::makeRequest(const std::string& url, const std::string& method, const std::string& data)
 {
-    if (!curl) {
-        std::cerr << "CURL not initialized" << std::endl;
-        return "";
-    }
-    std::string responseString;
-    curl_easy_reset(curl);
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallBack);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
-    struct curl_slist* headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/x-www-form-urlencoded");
+    HttpRequest request;
+    request.method = method;
+    request.url = url;
+    request.headers.push_back("Content-Type: application/x-www-form-urlencoded");
     
     if (!api_key.empty()) {
-        std::string authHeader = "X-MBX-APIKEY: " + api_key;
-        headers = curl_slist_append(headers, authHeader.c_str());
+        request.headers.push_back("X-MBX-APIKEY: " + api_key);
     }
     
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    
-    if (method == "POST") {
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
-    } else if (method != "GET") {
-        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.c_str());
+    if (method != "GET") {
+        request.body = data;
     }
     
-    CURLcode res = curl_easy_perform(curl);
-    curl_slist_free_all(headers);
-    
-    if (res != CURLE_OK) {
-        std::cerr << "CURL error: " << curl_easy_strerror(res) << std::endl;
+    HttpResponse response = HttpEngine::instance().perform(std::move(request));
+    if (!response.error.empty()) {
+        std::cerr << "CURL error: " << response.error << std::endl;
         return "";
     }
-    return responseString;
+    return response.body;
 }
\ No newline at end of file
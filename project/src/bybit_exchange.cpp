@@ -8,86 +8,145 @@
 #include <algorithm>
 #include <nlohmann/json.hpp>
 #include "env_loader.h"
+#include "history_downloader.h"
+#include "http_engine.h"
 using json = nlohmann::json;
 
-BybitExchange::BybitExchange(): curl(nullptr), websocket(nullptr)
+namespace {
+    // Levels of the orderbook topic; depth 1 only ever sends snapshots
+    const int kBookDepth = 50;
+}
+
+BybitExchange::BybitExchange(): websocket(nullptr)
 {
 
     apiKey = EnvLoader::get("Bybit_API_KEY");
     apiSecret = EnvLoader::get("Bybit_API_SECRET");
+    name = "Bybit";
     connected = false;
-
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl = curl_easy_init();
-    
-    if (!curl) {
-        std::cerr << "Failed to initialize libcurl for Bybit Exchange" << std::endl;
-    }
 }
 BybitExchange::~BybitExchange() {
     disconnectWebSocket();
-    if (curl) {
-        curl_easy_cleanup(curl);
-    }
-    curl_global_cleanup();
 }
 bool BybitExchange::connectWebSocket(const std::string& symbol, const std::string& channel) {
-    // Create WebSocket client if needed
-    if (!websocket) {
-        websocket = std::make_unique<WebSocketClient>();
-        
-        if (!websocket->initialize()) {
-            std::cerr << "Failed to initialize WebSocket client" << std::endl;
-            return false;
+    // Bybit topics, e.g. "tickers.BTCUSDT" or "orderbook.1.BTCUSDT"
+    std::string topic;
+    if (channel == "tickers") {
+        topic = channel + "." + symbol;
+    }
+    else if (channel == "orderbook") {
+        topic = channel + "." + std::to_string(kBookDepth) + "." + symbol;
+    }
+    else {
+        std::cerr << "Unsupported Bybit channel: " << channel << std::endl;
+        return false;
+    }
+
+    // Every topic shares one connection
+    {
+        std::lock_guard<std::mutex> lock(subscriptionMutex);
+        if (std::find(subscriptions.begin(), subscriptions.end(), topic) != subscriptions.end()) {
+            return true;
         }
-        
-        // Set callbacks
-        websocket->setMessageCallback([this](const std::string& msg) {
-            handleWebSocketMessage(msg);
-        });
-        
-        websocket->setConnectionCallback([this,&channel, &symbol](bool connected) {
-            std::cout << "Bybit WebSocket " << (connected ? "connected" : "disconnected") << std::endl;
-            
-            // Subscribe to channels after connection is established
-            if (connected) {
-                // Add a small delay to ensure the connection is fully established
-                std::this_thread::sleep_for(std::chrono::milliseconds(500));
-                
-                // Send subscription message
-                json subscribeMsg = {
-                    {"op", "subscribe"},
-                    {"args", json::array()}
-                };
-                
-                // Add subscription args
-                if (channel == "tickers") {
-                    subscribeMsg["args"].push_back(channel + "." + symbol);
-                } 
-                else if (channel == "orderbook") {
-                    subscribeMsg["args"].push_back(channel + ".1." + symbol);
-                }
-                
-                websocket->send(subscribeMsg.dump());
-            }
-        });
-        
-        websocket->setErrorCallback([](const std::string& error) {
-            std::cerr << "Bybit WebSocket error: " << error << std::endl;
-        });
+        subscriptions.push_back(topic);
     }
-    
+
+    // Already open: add the topic to the live connection, or it is
+    // subscribed with the others once the connection is up
+    if (websocket) {
+        if (websocket->isConnected()) {
+            sendSubscription("subscribe", {topic});
+        }
+        return true;
+    }
+
+    websocket = std::make_unique<WebSocketClient>();
+    websocket->setRecorder(recorderStream);
+
+    if (!websocket->initialize()) {
+        std::cerr << "Failed to initialize WebSocket client" << std::endl;
+        websocket.reset();
+        return false;
+    }
+
+    // Set callbacks
+    websocket->setMessageCallback([this](std::string_view msg) {
+        handleWebSocketMessage(msg);
+    });
+
+    websocket->setConnectionCallback([this](bool connected) {
+        std::cout << "Bybit WebSocket " << (connected ? "connected" : "disconnected") << std::endl;
+
+        // Subscribe to all topics after connection is established
+        if (connected) {
+            std::vector<std::string> pending;
+            {
+                std::lock_guard<std::mutex> lock(subscriptionMutex);
+                pending = subscriptions;
+            }
+            sendSubscription("subscribe", pending);
+        } else {
+            // Stale until the snapshots of the next connection
+            for (auto& entry : books) {
+                entry.second.clear();
+            }
+        }
+    });
+
+    websocket->setErrorCallback([](const std::string& error) {
+        std::cerr << "Bybit WebSocket error: " << error << std::endl;
+    });
+
     // Bybit WebSocket URL
     std::string wsUrl = "wss://stream.bybit.com/v5/public/spot";
-    
+
     // Connect to WebSocket
-    return websocket->connect(wsUrl);
+    if (!websocket->connect(wsUrl)) {
+        websocket.reset();
+        return false;
+    }
+    return true;
+}
+
+void BybitExchange::sendSubscription(const std::string& op, const std::vector<std::string>& topics) {
+    // Bybit spot accepts at most 10 args per request
+    const size_t batchSize = 10;
+    for (size_t first = 0; first < topics.size(); first += batchSize) {
+        json message = {
+            {"op", op},
+            {"args", json::array()}
+        };
+        size_t last = std::min(first + batchSize, topics.size());
+        for (size_t i = first; i < last; i++) {
+            message["args"].push_back(topics[i]);
+        }
+        websocket->send(message.dump());
+    }
 }
 
 void BybitExchange::disconnectWebSocket() {
     if (websocket) {
+        // Send unsubscribe message if connected
+        if (websocket->isConnected()) {
+            std::vector<std::string> active;
+            {
+                std::lock_guard<std::mutex> lock(subscriptionMutex);
+                active = subscriptions;
+            }
+            sendSubscription("unsubscribe", active);
+        }
+
         websocket->disconnect();
+        websocket.reset();
     }
+    // The dispatch thread is gone, nothing else touches the books
+    books.clear();
+    std::lock_guard<std::mutex> lock(subscriptionMutex);
+    subscriptions.clear();
+}
+
+void BybitExchange::setMarketDataRecorder(MarketDataRecorder* recorder) {
+    recorderStream = recorder ? recorder->addStream(name) : nullptr;
 }
 
 bool BybitExchange::isWebSocketConnected() const {
@@ -104,7 +163,17 @@ void BybitExchange::setRealTimeCandleCallback(std::function<void(const OHLCV&)>
 void BybitExchange::setRealTimeOrderBookCallback(std::function<void(const CommonFormatData&)> callback) {
     orderbookCallback = callback;
 }
-void BybitExchange::handleWebSocketMessage(const std::string& message) {
+
+void BybitExchange::setOrderBookUpdateCallback(std::function<void(const OrderBook&)> callback) {
+    bookUpdateCallback = callback;
+}
+void BybitExchange::handleWebSocketMessage(std::string_view message) {
+    // Book and ticker updates take the fast path, everything else the full parse
+    if (MarketDataParser::parseBybit(message, parsedMessage) == ParseResult::PARSED
+        && handleParsedMessage(parsedMessage)) {
+        return;
+    }
+
     try {
         json data = json::parse(message);
         /*
@@ -149,38 +218,9 @@ void BybitExchange::handleWebSocketMessage(const std::string& message) {
                     priceUpdateCallback(symbol, price, std::to_string(data["ts"].get<int64_t>()));
                 }
             }
-            else if (channel == "orderbook" && orderbookCallback) {
-                // Handle order book updates
-                // std::cout << "Order book update for " << symbol << ": " << data.dump(4) << std::endl;
-                CommonFormatData orderbook_data;
-                orderbook_data.exchange = "Bybit";
-                orderbook_data.symbol = symbol.substr(symbol.find('.') + 1); // Remove "1." prefix
-                orderbook_data.timestamp = data["ts"].get<int64_t>();
-
-                if(data["data"].contains("a") && data["data"].contains("b")) {
-                    try
-                    {
-                        const auto& asks = data["data"]["a"];
-                        const auto& bids = data["data"]["b"];
-                        
-                        for(const auto& ask : asks) {
-                            orderbook_data.asks.push_back(ask[0].get<std::string>());
-                        }
-
-                        for(const auto& bid : bids) {
-                            orderbook_data.bids.push_back(bid[0].get<std::string>());
-                        }
-
-                        orderbookCallback(orderbook_data);
-                    }
-                    catch(const std::exception& e)
-                    {
-                        std::cerr << e.what() << '\n';
-                    }
-                }
-
+            else if (channel == "orderbook") {
                 /*
-                Order book update for 1.BTCUSDT: {
+                Order book update for 50.BTCUSDT: {
                     "cts": 1750148961525,
                     "data": {
                         "a": [
@@ -199,11 +239,17 @@ void BybitExchange::handleWebSocketMessage(const std::string& message) {
                         "seq": 77377992351,
                         "u": 293507
                     },
-                    "topic": "orderbook.1.BTCUSDT",
+                    "topic": "orderbook.50.BTCUSDT",
                     "ts": 1750148961528,
                     "type": "snapshot"
                 }
                 */
+                // The fast path takes every book message Bybit sends
+                std::cerr << "Unexpected Bybit orderbook message for " << symbol << std::endl;
+                auto found = books.find(symbol.substr(symbol.find('.') + 1));
+                if (found != books.end()) {
+                    resyncOrderBook(found->second);
+                }
             }
         }
     } catch (const std::exception& e) {
@@ -211,6 +257,82 @@ void BybitExchange::handleWebSocketMessage(const std::string& message) {
     }
 }
 
+bool BybitExchange::handleParsedMessage(const MarketDataMessage& message) {
+    if (message.channel == "orderbook") {
+        handleBookMessage(message);
+        return true;
+    }
+    if (message.channel == "tickers" && message.hasPrice) {
+        if (priceUpdateCallback) {
+            priceUpdateCallback(std::string(message.symbol), message.price, std::to_string(message.timestamp));
+        }
+        return true;
+    }
+    return false;
+}
+
+void BybitExchange::handleBookMessage(const MarketDataMessage& message) {
+    auto found = books.find(message.symbol);
+    if (found == books.end()) {
+        std::string symbol(message.symbol);
+        found = books.emplace(symbol, OrderBook("Bybit", symbol)).first;
+    }
+    OrderBook& book = found->second;
+    int64_t updateId = message.sequence;
+
+    // u == 1 is a snapshot sent after a service restart
+    if (message.type == "snapshot" || updateId == 1) {
+        book.clear();
+    } else if (!book.isValid()) {
+        // Deltas before the snapshot of a resync
+        return;
+    } else if (updateId != book.sequence + 1) {
+        std::cerr << "Bybit " << book.symbol << " book sequence gap: expected u " << book.sequence + 1
+                  << ", got " << updateId << std::endl;
+        resyncOrderBook(book);
+        return;
+    }
+
+    if (!book.apply(message.asks, message.bids)) {
+        std::cerr << "Bybit " << book.symbol << " book level could not be parsed" << std::endl;
+        resyncOrderBook(book);
+        return;
+    }
+    book.sequence = updateId;
+    book.timestamp = message.timestamp;
+
+    // A crossed book means a delta went missing
+    const BookLevel* bid = book.bestBid();
+    const BookLevel* ask = book.bestAsk();
+    if (bid && ask && bid->price >= ask->price) {
+        std::cerr << "Bybit " << book.symbol << " book crossed at u " << updateId << std::endl;
+        resyncOrderBook(book);
+        return;
+    }
+    book.setValid(true);
+    publishOrderBook(book);
+}
+
+void BybitExchange::resyncOrderBook(OrderBook& book) {
+    book.clear();
+    if (websocket && websocket->isConnected()) {
+        std::string topic = "orderbook." + std::to_string(kBookDepth) + "." + book.symbol;
+        sendSubscription("unsubscribe", {topic});
+        sendSubscription("subscribe", {topic});
+    }
+}
+
+void BybitExchange::publishOrderBook(const OrderBook& book) {
+    if (bookUpdateCallback) {
+        bookUpdateCallback(book);
+    }
+    if (orderbookCallback) {
+        CommonFormatData orderbook_data;
+        book.copyTop(orderbook_data);
+        orderbookCallback(orderbook_data);
+    }
+}
+
 bool BybitExchange::initialize(const std::string& api_key, const std::string& api_secret) {
     this->api_key = api_key;
     this->api_secret = api_secret;
@@ -244,60 +366,97 @@ std::vector<OHLCV> BybitExchange::fetchHistoricalData(const std::string& symbol,
     const std::string& end_time) {
     std::vector<OHLCV> result;
 
-    // Format symbol for Bybit (e.g., BTC-USDT)
-    std::string formattedSymbol = formatSymbol(symbol);
-
-    // Debug output
-    std::cout << "Fetching data for instrument: " << formattedSymbol << std::endl;
-
-    // Map timeframe to Bybit format
-    std::string BybitTimeframe;
-    if (timeframe == "1m") BybitTimeframe = "1m";
-    else if (timeframe == "5m") BybitTimeframe = "5m";
-    else if (timeframe == "15m") BybitTimeframe = "15m";
-    else if (timeframe == "30m") BybitTimeframe = "30m";
-    else if (timeframe == "1h") BybitTimeframe = "1H";
-    else if (timeframe == "4h") BybitTimeframe = "4H";
-    else if (timeframe == "1d") BybitTimeframe = "1D";
-    else {
+    std::string endpoint = klineEndpoint(symbol, timeframe);
+    if (endpoint.empty()) {
         std::cerr << "Unsupported timeframe: " << timeframe << std::endl;
         return result;
     }
 
-// Build API endpoint
-    std::stringstream ss;
-    ss << "/api/v5/market/candles?instId=" << formattedSymbol;
-    ss << "&bar=" << BybitTimeframe;
+    // Without a range, return the latest page
+    if (start_time.empty() || end_time.empty()) {
+        std::string url = buildApiUrl(endpoint + "&limit=1000");
+        std::cout << "Request URL: " << url << std::endl; // Debug output
+        parseCandles(makeRequest(url), result);
+        return result;
+    }
 
-    if (!start_time.empty()) {
-        ss << "&after=" << start_time;
+    std::time_t startTime = 0;
+    std::time_t endTime = 0;
+    if (parseTimeRange(start_time, end_time, startTime, endTime)) {
+        fetchHistoricalRange(symbol, timeframe, startTime, endTime, result);
     }
+    return result;
+}
 
-    if (!end_time.empty()) {
-        ss << "&before=" << end_time;
+bool BybitExchange::fetchHistoricalRange(const std::string& symbol, const std::string& timeframe,
+                                         std::time_t startTime, std::time_t endTime, std::vector<OHLCV>& bars) {
+    bars.clear();
+    std::string endpoint = klineEndpoint(symbol, timeframe);
+    if (endpoint.empty()) {
+        std::cerr << "Unsupported timeframe: " << timeframe << std::endl;
+        return false;
     }
 
-    ss << "&limit=100"; // Bybit has a maximum limit of 100
+    // 1000 bars per request, start/end are inclusive; the IP limit is 600 requests per 5 seconds
+    auto pageUrl = [this, endpoint](std::time_t pageStart, std::time_t pageEnd) {
+        std::stringstream ss;
+        ss << endpoint;
+        ss << "&start=" << static_cast<long long>(pageStart) * 1000;
+        ss << "&end=" << static_cast<long long>(pageEnd) * 1000;
+        ss << "&limit=1000";
+        return buildApiUrl(ss.str());
+    };
 
-    std::string url = buildApiUrl(ss.str());
-    std::cout << "Request URL: " << url << std::endl; // Debug output
+    auto parsePage = [this](const std::string& response, std::vector<OHLCV>& pageBars) {
+        return parseCandles(response, pageBars);
+    };
 
-    std::string response = makeRequest(url);
+    HistoryDownloader downloader(4, 10.0);
+    return downloader.download(startTime, endTime, HistoryDownloader::timeframeSeconds(timeframe), 1000,
+                               pageUrl, parsePage, bars);
+}
+
+std::string BybitExchange::klineEndpoint(const std::string& symbol, const std::string& timeframe) {
+    // The v5 market endpoints take the plain symbol (e.g., BTCUSDT)
+    std::string klineSymbol = symbol;
+    klineSymbol.erase(std::remove_if(klineSymbol.begin(), klineSymbol.end(), [](char c) {
+        return c == '-' || c == '/';
+    }), klineSymbol.end());
+
+    // Debug output
+    std::cout << "Fetching data for instrument: " << klineSymbol << std::endl;
+
+    // Map timeframe to Bybit interval (minutes or D)
+    std::string BybitTimeframe;
+    if (timeframe == "1m") BybitTimeframe = "1";
+    else if (timeframe == "5m") BybitTimeframe = "5";
+    else if (timeframe == "15m") BybitTimeframe = "15";
+    else if (timeframe == "30m") BybitTimeframe = "30";
+    else if (timeframe == "1h") BybitTimeframe = "60";
+    else if (timeframe == "4h") BybitTimeframe = "240";
+    else if (timeframe == "1d") BybitTimeframe = "D";
+    else {
+        return "";
+    }
+
+    return "/v5/market/kline?category=spot&symbol=" + klineSymbol + "&interval=" + BybitTimeframe;
+}
 
+bool BybitExchange::parseCandles(const std::string& response, std::vector<OHLCV>& candles) {
     if (response.empty()) {
         std::cerr << "Empty response from Bybit API" << std::endl;
-        return result;
+        return false;
     }
 
     try {
         json responseJson = json::parse(response);
 
-        if (responseJson.contains("code") && responseJson["code"] == "0" && responseJson.contains("data")) {
-            for (const auto& item : responseJson["data"]) {
+        if (responseJson.contains("retCode") && responseJson["retCode"] == 0 && responseJson.contains("result")) {
+            for (const auto& item : responseJson["result"]["list"]) {
                 if (item.size() < 6) continue;
 
                 OHLCV candle;
-                // Bybit format: [0]=timestamp, [1]=open, [2]=high, [3]=low, [4]=close, [5]=volume
+                // Bybit format: [0]=start time, [1]=open, [2]=high, [3]=low, [4]=close, [5]=volume, newest first
                 candle.timestamp = std::stoll(item[0].get<std::string>()) / 1000; // Convert from ms to s
                 candle.open = std::stod(item[1].get<std::string>());
                 candle.high = std::stod(item[2].get<std::string>());
@@ -305,16 +464,15 @@ std::vector<OHLCV> BybitExchange::fetchHistoricalData(const std::string& symbol,
                 candle.close = std::stod(item[4].get<std::string>());
                 candle.volume = std::stod(item[5].get<std::string>());
 
-                result.push_back(candle);
+                candles.push_back(candle);
             }
-    } else {
-            std::cerr << "Error in Bybit API response: " << response << std::endl;
+            return true;
         }
-    }catch (const std::exception& e) {
+        std::cerr << "Error in Bybit API response: " << response << std::endl;
+    } catch (const std::exception& e) {
         std::cerr << "Error parsing Bybit response: " << e.what() << std::endl;
     }
-
-    return result;
+    return false;
 }
 double BybitExchange::getCurrentPrice(const std::string& symbol) {
     std::string formattedSymbol = formatSymbol(symbol);
@@ -551,63 +709,37 @@ std::string BybitExchange::getTimestamp() {
     return std::to_string(timestamp_ms);
 }
 
-size_t BybitExchange::WriteCallback(void* contents, size_t size, size_t nmemb, std::string* s) {
-    size_t newLength = size * nmemb;
-    try {
-        s->append((char*)contents, newLength);
-        return newLength;
-    } catch (const std::bad_alloc& e) {
-        // Handle memory problem
-        return 0;
-    }
-}
-
 std::string BybitExchange::makeRequest(const std::string& url, const std::string& method, 
                                      const std::string& data, const std::string& timestamp) {
-    if (!curl) {
-        std::cerr << "CURL not initialized" << std::endl;
-        return "";
-    }
     const std::string recvWindow = "50000";
     const std::string queryString = "coin=USDT";
 
-    std::string responseString;
     std::string actualTimestamp = timestamp.empty() ? getTimestamp() : timestamp;
     const std::string API_SIGN = signRequest(actualTimestamp + apiKey + recvWindow + queryString);
 
-    curl_easy_reset(curl);
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
-    
-    struct curl_slist* headers = NULL;
+    HttpRequest request;
+    request.method = method;
+    request.url = url;
+    request.body = data;
     
     // For authenticated requests
-    headers = curl_slist_append(headers, ("X-BAPI-API-KEY: " + apiKey).c_str());
-    headers = curl_slist_append(headers, ("X-BAPI-TIMESTAMP: " + actualTimestamp).c_str());
-    headers = curl_slist_append(headers, ("X-BAPI-RECV-WINDOW: " + recvWindow).c_str());
-    headers = curl_slist_append(headers, ("X-BAPI-SIGN: " + API_SIGN).c_str());
-    // Common headers
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    
+    request.headers.push_back("X-BAPI-API-KEY: " + apiKey);
+    request.headers.push_back("X-BAPI-TIMESTAMP: " + actualTimestamp);
+    request.headers.push_back("X-BAPI-RECV-WINDOW: " + recvWindow);
+    request.headers.push_back("X-BAPI-SIGN: " + API_SIGN);
     
-    CURLcode res = curl_easy_perform(curl);
-    curl_slist_free_all(headers);
-
-    nlohmann::json response;
-    if (res != CURLE_OK) 
+    HttpResponse response = HttpEngine::instance().perform(std::move(request));
+    if (!response.error.empty()) 
     {
-        std::cerr << "CURL error: " << curl_easy_strerror(res) << std::endl;
+        std::cerr << "CURL error: " << response.error << std::endl;
         return "";
     }
-    else {
-        try {
-            response = nlohmann::json::parse(responseString);
-        } catch (const std::exception& e) {
-            std::cerr << "Failed to parse JSON: " << e.what() << std::endl;
-            return 0;
-        }
+
+    // Validate only, callers parse the body themselves
+    if (!nlohmann::json::accept(response.body)) {
+        std::cerr << "Failed to parse JSON response" << std::endl;
+        return "";
     }
 
-    return responseString;
+    return response.body;
 }
\ No newline at end of file
@@ -0,0 +1,284 @@
+#include "candle_cache.h"
+#include "bar_file.h"
+#include "history_downloader.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    std::string sanitize(const std::string& part) {
+        std::string result = part;
+        for (char& c : result) {
+            if (c == '/' || c == '\\' || c == ':' || c == ' ') {
+                c = '-';
+            }
+        }
+        return result;
+    }
+}
+
+CandleCache::CandleCache(const std::string& directory)
+    : directory(directory) {
+}
+
+std::vector<OHLCV> CandleCache::getCandles(Exchange& exchange, const std::string& symbol,
+                                           const std::string& timeframe,
+                                           std::time_t startTime, std::time_t endTime) {
+    return getSeries(exchange, symbol, timeframe, startTime, endTime).toOHLCV();
+}
+
+BarSeries CandleCache::getSeries(Exchange& exchange, const std::string& symbol,
+                                 const std::string& timeframe,
+                                 std::time_t startTime, std::time_t endTime) {
+    std::time_t step = HistoryDownloader::timeframeSeconds(timeframe);
+    if (step == 0) {
+        std::cerr << "Unsupported timeframe for candle cache: " << timeframe << std::endl;
+        return BarSeries(symbol);
+    }
+    if (startTime > endTime) {
+        return BarSeries(symbol);
+    }
+
+    // Work on the bar open time grid
+    TimeRange requested(startTime - startTime % step, endTime - endTime % step);
+    // The newest bar may still be forming, so it is never marked as downloaded
+    std::time_t now = std::time(nullptr);
+    std::time_t lastClosedBar = now - now % step - step;
+
+    // Only this key waits for the downloads below, other keys go on meanwhile
+    std::string key = sanitize(exchange.getName()) + "_" + sanitize(symbol) + "_" + sanitize(timeframe);
+    Entry& entry = entryFor(key);
+    std::lock_guard<std::mutex> lock(entry.mutex);
+    if (!entry.loaded) {
+        load(key, entry);
+        entry.loaded = true;
+    }
+    entry.bars.setSymbol(symbol);
+    entry.timeframeSeconds = step;
+
+    bool changed = false;
+    bool complete = true;
+    for (const TimeRange& gap : missingRanges(entry.covered, requested, step)) {
+        std::cout << "Candle cache: downloading " << key << " " << gap.first << " - " << gap.second << std::endl;
+        std::vector<OHLCV> fetched;
+        if (!exchange.fetchHistoricalRange(symbol, timeframe, gap.first, gap.second, fetched)) {
+            // Not marked, the next call asks for the gap again
+            complete = false;
+            continue;
+        }
+        if (!fetched.empty()) {
+            mergeBars(entry, fetched);
+        }
+
+        // The whole gap came back, an empty one has no bars to download
+        TimeRange done(gap.first, std::min(gap.second, lastClosedBar));
+        if (done.first <= done.second) {
+            addCoverage(entry.covered, done, step);
+        }
+        changed = true;
+    }
+
+    if (changed) {
+        save(key, entry);
+    }
+    if (!complete) {
+        std::cerr << "Candle cache: " << key << " could not download all of " << requested.first << " - "
+                  << requested.second << std::endl;
+        return BarSeries(symbol);
+    }
+
+    // Copy out under the lock, later downloads replace entry.bars
+    const auto& timestamps = entry.bars.timestamp();
+    size_t first = static_cast<size_t>(
+        std::lower_bound(timestamps.begin(), timestamps.end(), requested.first) - timestamps.begin());
+    size_t last = static_cast<size_t>(
+        std::upper_bound(timestamps.begin(), timestamps.end(), requested.second) - timestamps.begin());
+    return BarSeriesView(entry.bars).subview(first, last - first).toSeries();
+}
+
+std::string CandleCache::pathFor(const std::string& key) const {
+    return (std::filesystem::path(directory) / (key + ".lwbf")).string();
+}
+
+CandleCache::Entry& CandleCache::entryFor(const std::string& key) {
+    // Map nodes never move, the entry outlives the lock
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries[key];
+}
+
+bool CandleCache::load(const std::string& key, Entry& entry) {
+    std::string path = pathFor(key);
+    if (!std::filesystem::exists(path)) {
+        return false;
+    }
+
+    BarFile file;
+    std::ifstream ranges(path + ".ranges");
+    if (!ranges || !file.open(path)) {
+        std::cerr << "Ignoring unreadable candle cache entry: " << path << std::endl;
+        return false;
+    }
+
+    // Downloaded ranges, one "first last" pair per line
+    std::vector<TimeRange> covered;
+    long long first = 0;
+    long long last = 0;
+    while (ranges >> first >> last) {
+        covered.emplace_back(static_cast<std::time_t>(first), static_cast<std::time_t>(last));
+    }
+
+    entry.covered = std::move(covered);
+    entry.bars = file.series().toSeries();
+    return true;
+}
+
+bool CandleCache::save(const std::string& key, const Entry& entry) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cerr << "Failed to create candle cache directory " << directory << ": " << error.message() << std::endl;
+        return false;
+    }
+
+    // Bars first: a crash in between leaves ranges that are still all on disk
+    std::string path = pathFor(key);
+    if (!BarFile::write(path, entry.bars, entry.timeframeSeconds)) {
+        return false;
+    }
+
+    std::string rangesPath = path + ".ranges";
+    std::string tempPath = rangesPath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::trunc);
+        for (const TimeRange& range : entry.covered) {
+            out << static_cast<long long>(range.first) << " " << static_cast<long long>(range.second) << "\n";
+        }
+        if (!out) {
+            std::cerr << "Failed to write candle cache file: " << tempPath << std::endl;
+            return false;
+        }
+    }
+    std::filesystem::rename(tempPath, rangesPath, error);
+    if (error) {
+        std::cerr << "Failed to replace candle cache file " << rangesPath << ": " << error.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void CandleCache::mergeBars(Entry& entry, const std::vector<OHLCV>& fetched) {
+    // Exchanges return bars newest or oldest first
+    BarSeries incoming = BarSeries::fromOHLCV(fetched);
+    const BarSeries& existing = entry.bars;
+
+    BarSeries merged(existing.symbolName());
+    merged.reserve(existing.size() + incoming.size());
+    size_t i = 0;
+    size_t j = 0;
+    auto appendFrom = [&merged](const BarSeries& source, size_t index) {
+        if (!merged.empty() && merged.timestamp().back() == source.timestamp()[index]) {
+            return;
+        }
+        merged.append(source.timestamp()[index], source.open()[index], source.high()[index],
+                      source.low()[index], source.close()[index], source.volume()[index]);
+    };
+    while (i < existing.size() || j < incoming.size()) {
+        if (j == incoming.size()) {
+            appendFrom(existing, i++);
+        } else if (i == existing.size()) {
+            appendFrom(incoming, j++);
+        } else if (incoming.timestamp()[j] <= existing.timestamp()[i]) {
+            // Freshly downloaded bars win over stored ones with the same timestamp
+            if (incoming.timestamp()[j] == existing.timestamp()[i]) {
+                i++;
+            }
+            appendFrom(incoming, j++);
+        } else {
+            appendFrom(existing, i++);
+        }
+    }
+    entry.bars = std::move(merged);
+}
+
+void CandleCache::addCoverage(std::vector<TimeRange>& covered, TimeRange range, std::time_t step) {
+    covered.push_back(range);
+    std::sort(covered.begin(), covered.end());
+
+    std::vector<TimeRange> merged;
+    for (const TimeRange& current : covered) {
+        if (!merged.empty() && current.first <= merged.back().second + step) {
+            merged.back().second = std::max(merged.back().second, current.second);
+        } else {
+            merged.push_back(current);
+        }
+    }
+    covered = std::move(merged);
+}
+
+std::vector<CandleCache::TimeRange> CandleCache::missingRanges(const std::vector<TimeRange>& covered,
+                                                               TimeRange range, std::time_t step) {
+    std::vector<TimeRange> missing;
+    std::time_t next = range.first;
+    for (const TimeRange& current : covered) {
+        if (current.second < next) {
+            continue;
+        }
+        if (current.first > range.second) {
+            break;
+        }
+        if (current.first > next) {
+            missing.emplace_back(next, current.first - step);
+        }
+        next = current.second + step;
+    }
+    if (next <= range.second) {
+        missing.emplace_back(next, range.second);
+    }
+    return missing;
+}
+
+CachedExchange::CachedExchange(std::shared_ptr<Exchange> inner, std::shared_ptr<CandleCache> cache)
+    : inner(std::move(inner)), cache(std::move(cache)) {
+    name = this->inner->getName();
+    connected = this->inner->isConnected();
+}
+
+bool CachedExchange::initialize(const std::string& api_key, const std::string& api_secret) {
+    bool result = inner->initialize(api_key, api_secret);
+    name = inner->getName();
+    connected = inner->isConnected();
+    return result;
+}
+
+std::vector<OHLCV> CachedExchange::fetchHistoricalData(const std::string& symbol,
+                                                       const std::string& timeframe,
+                                                       const std::string& start_time,
+                                                       const std::string& end_time) {
+    if (start_time.empty() || end_time.empty() || HistoryDownloader::timeframeSeconds(timeframe) == 0) {
+        return inner->fetchHistoricalData(symbol, timeframe, start_time, end_time);
+    }
+
+    std::time_t startTime = 0;
+    std::time_t endTime = 0;
+    if (!parseTimeRange(start_time, end_time, startTime, endTime)) {
+        return {};
+    }
+    return cache->getCandles(*inner, symbol, timeframe, startTime, endTime);
+}
+
+double CachedExchange::getCurrentPrice(const std::string& symbol) {
+    return inner->getCurrentPrice(symbol);
+}
+
+bool CachedExchange::placeBuyOrder(const std::string& symbol, double quantity, double price) {
+    return inner->placeBuyOrder(symbol, quantity, price);
+}
+
+bool CachedExchange::placeSellOrder(const std::string& symbol, double quantity, double price) {
+    return inner->placeSellOrder(symbol, quantity, price);
+}
+
+std::vector<Order> CachedExchange::getOpenOrders(const std::string& symbol) {
+    return inner->getOpenOrders(symbol);
+}
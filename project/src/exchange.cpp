@@ -1 +1,22 @@
-#include "exchange.h"
\ No newline at end of file
+#include "exchange.h"
+#include <iostream>
+
+bool Exchange::fetchHistoricalRange(const string& symbol, const string& timeframe, time_t startTime, time_t endTime, vector<OHLCV>& bars)
+{
+    bars = fetchHistoricalData(symbol, timeframe,
+                               to_string(static_cast<long long>(startTime) * 1000),
+                               to_string(static_cast<long long>(endTime) * 1000));
+    return !bars.empty();
+}
+
+bool Exchange::parseTimeRange(const string& start_time, const string& end_time, time_t& startTime, time_t& endTime)
+{
+    try {
+        startTime = static_cast<time_t>(stoll(start_time) / 1000);
+        endTime = static_cast<time_t>(stoll(end_time) / 1000);
+    } catch (const exception& e) {
+        cerr << "Invalid time range " << start_time << " - " << end_time << ": " << e.what() << endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,381 @@
+#include "fill_simulator.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+// Without a suggested quantity a position takes this share of equity
+const double kDefaultPositionFraction = 0.02;
+
+OrderSide opposite(OrderSide side)
+{
+    return side == OrderSide::BUY ? OrderSide::SELL : OrderSide::BUY;
+}
+
+// Price a resting order fills at as the path moves from `from` to `to`, 0
+// if it is not reached. On a continuous path a stop fills at its level (or
+// at `from` when already through it); on ticks it becomes a market order
+// and takes the print that triggered it.
+double restingFill(OrderSide side, OrderType type, double level, const PathPoint& from, const PathPoint& to,
+                   bool continuous)
+{
+    if (side == OrderSide::BUY)
+    {
+        if (type == OrderType::STOP)
+        {
+            if (to.buy < level) return 0;
+            return continuous ? std::max(level, from.buy) : to.buy;
+        }
+        if (to.buy > level) return 0;
+        return std::min(level, from.buy);
+    }
+    if (type == OrderType::STOP)
+    {
+        if (to.sell > level) return 0;
+        return continuous ? std::min(level, from.sell) : to.sell;
+    }
+    if (to.sell < level) return 0;
+    return std::max(level, from.sell);
+}
+}
+
+void ohlcPath(std::time_t time, double open, double high, double low, double close, std::vector<PathPoint>& path)
+{
+    bool highFirst = high - open <= open - low;
+    path.clear();
+    path.push_back({open, open, time});
+    path.push_back({highFirst ? high : low, highFirst ? high : low, time});
+    path.push_back({highFirst ? low : high, highFirst ? low : high, time});
+    path.push_back({close, close, time});
+}
+
+TradingAccount::TradingAccount(double capital) : cash(capital) {}
+
+void TradingAccount::setCommissionRate(double rate)
+{
+    commissionRate = rate;
+}
+void TradingAccount::setSlippage(double fraction)
+{
+    slippage = fraction;
+}
+void TradingAccount::setMaxLeverage(double leverage)
+{
+    maxLeverage = leverage;
+}
+void TradingAccount::setMaxPositionFraction(double fraction)
+{
+    maxPositionFraction = fraction;
+}
+void TradingAccount::setMaintenanceMargin(double fraction)
+{
+    maintenanceMargin = fraction;
+}
+void TradingAccount::setFillCallback(std::function<void(const FillEvent&)> callback)
+{
+    fillCallback = std::move(callback);
+}
+
+bool TradingAccount::isMarginCall() const
+{
+    return maintenanceMargin > 0 && exposure > 0 && equity() < exposure * maintenanceMargin;
+}
+
+double TradingAccount::maxQuantity(double price) const
+{
+    double currentEquity = equity();
+    double notional = std::min(currentEquity * maxPositionFraction,
+                               currentEquity * maxLeverage - exposure);
+    if (notional <= 0 || price <= 0)
+    {
+        return 0;
+    }
+    return notional / (price * (1 + commissionRate));
+}
+
+FillSimulator::FillSimulator(TradingAccount& account, BacktestResult& result, bool verbose, bool recordHistory)
+    : account(account), result(result), verbose(verbose), recordHistory(recordHistory) {}
+
+void FillSimulator::queue(const Signal& signal)
+{
+    if (signal.orderType == OrderType::MARKET)
+    {
+        nextMarketOrders.push_back(signal);
+    }
+    else
+    {
+        restingOrders.push_back({signal, false});
+    }
+}
+
+void FillSimulator::walk(const std::vector<PathPoint>& path, bool continuous)
+{
+    if (path.empty())
+    {
+        return;
+    }
+    // Market orders of the previous bar fill at this bar's open
+    std::vector<Signal> marketOrders;
+    marketOrders.swap(pendingMarketOrders);
+    for (const Signal& order : marketOrders)
+    {
+        double price = order.side == OrderSide::BUY ? path[0].buy : path[0].sell;
+        execute(order, price, OrderType::MARKET, path[0].time);
+    }
+    pendingMarketOrders.swap(nextMarketOrders);
+
+    if (continuous || !hasLast)
+    {
+        last = path[0];
+    }
+    for (const PathPoint& point : path)
+    {
+        checkBracket(last, point, continuous);
+        trackExcursion(point);
+        for (RestingOrder& order : restingOrders)
+        {
+            if (order.filled)
+            {
+                continue;
+            }
+            const Signal& signal = order.signal;
+            // Entries wait for a flat book, exits need the opposite position
+            bool applies = signal.closesPosition
+                ? position.open && signal.side != position.side
+                : !position.open;
+            if (!applies)
+            {
+                continue;
+            }
+            double price = restingFill(signal.side, signal.orderType, signal.suggestedPrice, last, point, continuous);
+            if (price <= 0)
+            {
+                continue;
+            }
+            order.filled = true;
+            execute(signal, price, signal.orderType, point.time);
+            if (position.open)
+            {
+                // The rest of this move can already reach the new bracket
+                PathPoint entry{price, price, point.time};
+                checkBracket(entry, point, continuous);
+                trackExcursion(point);
+            }
+        }
+        last = point;
+    }
+    hasLast = true;
+
+    // Stops and limits only rest for the bar that emitted them
+    for (const RestingOrder& order : restingOrders)
+    {
+        if (!order.filled && !order.signal.closesPosition)
+        {
+            result.cancelledOrders++;
+        }
+    }
+    restingOrders.clear();
+    mark();
+}
+
+void FillSimulator::closeOut(FillReason reason)
+{
+    if (position.open)
+    {
+        OrderSide side = opposite(position.side);
+        double price = side == OrderSide::SELL ? last.sell : last.buy;
+        close(adverse(side, price), OrderType::MARKET, reason, last.time);
+    }
+}
+
+double FillSimulator::profit() const
+{
+    if (!position.open)
+    {
+        return realizedProfit;
+    }
+    double move = position.side == OrderSide::BUY ? last.sell - position.entryPrice : position.entryPrice - last.buy;
+    return realizedProfit + move * position.quantity - position.entryFee;
+}
+
+double FillSimulator::adverse(OrderSide side, double price) const
+{
+    return side == OrderSide::BUY ? price * (1 + account.slippage) : price * (1 - account.slippage);
+}
+
+void FillSimulator::execute(const Signal& order, double price, OrderType type, std::time_t time)
+{
+    if (type != OrderType::LIMIT)
+    {
+        price = adverse(order.side, price);
+    }
+    if (order.closesPosition)
+    {
+        if (position.open && order.side != position.side)
+        {
+            close(price, type, FillReason::EXIT, time);
+        }
+        return;
+    }
+    if (!position.open)
+    {
+        open(order, price, type, time);
+    }
+}
+
+void FillSimulator::open(const Signal& order, double price, OrderType type, std::time_t time)
+{
+    double quantity = order.suggestedQuantity > 0
+        ? order.suggestedQuantity
+        : account.equity() * kDefaultPositionFraction / price;
+    quantity = std::min(quantity, account.maxQuantity(price));
+    if (quantity <= 0)
+    {
+        return;
+    }
+    position.open = true;
+    position.symbol = order.symbol;
+    position.side = order.side;
+    position.quantity = quantity;
+    position.entryPrice = price;
+    position.entryTime = time;
+    position.takeProfit = order.takeProfit;
+    position.stopLoss = order.stopLoss;
+    position.worstPrice = price;
+    position.bestPrice = price;
+    position.entryFee = fill(order.side, type, FillReason::ENTRY, price, quantity, time);
+    result.totalTrades++;
+    markAt(price);
+    if (verbose) std::cout << "Opening trade at " << price << ", Quantity: " << quantity << std::endl;
+}
+
+void FillSimulator::close(double price, OrderType type, FillReason reason, std::time_t time)
+{
+    trackExcursion(price);
+    double exitFee = fill(opposite(position.side), type, reason, price, position.quantity, time);
+    Trade trade;
+    trade.symbol = position.symbol;
+    trade.side = position.side;
+    trade.entryPrice = position.entryPrice;
+    trade.exitPrice = price;
+    trade.quantity = position.quantity;
+    trade.entryTime = position.entryTime;
+    trade.exitTime = time;
+    trade.fees = position.entryFee + exitFee;
+    double move = position.side == OrderSide::BUY ? price - position.entryPrice : position.entryPrice - price;
+    trade.profit = move * position.quantity - trade.fees;
+    trade.profitPercent = (trade.profit / (position.entryPrice * position.quantity)) * 100.0;
+    if (position.side == OrderSide::BUY)
+    {
+        trade.mae = (position.entryPrice - position.worstPrice) / position.entryPrice;
+        trade.mfe = (position.bestPrice - position.entryPrice) / position.entryPrice;
+    }
+    else
+    {
+        trade.mae = (position.worstPrice - position.entryPrice) / position.entryPrice;
+        trade.mfe = (position.entryPrice - position.bestPrice) / position.entryPrice;
+    }
+    if (trade.profit > 0)
+    {
+        result.winningTrades++;
+    }
+    else
+    {
+        result.losingTrades++;
+    }
+    realizedProfit += trade.profit;
+    if (metrics)
+    {
+        metrics->addTrade(trade);
+    }
+    if (verbose) std::cout << "Closing trade at " << price << ", Profit: " << trade.profit
+                           << " (" << trade.profitPercent << "%)" << std::endl;
+    if (recordHistory)
+    {
+        result.trades.push_back(trade);
+    }
+    position.open = false;
+    mark();
+}
+
+void FillSimulator::checkBracket(const PathPoint& from, const PathPoint& to, bool continuous)
+{
+    if (!position.open)
+    {
+        return;
+    }
+    OrderSide exitSide = opposite(position.side);
+    if (position.stopLoss > 0)
+    {
+        double price = restingFill(exitSide, OrderType::STOP, position.stopLoss, from, to, continuous);
+        if (price > 0)
+        {
+            close(adverse(exitSide, price), OrderType::STOP, FillReason::STOP_LOSS, to.time);
+            return;
+        }
+    }
+    if (position.takeProfit > 0)
+    {
+        double price = restingFill(exitSide, OrderType::LIMIT, position.takeProfit, from, to, continuous);
+        if (price > 0)
+        {
+            close(price, OrderType::LIMIT, FillReason::TAKE_PROFIT, to.time);
+        }
+    }
+}
+
+double FillSimulator::fill(OrderSide side, OrderType type, FillReason reason, double price, double quantity,
+                           std::time_t time)
+{
+    double fee = price * quantity * account.commissionRate;
+    account.cash += (side == OrderSide::BUY ? -price : price) * quantity - fee;
+    account.fees += fee;
+    result.totalFees += fee;
+    FillEvent event{position.symbol, side, type, reason, price, quantity, fee, time};
+    if (account.fillCallback)
+    {
+        account.fillCallback(event);
+    }
+    if (recordHistory)
+    {
+        result.fills.push_back(std::move(event));
+    }
+    return fee;
+}
+
+void FillSimulator::trackExcursion(double price)
+{
+    if (!position.open)
+    {
+        return;
+    }
+    bool isLong = position.side == OrderSide::BUY;
+    position.worstPrice = isLong ? std::min(position.worstPrice, price) : std::max(position.worstPrice, price);
+    position.bestPrice = isLong ? std::max(position.bestPrice, price) : std::min(position.bestPrice, price);
+}
+
+void FillSimulator::trackExcursion(const PathPoint& point)
+{
+    // Longs exit by selling, shorts by buying back
+    trackExcursion(position.side == OrderSide::BUY ? point.sell : point.buy);
+}
+
+void FillSimulator::mark()
+{
+    // Long positions are worth what they sell for, shorts what they cost to buy back
+    markAt(position.side == OrderSide::BUY ? last.sell : last.buy);
+}
+
+void FillSimulator::markAt(double price)
+{
+    double value = 0;
+    double exposure = 0;
+    if (position.open)
+    {
+        exposure = position.quantity * price;
+        value = position.side == OrderSide::BUY ? exposure : -exposure;
+    }
+    account.positionsValue += value - markedValue;
+    account.exposure += exposure - markedExposure;
+    markedValue = value;
+    markedExposure = exposure;
+}
@@ -0,0 +1,182 @@
+#include "history_downloader.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <thread>
+#include "http_engine.h"
+
+namespace {
+    void printProgress(const DownloadProgress& progress) {
+        // Roughly every 10% and at the end
+        size_t step = std::max<size_t>(progress.pagesTotal / 10, 1);
+        if (progress.pagesDone % step == 0 || progress.pagesDone == progress.pagesTotal) {
+            std::cout << "Downloaded " << progress.pagesDone << "/" << progress.pagesTotal
+                      << " pages (" << progress.bars << " bars)" << std::endl;
+        }
+    }
+}
+
+RateLimiter::RateLimiter(double requestsPerSecond)
+    : interval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(requestsPerSecond > 0 ? 1.0 / requestsPerSecond : 0.0))),
+      nextSlot(std::chrono::steady_clock::now()) {
+}
+
+void RateLimiter::acquire() {
+    std::chrono::steady_clock::time_point slot;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto now = std::chrono::steady_clock::now();
+        slot = std::max(nextSlot, now);
+        nextSlot = slot + interval;
+    }
+    std::this_thread::sleep_until(slot);
+}
+
+void RateLimiter::pause(std::chrono::steady_clock::duration duration) {
+    std::lock_guard<std::mutex> lock(mutex);
+    nextSlot = std::max(nextSlot, std::chrono::steady_clock::now() + duration);
+}
+
+HistoryDownloader::HistoryDownloader(size_t maxInFlight, double requestsPerSecond)
+    : maxInFlight(std::max<size_t>(maxInFlight, 1)),
+      requestsPerSecond(requestsPerSecond),
+      progressCallback(printProgress) {
+}
+
+void HistoryDownloader::setProgressCallback(ProgressCallback callback) {
+    progressCallback = std::move(callback);
+}
+
+void HistoryDownloader::setMaxRetries(int retries) {
+    maxRetries = std::max(retries, 0);
+}
+
+std::time_t HistoryDownloader::timeframeSeconds(const std::string& timeframe) {
+    if (timeframe == "1m") return 60;
+    if (timeframe == "5m") return 5 * 60;
+    if (timeframe == "15m") return 15 * 60;
+    if (timeframe == "30m") return 30 * 60;
+    if (timeframe == "1h") return 60 * 60;
+    if (timeframe == "4h") return 4 * 60 * 60;
+    if (timeframe == "1d") return 24 * 60 * 60;
+    return 0;
+}
+
+bool HistoryDownloader::download(std::time_t startTime, std::time_t endTime, std::time_t barSeconds, size_t pageSize,
+                                 const PageUrl& pageUrl, const PageParser& parsePage, std::vector<OHLCV>& bars) {
+    bars.clear();
+    if (startTime > endTime || barSeconds <= 0 || pageSize == 0) {
+        return false;
+    }
+
+    // Page windows on the bar grid, pageSize bars each
+    std::vector<std::pair<std::time_t, std::time_t>> pages;
+    std::time_t firstBar = startTime - startTime % barSeconds;
+    std::time_t pageSpan = barSeconds * static_cast<std::time_t>(pageSize);
+    for (std::time_t pageStart = firstBar; pageStart <= endTime; pageStart += pageSpan) {
+        pages.emplace_back(pageStart, std::min(pageStart + pageSpan - barSeconds, endTime));
+    }
+
+    RateLimiter limiter(requestsPerSecond);
+    DownloadProgress progress;
+    progress.pagesTotal = pages.size();
+    bool reportProgress = progressCallback && pages.size() > 1;
+
+    std::deque<size_t> pending;
+    for (size_t page = 0; page < pages.size(); page++) {
+        pending.push_back(page);
+    }
+    std::vector<int> attempts(pages.size(), 0);
+
+    // Responses arrive on the engine's I/O thread, parsing happens here
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    std::deque<std::pair<size_t, HttpResponse>> done;
+
+    std::vector<OHLCV> result;
+    size_t inFlight = 0;
+    size_t finished = 0;
+    bool failed = false;
+    while (finished < pages.size()) {
+        while (inFlight < maxInFlight && !pending.empty()) {
+            size_t page = pending.front();
+            pending.pop_front();
+            limiter.acquire();
+
+            HttpRequest request;
+            request.url = pageUrl(pages[page].first, pages[page].second);
+            HttpEngine::instance().send(std::move(request), [&, page](HttpResponse response) {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                done.emplace_back(page, std::move(response));
+                doneCondition.notify_one();
+            });
+            inFlight++;
+        }
+
+        std::pair<size_t, HttpResponse> completed;
+        {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            doneCondition.wait(lock, [&done]() { return !done.empty(); });
+            completed = std::move(done.front());
+            done.pop_front();
+        }
+        inFlight--;
+
+        size_t page = completed.first;
+        const HttpResponse& response = completed.second;
+        std::vector<OHLCV> pageBars;
+        bool ok = response.ok() && parsePage(response.body, pageBars);
+        if (!ok) {
+            if (!response.error.empty()) {
+                std::cerr << "Candle request failed: " << response.error << std::endl;
+            } else if (response.status != 200) {
+                std::cerr << "Candle request failed: HTTP " << response.status << std::endl;
+            }
+            if (!failed && attempts[page]++ < maxRetries) {
+                // Back off everything, the usual cause is the exchange's rate limit
+                limiter.pause(std::chrono::milliseconds(500 << (attempts[page] - 1)));
+                pending.push_back(page);
+                continue;
+            }
+            if (!failed) {
+                std::cerr << "Giving up on candles " << pages[page].first << " - " << pages[page].second << std::endl;
+                // Nothing else is sent, the requests in flight still have to
+                // come back before the locals their callbacks use go away
+                failed = true;
+                finished += pending.size();
+                pending.clear();
+            }
+        }
+
+        finished++;
+        if (failed) {
+            continue;
+        }
+        progress.pagesDone++;
+        progress.bars += pageBars.size();
+        result.insert(result.end(), std::make_move_iterator(pageBars.begin()), std::make_move_iterator(pageBars.end()));
+        if (reportProgress) {
+            progressCallback(progress);
+        }
+    }
+
+    if (failed) {
+        std::cerr << "Candle download of " << startTime << " - " << endTime << " is incomplete, discarded" << std::endl;
+        return false;
+    }
+
+    // Pages overlap at their edges when an exchange ignores exact bounds
+    std::stable_sort(result.begin(), result.end(), [](const OHLCV& a, const OHLCV& b) {
+        return a.timestamp < b.timestamp;
+    });
+    result.erase(std::unique(result.begin(), result.end(), [](const OHLCV& a, const OHLCV& b) {
+        return a.timestamp == b.timestamp;
+    }), result.end());
+    result.erase(std::remove_if(result.begin(), result.end(), [firstBar, endTime](const OHLCV& bar) {
+        return bar.timestamp < firstBar || bar.timestamp > endTime;
+    }), result.end());
+    bars = std::move(result);
+    return true;
+}
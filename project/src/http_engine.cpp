@@ -0,0 +1,224 @@
+#include "http_engine.h"
+#include <iostream>
+
+namespace {
+    // Finished handles kept for reuse, beyond that they are freed
+    const size_t kMaxIdleHandles = 64;
+
+    size_t writeCallback(void* contents, size_t size, size_t nmemb, std::string* s) {
+        size_t newLength = size * nmemb;
+        try {
+            s->append(static_cast<char*>(contents), newLength);
+            return newLength;
+        } catch (const std::bad_alloc&) {
+            return 0;
+        }
+    }
+}
+
+struct HttpEngine::Transfer
+{
+    HttpRequest request;
+    HttpResponse response;
+    Callback callback;
+    curl_slist* headers = nullptr;
+};
+
+HttpEngine::HttpEngine(long maxConnectionsPerHost)
+    : running(true) {
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    // DNS results and TLS sessions are shared by every transfer. The share
+    // is only touched from the I/O thread, so it needs no lock callbacks.
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    // The multi handle owns the connection cache, connections stay open
+    // after a transfer and are picked up by the next one to the same host
+    multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, maxConnectionsPerHost);
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, 64L);
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    ioThread = std::thread(&HttpEngine::eventLoop, this);
+}
+
+HttpEngine::~HttpEngine() {
+    running = false;
+    curl_multi_wakeup(multi);
+    if (ioThread.joinable()) {
+        ioThread.join();
+    }
+
+    for (CURL* easy : idleHandles) {
+        curl_easy_cleanup(easy);
+    }
+    curl_multi_cleanup(multi);
+    curl_share_cleanup(share);
+    curl_global_cleanup();
+}
+
+HttpEngine& HttpEngine::instance() {
+    static HttpEngine engine;
+    return engine;
+}
+
+std::future<HttpResponse> HttpEngine::send(HttpRequest request) {
+    auto promise = std::make_shared<std::promise<HttpResponse>>();
+    std::future<HttpResponse> result = promise->get_future();
+    send(std::move(request), [promise](HttpResponse response) {
+        promise->set_value(std::move(response));
+    });
+    return result;
+}
+
+void HttpEngine::send(HttpRequest request, Callback callback) {
+    auto transfer = std::make_unique<Transfer>();
+    transfer->request = std::move(request);
+    transfer->callback = std::move(callback);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.push_back(std::move(transfer));
+    }
+    curl_multi_wakeup(multi);
+}
+
+HttpResponse HttpEngine::perform(HttpRequest request) {
+    if (std::this_thread::get_id() == ioThread.get_id()) {
+        // Waiting here would stall the loop that has to complete the request
+        HttpResponse response;
+        response.error = "blocking request from an HTTP engine callback";
+        std::cerr << "HTTP engine: " << response.error << std::endl;
+        return response;
+    }
+    return send(std::move(request)).get();
+}
+
+void HttpEngine::eventLoop() {
+    while (running) {
+        std::deque<std::unique_ptr<Transfer>> incoming;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            incoming.swap(queue);
+        }
+        for (auto& transfer : incoming) {
+            startTransfer(std::move(transfer));
+        }
+
+        int stillRunning = 0;
+        curl_multi_perform(multi, &stillRunning);
+
+        CURLMsg* message = nullptr;
+        int messagesLeft = 0;
+        while ((message = curl_multi_info_read(multi, &messagesLeft))) {
+            if (message->msg == CURLMSG_DONE) {
+                finishTransfer(message->easy_handle, message->data.result);
+            }
+        }
+
+        // Sleeps until a socket is ready, a timeout is due or send() wakes us
+        curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+    }
+
+    // Shutting down: fail whatever is still queued or in flight
+    std::deque<std::unique_ptr<Transfer>> leftover;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        leftover.swap(queue);
+    }
+    for (auto& transfer : leftover) {
+        transfer->response.error = "HTTP engine stopped";
+        transfer->callback(std::move(transfer->response));
+    }
+    int handleCount = 0;
+    CURL** handles = curl_multi_get_handles(multi);
+    for (CURL** handle = handles; handle && *handle; handle++) {
+        handleCount++;
+    }
+    for (int i = 0; i < handleCount; i++) {
+        finishTransfer(handles[i], CURLE_ABORTED_BY_CALLBACK);
+    }
+    curl_free(handles);
+}
+
+void HttpEngine::startTransfer(std::unique_ptr<Transfer> transfer) {
+    CURL* easy = nullptr;
+    if (!idleHandles.empty()) {
+        easy = idleHandles.back();
+        idleHandles.pop_back();
+    } else {
+        easy = curl_easy_init();
+    }
+    if (!easy) {
+        transfer->response.error = "CURL not initialized";
+        transfer->callback(std::move(transfer->response));
+        return;
+    }
+
+    const HttpRequest& request = transfer->request;
+    for (const std::string& header : request.headers) {
+        transfer->headers = curl_slist_append(transfer->headers, header.c_str());
+    }
+
+    curl_easy_setopt(easy, CURLOPT_SHARE, share);
+    curl_easy_setopt(easy, CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, writeCallback);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, &transfer->response.body);
+    curl_easy_setopt(easy, CURLOPT_HTTPHEADER, transfer->headers);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, request.timeoutMs);
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, "");
+
+    if (request.method == "POST") {
+        curl_easy_setopt(easy, CURLOPT_POST, 1L);
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, static_cast<long>(request.body.size()));
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, request.body.c_str());
+    } else if (request.method != "GET") {
+        curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+        if (!request.body.empty()) {
+            curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, static_cast<long>(request.body.size()));
+            curl_easy_setopt(easy, CURLOPT_POSTFIELDS, request.body.c_str());
+        }
+    }
+
+    // The transfer is owned by the handle until finishTransfer
+    Transfer* raw = transfer.release();
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, raw);
+    if (curl_multi_add_handle(multi, easy) != CURLM_OK) {
+        finishTransfer(easy, CURLE_FAILED_INIT);
+    }
+}
+
+void HttpEngine::finishTransfer(CURL* easy, CURLcode result) {
+    Transfer* raw = nullptr;
+    curl_easy_getinfo(easy, CURLINFO_PRIVATE, &raw);
+    std::unique_ptr<Transfer> transfer(raw);
+    if (transfer) {
+        if (result == CURLE_OK) {
+            curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &transfer->response.status);
+        } else {
+            transfer->response.error = curl_easy_strerror(result);
+        }
+    }
+
+    curl_multi_remove_handle(multi, easy);
+    curl_easy_reset(easy);
+    if (idleHandles.size() < kMaxIdleHandles) {
+        idleHandles.push_back(easy);
+    } else {
+        curl_easy_cleanup(easy);
+    }
+    if (!transfer) {
+        return;
+    }
+
+    curl_slist_free_all(transfer->headers);
+    transfer->headers = nullptr;
+    try {
+        transfer->callback(std::move(transfer->response));
+    } catch (const std::exception& e) {
+        std::cerr << "HTTP engine callback failed: " << e.what() << std::endl;
+    }
+}
@@ -0,0 +1,151 @@
+#include "indicator_cache.h"
+#include <cstring>
+#include <tuple>
+#include "indicators.h"
+
+namespace {
+    const uint64_t kHashMultiplier = 0x9E3779B97F4A7C15ULL;
+
+    template <typename T>
+    void hashColumn(uint64_t& hash, std::span<const T> column) {
+        static_assert(sizeof(T) == sizeof(uint64_t));
+        for (const T& value : column) {
+            uint64_t word;
+            std::memcpy(&word, &value, sizeof(word));
+            hash = (hash ^ word) * kHashMultiplier;
+            hash ^= hash >> 29;
+        }
+    }
+}
+
+bool IndicatorCache::Key::operator<(const Key& other) const {
+    return std::tie(dataset, indicator, params) < std::tie(other.dataset, other.indicator, other.params);
+}
+
+IndicatorCache::IndicatorCache(size_t budget) : memoryBudget(budget) {
+}
+
+uint64_t IndicatorCache::datasetId(const BarSeriesView& bars) {
+    uint64_t hash = kHashMultiplier ^ bars.size();
+    hashColumn(hash, bars.timestamp());
+    hashColumn(hash, bars.open());
+    hashColumn(hash, bars.high());
+    hashColumn(hash, bars.low());
+    hashColumn(hash, bars.close());
+    hashColumn(hash, bars.volume());
+    // Final avalanche so ids of similar bars spread over all bits
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+IndicatorCache::Column IndicatorCache::get(uint64_t dataset, const std::string& indicator,
+                                           const std::vector<double>& params,
+                                           const std::function<std::vector<double>()>& compute) {
+    Key key{dataset, indicator, params};
+    std::promise<Column> promise;
+    std::shared_future<Column> pending;
+    std::map<Key, Entry>::iterator it;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        it = entries.find(key);
+        if (it != entries.end()) {
+            stats.hits++;
+            recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, it->second.recent);
+            pending = it->second.value;
+        } else {
+            stats.misses++;
+            it = entries.emplace(std::move(key), Entry{}).first;
+            it->second.value = promise.get_future().share();
+            recentlyUsed.push_front(&it->first);
+            it->second.recent = recentlyUsed.begin();
+            stats.entries = entries.size();
+        }
+    }
+    if (pending.valid()) {
+        // Blocks only while the first caller is still computing it
+        return pending.get();
+    }
+
+    // Computed without the lock so other keys are served meanwhile. Entries
+    // being computed are never evicted or cleared, `it` stays valid.
+    try {
+        Column column = std::make_shared<const std::vector<double>>(compute());
+        promise.set_value(column);
+        std::lock_guard<std::mutex> lock(mutex);
+        it->second.bytes = sizeof(std::vector<double>) + column->capacity() * sizeof(double);
+        stats.bytes += it->second.bytes;
+        if (memoryBudget > 0) {
+            evictTo(memoryBudget);
+        }
+        return column;
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> lock(mutex);
+        recentlyUsed.erase(it->second.recent);
+        entries.erase(it);
+        stats.entries = entries.size();
+        throw;
+    }
+}
+
+IndicatorCache::Column IndicatorCache::trueRange(const BarSeriesView& bars, uint64_t dataset) {
+    return get(dataset, "trueRange", {}, [&bars]() { return Indicators::trueRange(bars); });
+}
+
+IndicatorCache::Column IndicatorCache::atr(const BarSeriesView& bars, uint64_t dataset, int period) {
+    return get(dataset, "atrSMA", {static_cast<double>(period)}, [this, &bars, dataset, period]() {
+        Column trueRanges = trueRange(bars, dataset);
+        return Indicators::atrSMA(*trueRanges, period, true);
+    });
+}
+
+IndicatorCache::Column IndicatorCache::trendMask(const BarSeriesView& bars, uint64_t dataset, int lookback) {
+    return get(dataset, "trendMask", {static_cast<double>(lookback)}, [&bars, lookback]() {
+        std::vector<uint8_t> mask = Indicators::trendMask(bars.high(), bars.low(), lookback);
+        return std::vector<double>(mask.begin(), mask.end());
+    });
+}
+
+IndicatorCache::Column IndicatorCache::rangeExpansionMask(const BarSeriesView& bars, uint64_t dataset,
+                                                          int window, double factor) {
+    return get(dataset, "rangeExpansionMask", {static_cast<double>(window), factor}, [&bars, window, factor]() {
+        std::vector<uint8_t> mask = Indicators::rangeExpansionMask(bars.high(), bars.low(), window, factor);
+        return std::vector<double>(mask.begin(), mask.end());
+    });
+}
+
+void IndicatorCache::setMemoryBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    memoryBudget = bytes;
+    if (memoryBudget > 0) {
+        evictTo(memoryBudget);
+    }
+}
+
+IndicatorCacheStats IndicatorCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void IndicatorCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    evictTo(0);
+}
+
+void IndicatorCache::evictTo(size_t bytes) {
+    auto it = recentlyUsed.end();
+    while (stats.bytes > bytes && it != recentlyUsed.begin()) {
+        --it;
+        auto entry = entries.find(**it);
+        if (entry->second.bytes == 0) {
+            continue;
+        }
+        stats.bytes -= entry->second.bytes;
+        stats.evictions++;
+        it = recentlyUsed.erase(it);
+        entries.erase(entry);
+    }
+    stats.entries = entries.size();
+}
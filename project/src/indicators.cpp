@@ -0,0 +1,636 @@
+#include "indicators.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define INDICATORS_X86 1
+#include <immintrin.h>
+#else
+#define INDICATORS_X86 0
+#endif
+
+namespace {
+
+// Windows wider than this use the O(n) monotonic deque instead of the
+// O(n * window) vector scan
+const size_t kMaxDirectWindow = 64;
+
+// Outputs per sliding sum block, each block starts from a full window sum
+const size_t kSumBlock = 256;
+
+// ---------------------------------------------------------------------------
+// Scalar kernels, each fills out[begin, end)
+// ---------------------------------------------------------------------------
+
+// out[i] = v[i - offset] + v[i - offset - 1] + ... (window terms, newest first)
+void windowSumScalar(const double* v, size_t begin, size_t end, size_t window, size_t offset, double* out) {
+    for (size_t i = begin; i < end; i++) {
+        double sum = 0.0;
+        for (size_t k = 0; k < window; k++) {
+            sum += v[i - offset - k];
+        }
+        out[i] = sum;
+    }
+}
+
+// Same sums sliding through out[first, last): the first is summed newest
+// first, each following one adds v[i - offset] and drops v[i - offset - window]
+void slidingSumBlockScalar(const double* v, size_t first, size_t last, size_t window, size_t offset,
+                           double* out) {
+    double sum = 0.0;
+    for (size_t k = 0; k < window; k++) {
+        sum += v[first - offset - k];
+    }
+    out[first] = sum;
+    for (size_t i = first + 1; i < last; i++) {
+        sum += v[i - offset] - v[i - offset - window];
+        out[i] = sum;
+    }
+}
+
+// Blocks of kSumBlock outputs counted from begin
+void slidingSumScalar(const double* v, size_t begin, size_t end, size_t window, size_t offset, double* out) {
+    for (size_t first = begin; first < end; first += kSumBlock) {
+        slidingSumBlockScalar(v, first, std::min(first + kSumBlock, end), window, offset, out);
+    }
+}
+
+void windowMaxScalar(const double* v, size_t begin, size_t end, size_t window, double* out) {
+    for (size_t i = begin; i < end; i++) {
+        double m = v[i];
+        for (size_t k = 1; k < window; k++) {
+            m = std::max(m, v[i - k]);
+        }
+        out[i] = m;
+    }
+}
+
+void windowMinScalar(const double* v, size_t begin, size_t end, size_t window, double* out) {
+    for (size_t i = begin; i < end; i++) {
+        double m = v[i];
+        for (size_t k = 1; k < window; k++) {
+            m = std::min(m, v[i - k]);
+        }
+        out[i] = m;
+    }
+}
+
+// begin >= 1, close[i - 1] is the previous close
+void trueRangeScalar(const double* high, const double* low, const double* close,
+                     size_t begin, size_t end, double* out) {
+    for (size_t i = begin; i < end; i++) {
+        double trueHigh = std::max(high[i], close[i - 1]);
+        double trueLow = std::min(low[i], close[i - 1]);
+        out[i] = trueHigh - trueLow;
+    }
+}
+
+void differenceScalar(const double* a, const double* b, size_t begin, size_t end, double* out) {
+    for (size_t i = begin; i < end; i++) {
+        out[i] = a[i] - b[i];
+    }
+}
+
+void divideScalar(const double* a, double divisor, size_t begin, size_t end, double* out) {
+    for (size_t i = begin; i < end; i++) {
+        out[i] = a[i] / divisor;
+    }
+}
+
+// begin >= 1: up = higher high and higher low, down = lower high and lower low
+void trendFlagsScalar(const double* high, const double* low, size_t begin, size_t end,
+                      uint8_t* up, uint8_t* down) {
+    for (size_t i = begin; i < end; i++) {
+        up[i] = (high[i] > high[i - 1] && low[i] > low[i - 1]) ? 1 : 0;
+        down[i] = (high[i] < high[i - 1] && low[i] < low[i - 1]) ? 1 : 0;
+    }
+}
+
+#if INDICATORS_X86
+// ---------------------------------------------------------------------------
+// SSE2 kernels, 2 bars per step
+// ---------------------------------------------------------------------------
+
+__attribute__((target("sse2")))
+void windowSumSSE2(const double* v, size_t begin, size_t end, size_t window, size_t offset, double* out) {
+    size_t i = begin;
+    for (; i + 2 <= end; i += 2) {
+        __m128d sum = _mm_setzero_pd();
+        for (size_t k = 0; k < window; k++) {
+            sum = _mm_add_pd(sum, _mm_loadu_pd(v + i - offset - k));
+        }
+        _mm_storeu_pd(out + i, sum);
+    }
+    windowSumScalar(v, i, end, window, offset, out);
+}
+
+// One block per lane, lane 1 is kSumBlock outputs after lane 0. The lanes
+// load two steps of their own block at a time and swap them into per-step
+// vectors, so each lane adds in the scalar order.
+__attribute__((target("sse2")))
+void slidingSumSSE2(const double* v, size_t begin, size_t end, size_t window, size_t offset, double* out) {
+    size_t first = begin;
+    for (; first + 2 * kSumBlock <= end; first += 2 * kSumBlock) {
+        const double* p0 = v + first - offset;
+        const double* p1 = p0 + kSumBlock;
+        double* o0 = out + first;
+        double* o1 = o0 + kSumBlock;
+        __m128d sum = _mm_setzero_pd();
+        for (size_t k = 0; k < window; k++) {
+            sum = _mm_add_pd(sum, _mm_set_pd(p1[-static_cast<ptrdiff_t>(k)], p0[-static_cast<ptrdiff_t>(k)]));
+        }
+        _mm_storel_pd(o0, sum);
+        _mm_storeh_pd(o1, sum);
+        size_t t = 1;
+        for (; t + 2 <= kSumBlock; t += 2) {
+            __m128d d0 = _mm_sub_pd(_mm_loadu_pd(p0 + t), _mm_loadu_pd(p0 + t - window));
+            __m128d d1 = _mm_sub_pd(_mm_loadu_pd(p1 + t), _mm_loadu_pd(p1 + t - window));
+            __m128d r0 = _mm_add_pd(sum, _mm_unpacklo_pd(d0, d1));
+            sum = _mm_add_pd(r0, _mm_unpackhi_pd(d0, d1));
+            _mm_storeu_pd(o0 + t, _mm_unpacklo_pd(r0, sum));
+            _mm_storeu_pd(o1 + t, _mm_unpackhi_pd(r0, sum));
+        }
+        for (; t < kSumBlock; t++) {
+            __m128d added = _mm_set_pd(p1[t], p0[t]);
+            __m128d dropped = _mm_set_pd(p1[t - window], p0[t - window]);
+            sum = _mm_add_pd(sum, _mm_sub_pd(added, dropped));
+            _mm_storel_pd(o0 + t, sum);
+            _mm_storeh_pd(o1 + t, sum);
+        }
+    }
+    slidingSumScalar(v, first, end, window, offset, out);
+}
+
+__attribute__((target("sse2")))
+void windowMaxSSE2(const double* v, size_t begin, size_t end, size_t window, double* out) {
+    size_t i = begin;
+    for (; i + 2 <= end; i += 2) {
+        __m128d m = _mm_loadu_pd(v + i);
+        for (size_t k = 1; k < window; k++) {
+            m = _mm_max_pd(m, _mm_loadu_pd(v + i - k));
+        }
+        _mm_storeu_pd(out + i, m);
+    }
+    windowMaxScalar(v, i, end, window, out);
+}
+
+__attribute__((target("sse2")))
+void windowMinSSE2(const double* v, size_t begin, size_t end, size_t window, double* out) {
+    size_t i = begin;
+    for (; i + 2 <= end; i += 2) {
+        __m128d m = _mm_loadu_pd(v + i);
+        for (size_t k = 1; k < window; k++) {
+            m = _mm_min_pd(m, _mm_loadu_pd(v + i - k));
+        }
+        _mm_storeu_pd(out + i, m);
+    }
+    windowMinScalar(v, i, end, window, out);
+}
+
+__attribute__((target("sse2")))
+void trueRangeSSE2(const double* high, const double* low, const double* close,
+                   size_t begin, size_t end, double* out) {
+    size_t i = begin;
+    for (; i + 2 <= end; i += 2) {
+        __m128d previousClose = _mm_loadu_pd(close + i - 1);
+        __m128d trueHigh = _mm_max_pd(_mm_loadu_pd(high + i), previousClose);
+        __m128d trueLow = _mm_min_pd(_mm_loadu_pd(low + i), previousClose);
+        _mm_storeu_pd(out + i, _mm_sub_pd(trueHigh, trueLow));
+    }
+    trueRangeScalar(high, low, close, i, end, out);
+}
+
+__attribute__((target("sse2")))
+void differenceSSE2(const double* a, const double* b, size_t begin, size_t end, double* out) {
+    size_t i = begin;
+    for (; i + 2 <= end; i += 2) {
+        _mm_storeu_pd(out + i, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    differenceScalar(a, b, i, end, out);
+}
+
+__attribute__((target("sse2")))
+void divideSSE2(const double* a, double divisor, size_t begin, size_t end, double* out) {
+    __m128d d = _mm_set1_pd(divisor);
+    size_t i = begin;
+    for (; i + 2 <= end; i += 2) {
+        _mm_storeu_pd(out + i, _mm_div_pd(_mm_loadu_pd(a + i), d));
+    }
+    divideScalar(a, divisor, i, end, out);
+}
+
+__attribute__((target("sse2")))
+void trendFlagsSSE2(const double* high, const double* low, size_t begin, size_t end,
+                    uint8_t* up, uint8_t* down) {
+    size_t i = begin;
+    for (; i + 2 <= end; i += 2) {
+        __m128d h = _mm_loadu_pd(high + i);
+        __m128d hPrev = _mm_loadu_pd(high + i - 1);
+        __m128d l = _mm_loadu_pd(low + i);
+        __m128d lPrev = _mm_loadu_pd(low + i - 1);
+        int upBits = _mm_movemask_pd(_mm_and_pd(_mm_cmpgt_pd(h, hPrev), _mm_cmpgt_pd(l, lPrev)));
+        int downBits = _mm_movemask_pd(_mm_and_pd(_mm_cmplt_pd(h, hPrev), _mm_cmplt_pd(l, lPrev)));
+        for (int lane = 0; lane < 2; lane++) {
+            up[i + lane] = (upBits >> lane) & 1;
+            down[i + lane] = (downBits >> lane) & 1;
+        }
+    }
+    trendFlagsScalar(high, low, i, end, up, down);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2 kernels, 4 bars per step
+// ---------------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+void windowSumAVX2(const double* v, size_t begin, size_t end, size_t window, size_t offset, double* out) {
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m256d sum = _mm256_setzero_pd();
+        for (size_t k = 0; k < window; k++) {
+            sum = _mm256_add_pd(sum, _mm256_loadu_pd(v + i - offset - k));
+        }
+        _mm256_storeu_pd(out + i, sum);
+    }
+    windowSumScalar(v, i, end, window, offset, out);
+}
+
+// Rows a..d become columns and back
+__attribute__((target("avx2")))
+inline void transpose4(__m256d& a, __m256d& b, __m256d& c, __m256d& d) {
+    __m256d ab0 = _mm256_unpacklo_pd(a, b);
+    __m256d ab1 = _mm256_unpackhi_pd(a, b);
+    __m256d cd0 = _mm256_unpacklo_pd(c, d);
+    __m256d cd1 = _mm256_unpackhi_pd(c, d);
+    a = _mm256_permute2f128_pd(ab0, cd0, 0x20);
+    b = _mm256_permute2f128_pd(ab1, cd1, 0x20);
+    c = _mm256_permute2f128_pd(ab0, cd0, 0x31);
+    d = _mm256_permute2f128_pd(ab1, cd1, 0x31);
+}
+
+// One block per lane, lanes kSumBlock outputs apart, four steps at a time
+// as in the SSE2 version
+__attribute__((target("avx2")))
+void slidingSumAVX2(const double* v, size_t begin, size_t end, size_t window, size_t offset, double* out) {
+    size_t first = begin;
+    for (; first + 4 * kSumBlock <= end; first += 4 * kSumBlock) {
+        const double* p = v + first - offset;
+        double* o = out + first;
+        __m256d sum = _mm256_setzero_pd();
+        for (size_t k = 0; k < window; k++) {
+            const double* q = p - k;
+            sum = _mm256_add_pd(sum, _mm256_set_pd(q[3 * kSumBlock], q[2 * kSumBlock], q[kSumBlock], q[0]));
+        }
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, sum);
+        for (size_t lane = 0; lane < 4; lane++) {
+            o[lane * kSumBlock] = lanes[lane];
+        }
+        size_t t = 1;
+        for (; t + 4 <= kSumBlock; t += 4) {
+            __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(p + t), _mm256_loadu_pd(p + t - window));
+            __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(p + kSumBlock + t), _mm256_loadu_pd(p + kSumBlock + t - window));
+            __m256d d2 = _mm256_sub_pd(_mm256_loadu_pd(p + 2 * kSumBlock + t),
+                                       _mm256_loadu_pd(p + 2 * kSumBlock + t - window));
+            __m256d d3 = _mm256_sub_pd(_mm256_loadu_pd(p + 3 * kSumBlock + t),
+                                       _mm256_loadu_pd(p + 3 * kSumBlock + t - window));
+            transpose4(d0, d1, d2, d3);
+            d0 = _mm256_add_pd(sum, d0);
+            d1 = _mm256_add_pd(d0, d1);
+            d2 = _mm256_add_pd(d1, d2);
+            d3 = _mm256_add_pd(d2, d3);
+            sum = d3;
+            transpose4(d0, d1, d2, d3);
+            _mm256_storeu_pd(o + t, d0);
+            _mm256_storeu_pd(o + kSumBlock + t, d1);
+            _mm256_storeu_pd(o + 2 * kSumBlock + t, d2);
+            _mm256_storeu_pd(o + 3 * kSumBlock + t, d3);
+        }
+        for (; t < kSumBlock; t++) {
+            const double* q = p + t;
+            __m256d added = _mm256_set_pd(q[3 * kSumBlock], q[2 * kSumBlock], q[kSumBlock], q[0]);
+            q -= window;
+            __m256d dropped = _mm256_set_pd(q[3 * kSumBlock], q[2 * kSumBlock], q[kSumBlock], q[0]);
+            sum = _mm256_add_pd(sum, _mm256_sub_pd(added, dropped));
+            _mm256_store_pd(lanes, sum);
+            for (size_t lane = 0; lane < 4; lane++) {
+                o[lane * kSumBlock + t] = lanes[lane];
+            }
+        }
+    }
+    slidingSumScalar(v, first, end, window, offset, out);
+}
+
+__attribute__((target("avx2")))
+void windowMaxAVX2(const double* v, size_t begin, size_t end, size_t window, double* out) {
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m256d m = _mm256_loadu_pd(v + i);
+        for (size_t k = 1; k < window; k++) {
+            m = _mm256_max_pd(m, _mm256_loadu_pd(v + i - k));
+        }
+        _mm256_storeu_pd(out + i, m);
+    }
+    windowMaxScalar(v, i, end, window, out);
+}
+
+__attribute__((target("avx2")))
+void windowMinAVX2(const double* v, size_t begin, size_t end, size_t window, double* out) {
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m256d m = _mm256_loadu_pd(v + i);
+        for (size_t k = 1; k < window; k++) {
+            m = _mm256_min_pd(m, _mm256_loadu_pd(v + i - k));
+        }
+        _mm256_storeu_pd(out + i, m);
+    }
+    windowMinScalar(v, i, end, window, out);
+}
+
+__attribute__((target("avx2")))
+void trueRangeAVX2(const double* high, const double* low, const double* close,
+                   size_t begin, size_t end, double* out) {
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m256d previousClose = _mm256_loadu_pd(close + i - 1);
+        __m256d trueHigh = _mm256_max_pd(_mm256_loadu_pd(high + i), previousClose);
+        __m256d trueLow = _mm256_min_pd(_mm256_loadu_pd(low + i), previousClose);
+        _mm256_storeu_pd(out + i, _mm256_sub_pd(trueHigh, trueLow));
+    }
+    trueRangeScalar(high, low, close, i, end, out);
+}
+
+__attribute__((target("avx2")))
+void differenceAVX2(const double* a, const double* b, size_t begin, size_t end, double* out) {
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    differenceScalar(a, b, i, end, out);
+}
+
+__attribute__((target("avx2")))
+void divideAVX2(const double* a, double divisor, size_t begin, size_t end, double* out) {
+    __m256d d = _mm256_set1_pd(divisor);
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_div_pd(_mm256_loadu_pd(a + i), d));
+    }
+    divideScalar(a, divisor, i, end, out);
+}
+
+__attribute__((target("avx2")))
+void trendFlagsAVX2(const double* high, const double* low, size_t begin, size_t end,
+                    uint8_t* up, uint8_t* down) {
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m256d h = _mm256_loadu_pd(high + i);
+        __m256d hPrev = _mm256_loadu_pd(high + i - 1);
+        __m256d l = _mm256_loadu_pd(low + i);
+        __m256d lPrev = _mm256_loadu_pd(low + i - 1);
+        int upBits = _mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(h, hPrev, _CMP_GT_OQ),
+                                                      _mm256_cmp_pd(l, lPrev, _CMP_GT_OQ)));
+        int downBits = _mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(h, hPrev, _CMP_LT_OQ),
+                                                        _mm256_cmp_pd(l, lPrev, _CMP_LT_OQ)));
+        for (int lane = 0; lane < 4; lane++) {
+            up[i + lane] = (upBits >> lane) & 1;
+            down[i + lane] = (downBits >> lane) & 1;
+        }
+    }
+    trendFlagsScalar(high, low, i, end, up, down);
+}
+#endif // INDICATORS_X86
+
+// ---------------------------------------------------------------------------
+// Dispatch
+// ---------------------------------------------------------------------------
+
+struct Kernels {
+    void (*windowSum)(const double*, size_t, size_t, size_t, size_t, double*);
+    void (*slidingSum)(const double*, size_t, size_t, size_t, size_t, double*);
+    void (*windowMax)(const double*, size_t, size_t, size_t, double*);
+    void (*windowMin)(const double*, size_t, size_t, size_t, double*);
+    void (*trueRange)(const double*, const double*, const double*, size_t, size_t, double*);
+    void (*difference)(const double*, const double*, size_t, size_t, double*);
+    void (*divide)(const double*, double, size_t, size_t, double*);
+    void (*trendFlags)(const double*, const double*, size_t, size_t, uint8_t*, uint8_t*);
+};
+
+const Kernels kScalarKernels = {
+    windowSumScalar, slidingSumScalar, windowMaxScalar, windowMinScalar, trueRangeScalar, differenceScalar,
+    divideScalar, trendFlagsScalar
+};
+#if INDICATORS_X86
+const Kernels kSSE2Kernels = {
+    windowSumSSE2, slidingSumSSE2, windowMaxSSE2, windowMinSSE2, trueRangeSSE2, differenceSSE2, divideSSE2,
+    trendFlagsSSE2
+};
+const Kernels kAVX2Kernels = {
+    windowSumAVX2, slidingSumAVX2, windowMaxAVX2, windowMinAVX2, trueRangeAVX2, differenceAVX2, divideAVX2,
+    trendFlagsAVX2
+};
+#endif
+
+std::atomic<int> activeLevel{-1};
+
+const Kernels& kernels() {
+    switch (Indicators::getSimdLevel()) {
+#if INDICATORS_X86
+        case SimdLevel::AVX2:
+            return kAVX2Kernels;
+        case SimdLevel::SSE2:
+            return kSSE2Kernels;
+#endif
+        default:
+            return kScalarKernels;
+    }
+}
+
+// O(n) sliding max/min for wide windows
+template <typename Better>
+void windowExtremeDeque(const double* v, size_t n, size_t window, double* out, Better better) {
+    std::deque<size_t> candidates;
+    for (size_t i = 0; i < n; i++) {
+        while (!candidates.empty() && !better(v[candidates.back()], v[i])) {
+            candidates.pop_back();
+        }
+        candidates.push_back(i);
+        if (candidates.front() + window <= i) {
+            candidates.pop_front();
+        }
+        out[i] = v[candidates.front()];
+    }
+}
+
+} // namespace
+
+SimdLevel Indicators::detectSimdLevel() {
+#if INDICATORS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdLevel::SSE2;
+    }
+#endif
+    return SimdLevel::SCALAR;
+}
+
+SimdLevel Indicators::getSimdLevel() {
+    int level = activeLevel.load(std::memory_order_relaxed);
+    if (level < 0) {
+        level = static_cast<int>(detectSimdLevel());
+        activeLevel.store(level, std::memory_order_relaxed);
+    }
+    return static_cast<SimdLevel>(level);
+}
+
+void Indicators::setSimdLevel(SimdLevel level) {
+    SimdLevel supported = detectSimdLevel();
+    if (static_cast<int>(level) > static_cast<int>(supported)) {
+        level = supported;
+    }
+    activeLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+std::vector<double> Indicators::trueRange(std::span<const double> high, std::span<const double> low,
+                                          std::span<const double> close) {
+    size_t n = std::min({high.size(), low.size(), close.size()});
+    std::vector<double> out(n, 0.0);
+    if (n == 0) {
+        return out;
+    }
+    out[0] = high[0] - low[0];
+    kernels().trueRange(high.data(), low.data(), close.data(), 1, n, out.data());
+    return out;
+}
+
+std::vector<double> Indicators::trueRange(const BarSeriesView& bars) {
+    return trueRange(bars.high(), bars.low(), bars.close());
+}
+
+std::vector<double> Indicators::atrSMA(std::span<const double> trueRanges, int period, bool exactOrder) {
+    size_t n = trueRanges.size();
+    std::vector<double> out(n, 0.0);
+    if (period <= 0 || n <= static_cast<size_t>(period)) {
+        return out;
+    }
+    // trueRanges[0] has no previous close, the first full window ends at bar period
+    size_t window = static_cast<size_t>(period);
+    const Kernels& active = kernels();
+    (exactOrder ? active.windowSum : active.slidingSum)(trueRanges.data(), window, n, window, 0, out.data());
+    active.divide(out.data(), period, window, n, out.data());
+    return out;
+}
+
+std::vector<double> Indicators::atrWilder(std::span<const double> trueRanges, int period) {
+    std::vector<double> out = atrSMA(trueRanges, period);
+    size_t n = trueRanges.size();
+    for (size_t i = static_cast<size_t>(std::max(period, 0)) + 1; period > 0 && i < n; i++) {
+        out[i] = (out[i - 1] * (period - 1) + trueRanges[i]) / period;
+    }
+    return out;
+}
+
+std::vector<double> Indicators::rollingMax(std::span<const double> values, int window) {
+    size_t n = values.size();
+    std::vector<double> out(n, 0.0);
+    if (window <= 0 || n == 0) {
+        return out;
+    }
+    size_t w = static_cast<size_t>(window);
+    if (w > kMaxDirectWindow) {
+        windowExtremeDeque(values.data(), n, w, out.data(), [](double kept, double next) { return kept > next; });
+        return out;
+    }
+    // Partial windows at the start
+    size_t full = std::min(n, w - 1);
+    for (size_t i = 0; i < full; i++) {
+        out[i] = (i == 0) ? values[0] : std::max(out[i - 1], values[i]);
+    }
+    kernels().windowMax(values.data(), full, n, w, out.data());
+    return out;
+}
+
+std::vector<double> Indicators::rollingMin(std::span<const double> values, int window) {
+    size_t n = values.size();
+    std::vector<double> out(n, 0.0);
+    if (window <= 0 || n == 0) {
+        return out;
+    }
+    size_t w = static_cast<size_t>(window);
+    if (w > kMaxDirectWindow) {
+        windowExtremeDeque(values.data(), n, w, out.data(), [](double kept, double next) { return kept < next; });
+        return out;
+    }
+    // Partial windows at the start
+    size_t full = std::min(n, w - 1);
+    for (size_t i = 0; i < full; i++) {
+        out[i] = (i == 0) ? values[0] : std::min(out[i - 1], values[i]);
+    }
+    kernels().windowMin(values.data(), full, n, w, out.data());
+    return out;
+}
+
+std::vector<double> Indicators::rollingMeanRange(std::span<const double> high, std::span<const double> low,
+                                                 int window) {
+    size_t n = std::min(high.size(), low.size());
+    std::vector<double> out(n, 0.0);
+    if (window <= 0 || n < static_cast<size_t>(window)) {
+        return out;
+    }
+    std::vector<double> ranges(n);
+    const Kernels& active = kernels();
+    active.difference(high.data(), low.data(), 0, n, ranges.data());
+    size_t w = static_cast<size_t>(window);
+    active.slidingSum(ranges.data(), w - 1, n, w, 0, out.data());
+    active.divide(out.data(), window, w - 1, n, out.data());
+    return out;
+}
+
+std::vector<uint8_t> Indicators::rangeExpansionMask(std::span<const double> high, std::span<const double> low,
+                                                    int window, double factor) {
+    size_t n = std::min(high.size(), low.size());
+    std::vector<uint8_t> mask(n, 0);
+    if (window <= 0 || n <= static_cast<size_t>(window)) {
+        return mask;
+    }
+    size_t w = static_cast<size_t>(window);
+    std::vector<double> ranges(n);
+    std::vector<double> previousSums(n, 0.0);
+    kernels().difference(high.data(), low.data(), 0, n, ranges.data());
+    // Newest first, ranges are tick multiples and the comparison sits right on them
+    kernels().windowSum(ranges.data(), w, n, w, 1, previousSums.data());
+    for (size_t i = w; i < n; i++) {
+        double averageRange = previousSums[i] / window;
+        mask[i] = ranges[i] > averageRange * factor ? 1 : 0;
+    }
+    return mask;
+}
+
+std::vector<uint8_t> Indicators::trendMask(std::span<const double> high, std::span<const double> low,
+                                           int lookback) {
+    size_t n = std::min(high.size(), low.size());
+    std::vector<uint8_t> mask(n, 0);
+    if (lookback <= 0 || n < static_cast<size_t>(lookback) + 2) {
+        return mask;
+    }
+    std::vector<uint8_t> up(n, 0);
+    std::vector<uint8_t> down(n, 0);
+    kernels().trendFlags(high.data(), low.data(), 1, n, up.data(), down.data());
+
+    // Run lengths of consecutive up/down bars ending at i - 1
+    size_t upRun = 0;
+    size_t downRun = 0;
+    size_t need = static_cast<size_t>(lookback);
+    for (size_t i = 1; i < n; i++) {
+        if (i >= need + 1) {
+            mask[i] = (upRun >= need || downRun >= need) ? 1 : 0;
+        }
+        upRun = up[i] ? upRun + 1 : 0;
+        downRun = down[i] ? downRun + 1 : 0;
+    }
+    return mask;
+}
@@ -0,0 +1,108 @@
+#include "latency_histogram.h"
+#include <bit>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+    std::string formatMicros(double nanoseconds) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << nanoseconds / 1000.0 << "us";
+        return out.str();
+    }
+}
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+size_t LatencyHistogram::bucketFor(uint64_t nanoseconds) {
+    const uint64_t subBuckets = 1 << kSubBucketBits;
+    if (nanoseconds < subBuckets) {
+        return static_cast<size_t>(nanoseconds);
+    }
+    // Position of the top bit picks the power of two, the next bits the sub bucket
+    int topBit = 63 - std::countl_zero(nanoseconds);
+    int shift = topBit - kSubBucketBits;
+    uint64_t sub = (nanoseconds >> shift) & (subBuckets - 1);
+    return static_cast<size_t>((shift + 1) * subBuckets + sub);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t bucket) {
+    const uint64_t subBuckets = 1 << kSubBucketBits;
+    if (bucket < subBuckets) {
+        return bucket;
+    }
+    int shift = static_cast<int>(bucket / subBuckets) - 1;
+    uint64_t sub = bucket % subBuckets;
+    uint64_t lower = (subBuckets + sub) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    buckets[bucketFor(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+    uint64_t current = maximum.load(std::memory_order_relaxed);
+    while (nanoseconds > current && !maximum.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::record(std::chrono::steady_clock::duration latency) {
+    auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+    record(static_cast<uint64_t>(nanoseconds > 0 ? nanoseconds : 0));
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    maximum.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const {
+    return total.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::max() const {
+    return maximum.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const {
+    uint64_t n = count();
+    return n ? static_cast<double>(sum.load(std::memory_order_relaxed)) / n : 0.0;
+}
+
+uint64_t LatencyHistogram::percentile(double percent) const {
+    uint64_t n = count();
+    if (n == 0) {
+        return 0;
+    }
+    // Rank of the wanted sample, 1-based
+    uint64_t rank = static_cast<uint64_t>(percent / 100.0 * n + 0.5);
+    rank = rank < 1 ? 1 : (rank > n ? n : rank);
+
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < kBucketCount; bucket++) {
+        seen += buckets[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // The bucket edge can overshoot the largest sample recorded
+            uint64_t bound = bucketUpperBound(bucket);
+            return bound < max() ? bound : max();
+        }
+    }
+    return max();
+}
+
+std::string LatencyHistogram::summary() const {
+    std::ostringstream out;
+    out << "n=" << count()
+        << " mean=" << formatMicros(mean())
+        << " p50=" << formatMicros(static_cast<double>(percentile(50)))
+        << " p90=" << formatMicros(static_cast<double>(percentile(90)))
+        << " p99=" << formatMicros(static_cast<double>(percentile(99)))
+        << " p99.9=" << formatMicros(static_cast<double>(percentile(99.9)))
+        << " max=" << formatMicros(static_cast<double>(max()));
+    return out.str();
+}
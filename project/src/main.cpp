@@ -1,8 +1,10 @@
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <map>
 #include <string>
 #include <iomanip>
+#include <sstream>
 #include <chrono>
 #include <thread>
 #include <signal.h>
@@ -11,12 +13,21 @@
 #include "binance_exchange.h"
 #include "volatility_breakout.h"
 #include "backtest_engine.h"
+#include "parameter_sweep.h"
+#include "portfolio_backtest.h"
+#include "walk_forward.h"
 #include "websocket_client.h"
 #include "okx_exchange.h"
 #include "bybit_exchange.h"
+#include "candle_cache.h"
 #include "env_loader.h"
 #include <unordered_map>
 #include "strategy.h"
+#include "arbitrage_detector.h"
+#include "market_data_parser.h"
+#include "market_data_recorder.h"
+#include "market_data_replay.h"
+#include <nlohmann/json.hpp>
 // Global flag for termination
 volatile sig_atomic_t g_running = 1;
 
@@ -51,30 +62,24 @@ std::string timestampToString(const std::string& ts) {
 }
 
 std::string  formatData(const CommonFormatData& data) {
-    std::string exchange = data.exchange;
-    std::string symbol = data.symbol;
-    int64_t timestamp = data.timestamp;
-    std::vector<std::string> bids = data.bids;
-    std::vector<std::string> asks = data.asks;
-
     // Convert timestamp to string
-    std::string timestampStr = timestampToString(std::to_string(timestamp));
+    std::string timestampStr = timestampToString(std::to_string(data.timestamp));
 
-    // Format bids and asks
-    std::string formattedBids, formattedAsks;
-    for (const auto& bid : bids) {
-        formattedBids += bid + " ";
+    // Format bids and asks as price@size
+    std::ostringstream formattedBids, formattedAsks;
+    for (size_t i = 0; i < data.bidCount; i++) {
+        formattedBids << data.bids[i].price << "@" << data.bids[i].size << " ";
     }
-    for (const auto& ask : asks) {
-        formattedAsks += ask + " ";
+    for (size_t i = 0; i < data.askCount; i++) {
+        formattedAsks << data.asks[i].price << "@" << data.asks[i].size << " ";
     }
 
     // Create the formatted output
-    return "Exchange: " + exchange + "\n" +
-           "Symbol: " + symbol + "\n" +
+    return "Exchange: " + data.exchange + "\n" +
+           "Symbol: " + data.symbol + "\n" +
            "Timestamp: " + timestampStr + "\n" +
-           "Bids: " + formattedBids + "\n" +
-           "Asks: " + formattedAsks + "\n";
+           "Bids: " + formattedBids.str() + "\n" +
+           "Asks: " + formattedAsks.str() + "\n";
 }
 
 #define RED "\033[31m"
@@ -115,15 +120,41 @@ void testGetOkBbBtc()
             << YELLOW << timestampToString(bybit_prices.first) << "," << GREEN << bybit_prices.second << RESET
             << ")" << std::endl;
     };
+    // Cross-venue spreads are checked on every book update
+    ArbitrageDetector arbitrage;
+    arbitrage.setOpportunityCallback([](const ArbitrageOpportunity& opportunity) {
+        std::cout << std::fixed << std::setprecision(8) << RED << "ARBITRAGE " << opportunity.symbol
+                  << " buy " << opportunity.buy_exchange << " @" << opportunity.buy_price
+                  << " sell " << opportunity.sell_exchange << " @" << opportunity.sell_price
+                  << " volume " << opportunity.max_volume
+                  << " net " << opportunity.profit_percentage * 100 << "%" << RESET << std::endl;
+    });
+
     // Set up price update callbacks
     okx->setRealTimeOrderBookCallback([&](const CommonFormatData& data) {
         std::cout << formatData(data) << std::endl;
+        arbitrage.handle_orderbook_data(data);
     });
 
     bybit->setRealTimeOrderBookCallback([&](const CommonFormatData& data) {
         std::cout << formatData(data) << std::endl;
+        arbitrage.handle_orderbook_data(data);
     });
     
+    // MARKET_DATA_RECORD_DIR in .env records the raw feeds for later replay
+    std::unique_ptr<MarketDataRecorder> recorder;
+    std::string recordDir = EnvLoader::get("MARKET_DATA_RECORD_DIR");
+    if (!recordDir.empty()) {
+        recorder = std::make_unique<MarketDataRecorder>(recordDir, "okx-bybit");
+        okx->setMarketDataRecorder(recorder.get());
+        bybit->setMarketDataRecorder(recorder.get());
+        if (!recorder->start()) {
+            okx->setMarketDataRecorder(nullptr);
+            bybit->setMarketDataRecorder(nullptr);
+            recorder.reset();
+        }
+    }
+
     // Connect to WebSockets
     if (!okx->connectWebSocket(okx_symbol, okx_channel)) {
         std::cerr << "Failed to connect to OKX WebSocket" << std::endl;
@@ -139,6 +170,16 @@ void testGetOkBbBtc()
     // Disconnect WebSockets
     okx->disconnectWebSocket();
     bybit->disconnectWebSocket();
+
+    if (recorder) {
+        recorder->stop();
+        RecorderStats stats = recorder->getStats();
+        std::cout << "Recorded " << stats.frames << " frames (" << stats.dropped << " dropped), "
+                  << stats.rawBytes << " bytes in " << stats.fileBytes << " on disk" << std::endl;
+    }
+
+    std::cout << arbitrage.getOpportunityCount() << " arbitrage opportunities, detection latency: "
+              << arbitrage.getLatencyHistogram().summary() << std::endl;
 }
 
 
@@ -174,6 +215,9 @@ void runOKXTradingBot() {
         okx->setPassphrase(passphrase);
     }
     
+    // Candles go through the on-disk cache, only missing bars are downloaded
+    auto okxHistory = std::make_shared<CachedExchange>(okx, std::make_shared<CandleCache>());
+    
     // Ask for trading parameters
     std::string symbolInput;
     std::cout << "Enter symbol to trade (default: BTC-USDT): ";
@@ -229,7 +273,7 @@ void runOKXTradingBot() {
     std::time_t now = std::time(nullptr);
     std::time_t fiveDaysAgo = now - (5 * 24 * 60 * 60);
     
-    std::vector<OHLCV> initialData = okx->fetchHistoricalData(
+    std::vector<OHLCV> initialData = okxHistory->fetchHistoricalData(
         symbol,
         timeframe,
         std::to_string(fiveDaysAgo * 1000),
@@ -241,9 +285,27 @@ void runOKXTradingBot() {
         candle.symbol = symbol;
     }
     
+    // OKX returns newest first, the strategy needs bars in time order
+    std::sort(initialData.begin(), initialData.end(), 
+             [](const OHLCV& a, const OHLCV& b) {
+                 return a.timestamp < b.timestamp;
+             });
+    
     symbolData[symbol] = initialData;
     std::cout << "Loaded " << initialData.size() << " historical bars for " << symbol << std::endl;
     
+    // Warm up the strategy state with the completed historical bars. The newest
+    // bar is still forming, it is fed once the next candle starts.
+    OHLCV pendingBar;
+    bool hasPendingBar = false;
+    if (!initialData.empty()) {
+        for (size_t i = 0; i + 1 < initialData.size(); i++) {
+            strategy->onBar(initialData[i]);
+        }
+        pendingBar = initialData.back();
+        hasPendingBar = true;
+    }
+    
     // Connect to WebSocket for real-time updates
     std::string channel;
     if (timeframe == "1m") channel = "candle1m";
@@ -274,13 +336,16 @@ void runOKXTradingBot() {
         // Add to our data
         bool updated = false;
         
-        // Update existing candle if same timestamp
-        for (auto& existingCandle : symbolData[symbol]) {
-            if (existingCandle.timestamp == updatedCandle.timestamp) {
-                existingCandle = updatedCandle;
+        // Update existing candle if same timestamp (newest candles are at the back)
+        for (auto it = symbolData[symbol].rbegin(); it != symbolData[symbol].rend(); ++it) {
+            if (it->timestamp == updatedCandle.timestamp) {
+                *it = updatedCandle;
                 updated = true;
                 break;
             }
+            if (it->timestamp < updatedCandle.timestamp) {
+                break;
+            }
         }
         
         // Add as new candle if not updated
@@ -288,14 +353,24 @@ void runOKXTradingBot() {
             symbolData[symbol].push_back(updatedCandle);
             
             // Sort by timestamp to ensure correct order
-            std::sort(symbolData[symbol].begin(), symbolData[symbol].end(), 
-                     [](const OHLCV& a, const OHLCV& b) {
-                         return a.timestamp < b.timestamp;
-                     });
+            if (symbolData[symbol].size() > 1 &&
+                symbolData[symbol][symbolData[symbol].size() - 2].timestamp > updatedCandle.timestamp) {
+                std::sort(symbolData[symbol].begin(), symbolData[symbol].end(), 
+                         [](const OHLCV& a, const OHLCV& b) {
+                             return a.timestamp < b.timestamp;
+                         });
+            }
         }
         
-        // Process with strategy
-        std::vector<Signal> signals = strategy->processData(symbolData[symbol]);
+        // Process with strategy: a candle with a newer timestamp closes the pending one
+        std::vector<Signal> signals;
+        if (!hasPendingBar || updatedCandle.timestamp == pendingBar.timestamp) {
+            pendingBar = updatedCandle;
+            hasPendingBar = true;
+        } else if (updatedCandle.timestamp > pendingBar.timestamp) {
+            signals = strategy->onBar(pendingBar);
+            pendingBar = updatedCandle;
+        }
         
         // Execute signals (if real API key provided)
         for (const auto& signal : signals) {
@@ -343,7 +418,7 @@ void runOKXTradingBot() {
             std::time_t now = std::time(nullptr);
             std::time_t oneDayAgo = now - (24 * 60 * 60);
             
-            std::vector<OHLCV> refreshData = okx->fetchHistoricalData(
+            std::vector<OHLCV> refreshData = okxHistory->fetchHistoricalData(
                 symbol,
                 timeframe,
                 std::to_string(oneDayAgo * 1000),
@@ -458,11 +533,20 @@ void runBacktestImprovedStrategy() {
     std::getline(std::cin, initialCapitalInput);
     double initialCapital = initialCapitalInput.empty() ? 10000.0 : std::stod(initialCapitalInput);
     
-    // Fetch historical data
+    // Ask for the history length
+    std::string daysInput;
+    std::cout << "Enter days of history to test (default: 30): ";
+    std::getline(std::cin, daysInput);
+    int days = daysInput.empty() ? 30 : std::stoi(daysInput);
+    
+    // Fetch historical data, reusing whatever earlier runs left in the candle cache
     std::cout << "Fetching historical data for " << symbol << "..." << std::endl;
     
-    std::vector<OHLCV> historicalData = exchange->fetchHistoricalData(
-        symbol, timeframe, "", "");
+    CachedExchange history(exchange, std::make_shared<CandleCache>());
+    std::time_t now = std::time(nullptr);
+    std::time_t startTime = now - static_cast<std::time_t>(days) * 24 * 60 * 60;
+    std::vector<OHLCV> historicalData = history.fetchHistoricalData(
+        symbol, timeframe, std::to_string(startTime * 1000), std::to_string(now * 1000));
     
     if (historicalData.empty()) {
         std::cerr << "Failed to fetch historical data" << std::endl;
@@ -476,39 +560,397 @@ void runBacktestImprovedStrategy() {
     
     std::cout << "Fetched " << historicalData.size() << " data points" << std::endl;
     
-    // Run backtest for each breakout factor
-    for (double factor : breakoutFactors) {
-        std::cout << "\nRunning backtest with breakoutFactor = " << factor << std::endl;
-        
-        // Configure strategy
-        std::map<std::string, double> params;
-        params["breakoutFactor"] = factor;
-        params["profitFactor"] = 2.0;
-        params["stopLossFactor"] = 1.0;
-        strategy->initialize(params);
-        
-        // Connect strategy with exchange
-        strategy->setExchange(exchange);
-        
-        // Run backtest
-        BacktestResult result = backtester.runBacktest(strategy, historicalData, initialCapital);
-        
-        // Generate report
-        std::string report = backtester.generateReport(result);
-        std::cout << report << std::endl;
+    // Columnar copy in time order for the backtests
+    BarSeries series = BarSeries::fromOHLCV(historicalData, symbol);
+    historicalData.clear();
+    historicalData.shrink_to_fit();
+    
+    // Run one isolated backtest per breakout factor, in parallel
+    std::map<std::string, std::vector<double>> axes;
+    axes["breakoutFactor"] = breakoutFactors;
+    axes["profitFactor"] = {2.0};
+    axes["stopLossFactor"] = {1.0};
+    
+    // Connect strategy with exchange, every job clones it
+    strategy->setExchange(exchange);
+    
+    ParameterSweep sweep;
+    sweep.setInitialCapital(initialCapital);
+    std::vector<SweepResult> results = sweep.run(*strategy, series, ParameterSweep::buildGrid(axes));
+    
+    // Generate report
+    std::cout << sweep.generateReport(results) << std::endl;
+    for (const auto& row : results) {
+        std::cout << "breakoutFactor = " << row.parameters.at("breakoutFactor") << std::endl;
+        std::cout << backtester.generateReport(row.result) << std::endl;
     }
     
     std::cout << "Backtesting completed!" << std::endl;
 }
 
+// Volatility breakout on several OKX symbols at once against one account
+void runPortfolioBacktest() {
+    std::cout << "\n=== Portfolio Backtest ===\n" << std::endl;
+
+    std::string input;
+    std::cout << "Symbols, separated by commas (default: BTC-USDT,ETH-USDT,SOL-USDT): ";
+    std::getline(std::cin, input);
+    std::vector<std::string> symbols;
+    std::stringstream list(input.empty() ? "BTC-USDT,ETH-USDT,SOL-USDT" : input);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        if (!item.empty()) {
+            symbols.push_back(item);
+        }
+    }
+
+    std::cout << "Enter timeframe (1m, 5m, 15m, 1h, 4h, 1d - default: 1h): ";
+    std::getline(std::cin, input);
+    std::string timeframe = input.empty() ? "1h" : input;
+
+    std::cout << "Enter days of history to test (default: 30): ";
+    std::getline(std::cin, input);
+    int days = input.empty() ? 30 : std::stoi(input);
+
+    std::cout << "Enter max leverage (default: 1): ";
+    std::getline(std::cin, input);
+    double leverage = input.empty() ? 1.0 : std::stod(input);
+
+    auto exchange = std::make_shared<OKXExchange>();
+    if (!exchange->initialize("", "")) {
+        std::cerr << "Failed to initialize exchange" << std::endl;
+        return;
+    }
+    CachedExchange history(exchange, std::make_shared<CandleCache>());
+    std::time_t now = std::time(nullptr);
+    std::time_t startTime = now - static_cast<std::time_t>(days) * 24 * 60 * 60;
+
+    // Series are kept alive here, the backtest only views them
+    std::vector<BarSeries> seriesList;
+    seriesList.reserve(symbols.size());
+    for (const std::string& symbol : symbols) {
+        std::vector<OHLCV> candles = history.fetchHistoricalData(
+            symbol, timeframe, std::to_string(startTime * 1000), std::to_string(now * 1000));
+        if (candles.empty()) {
+            std::cerr << "No history for " << symbol << ", skipped" << std::endl;
+            continue;
+        }
+        std::cout << "Fetched " << candles.size() << " bars for " << symbol << std::endl;
+        seriesList.push_back(BarSeries::fromOHLCV(candles, symbol));
+    }
+
+    VolatilityBreakout prototype;
+    prototype.setVerbose(false);
+    PortfolioBacktest portfolio;
+    portfolio.setMaxLeverage(leverage);
+    portfolio.setMaxPositionFraction(1.0 / std::max<size_t>(seriesList.size(), 1));
+    for (const BarSeries& series : seriesList) {
+        portfolio.addSymbol(prototype.clone(), series);
+    }
+    PortfolioResult result = portfolio.run(10000.0);
+    std::cout << portfolio.generateReport(result) << std::endl;
+}
+
+// Volatility breakout re-optimized on a rolling window of OKX history and
+// traded on the bars after each window
+void runWalkForward() {
+    std::cout << "\n=== Walk-Forward Optimization ===\n" << std::endl;
+
+    std::string input;
+    std::cout << "Enter symbol (default: BTC-USDT): ";
+    std::getline(std::cin, input);
+    std::string symbol = input.empty() ? "BTC-USDT" : input;
+
+    std::cout << "Enter timeframe (1m, 5m, 15m, 1h, 4h, 1d - default: 1h): ";
+    std::getline(std::cin, input);
+    std::string timeframe = input.empty() ? "1h" : input;
+
+    std::cout << "Enter days of history to test (default: 180): ";
+    std::getline(std::cin, input);
+    int days = input.empty() ? 180 : std::stoi(input);
+
+    std::cout << "Enter in-sample and out-of-sample days (default: 30,7): ";
+    std::getline(std::cin, input);
+    int inSampleDays = 30;
+    int outOfSampleDays = 7;
+    if (!input.empty()) {
+        char separator;
+        std::stringstream(input) >> inSampleDays >> separator >> outOfSampleDays;
+    }
+
+    auto exchange = std::make_shared<OKXExchange>();
+    if (!exchange->initialize("", "")) {
+        std::cerr << "Failed to initialize exchange" << std::endl;
+        return;
+    }
+    CachedExchange history(exchange, std::make_shared<CandleCache>());
+    std::time_t now = std::time(nullptr);
+    std::time_t startTime = now - static_cast<std::time_t>(days) * 24 * 60 * 60;
+    std::vector<OHLCV> candles = history.fetchHistoricalData(
+        symbol, timeframe, std::to_string(startTime * 1000), std::to_string(now * 1000));
+    if (candles.size() < 2) {
+        std::cerr << "Not enough history for " << symbol << std::endl;
+        return;
+    }
+    BarSeries series = BarSeries::fromOHLCV(candles, symbol);
+    std::cout << "Fetched " << series.size() << " bars for " << symbol << std::endl;
+
+    std::time_t barSeconds = std::max<std::time_t>(series.timestamp()[1] - series.timestamp()[0], 1);
+    size_t barsPerDay = std::max<size_t>(86400 / barSeconds, 1);
+
+    std::map<std::string, std::vector<double>> axes;
+    axes["breakoutFactor"] = {0.3, 0.4, 0.5, 0.6};
+    axes["profitFactor"] = {1.5, 2.0, 3.0};
+    axes["stopLossFactor"] = {0.5, 1.0};
+    axes["useATR"] = {0.0, 1.0};
+    axes["atrPeriod"] = {7.0, 14.0};
+
+    VolatilityBreakout prototype;
+    prototype.setVerbose(false);
+    WalkForwardOptimizer optimizer;
+    optimizer.setWindows(inSampleDays * barsPerDay, outOfSampleDays * barsPerDay);
+    // Two days give the strategy its previous day and the ATR its bars
+    optimizer.setWarmupBars(2 * barsPerDay);
+    WalkForwardResult result = optimizer.run(prototype, series, ParameterSweep::buildGrid(axes));
+    std::cout << optimizer.generateReport(result) << std::endl;
+}
+
+namespace {
+    // Messages per row when timing a recording, repeated passes make it up
+    const size_t kBenchmarkMessages = 200000;
+    // Frames kept per exchange from a recording
+    const size_t kMaxRecordedFrames = 100000;
+
+    ParseResult parseFast(const std::string& exchange, std::string_view text, MarketDataMessage& message) {
+        if (exchange == "OKX") {
+            return MarketDataParser::parseOkx(text, message);
+        }
+        if (exchange == "Bybit") {
+            return MarketDataParser::parseBybit(text, message);
+        }
+        return MarketDataParser::parseBinance(text, message);
+    }
+
+    // What the handlers did: parse into a DOM, then stod every number. Throws
+    // on a message shape it does not expect.
+    double parseDom(const std::string& text) {
+        double checksum = 0;
+        nlohmann::json data = nlohmann::json::parse(text);
+        const nlohmann::json& item = data.contains("data")
+            ? (data["data"].is_array() ? data["data"][0] : data["data"]) : data;
+        for (const char* key : {"asks", "bids", "a", "b"}) {
+            if (item.contains(key) && item[key].is_array()) {
+                for (const auto& level : item[key]) {
+                    checksum += std::stod(level[0].get<std::string>()) + std::stod(level[1].get<std::string>());
+                }
+            }
+        }
+        for (const char* key : {"last", "lastPrice", "c"}) {
+            if (item.contains(key)) {
+                checksum += std::stod(item[key].get<std::string>());
+            }
+        }
+        return checksum;
+    }
+
+    double parseFastChecksum(const std::string& exchange, std::string_view text, MarketDataMessage& message) {
+        if (parseFast(exchange, text, message) != ParseResult::PARSED) {
+            return 0;
+        }
+        double checksum = message.price;
+        for (const ParsedLevel& level : message.asks) {
+            checksum += level.price + level.size;
+        }
+        for (const ParsedLevel& level : message.bids) {
+            checksum += level.price + level.size;
+        }
+        return checksum;
+    }
+
+    // Times every message through both paths, passes times over
+    void benchmarkParserRow(const std::string& label, const std::string& exchange,
+                            const std::vector<std::string>& messages, size_t passes) {
+        double domChecksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t pass = 0; pass < passes; pass++) {
+            for (const std::string& text : messages) {
+                domChecksum += parseDom(text);
+            }
+        }
+        double domSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        MarketDataMessage message;
+        double fastChecksum = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t pass = 0; pass < passes; pass++) {
+            for (const std::string& text : messages) {
+                fastChecksum += parseFastChecksum(exchange, text, message);
+            }
+        }
+        double fastSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double count = static_cast<double>(messages.size() * passes);
+        std::cout << std::fixed << std::setprecision(0) << std::left << std::setw(24) << label
+                  << " json: " << count / domSeconds << " msg/s"
+                  << "  fast: " << count / fastSeconds << " msg/s"
+                  << std::setprecision(1) << "  speedup: " << domSeconds / fastSeconds << "x"
+                  << (domChecksum == fastChecksum ? "" : "  (values differ!)") << std::endl;
+    }
+
+    // Book and ticker frames of a recording by exchange, the ones both paths
+    // read. False if the file cannot be opened.
+    bool loadRecordedMessages(const std::string& path, std::map<std::string, std::vector<std::string>>& messages) {
+        MarketDataReader reader;
+        if (!reader.open(path)) {
+            return false;
+        }
+        RecordedFrame frame;
+        MarketDataMessage message;
+        size_t skipped = 0;
+        while (reader.next(frame)) {
+            if (frame.exchange != "OKX" && frame.exchange != "Bybit" && frame.exchange != "Binance") {
+                skipped++;
+                continue;
+            }
+            std::vector<std::string>& frames = messages[frame.exchange];
+            if (frames.size() >= kMaxRecordedFrames) {
+                continue;
+            }
+            if (parseFast(frame.exchange, frame.payload, message) != ParseResult::PARSED) {
+                skipped++;
+                continue;
+            }
+            try {
+                parseDom(frame.payload);
+            } catch (const std::exception&) {
+                skipped++;
+                continue;
+            }
+            frames.push_back(std::move(frame.payload));
+        }
+        std::cout << "Skipped " << skipped << " frames outside the book and ticker streams" << std::endl;
+        return true;
+    }
+}
+
+// Parse throughput of the full JSON parse the handlers used to do against the
+// fast path parsers, over a recording made by the live feed or, without one,
+// over four built-in sample messages
+void benchmarkMarketDataParser() {
+    std::cout << "\n=== Market Data Parser Benchmark ===\n" << std::endl;
+
+    std::cout << "Recording file (.mdr, empty for the built-in samples): ";
+    std::string path;
+    std::getline(std::cin, path);
+
+    if (!path.empty()) {
+        std::map<std::string, std::vector<std::string>> messages;
+        if (!loadRecordedMessages(path, messages)) {
+            std::cerr << "Cannot read recording " << path << std::endl;
+            return;
+        }
+        for (const auto& exchange : messages) {
+            if (exchange.second.empty()) {
+                continue;
+            }
+            size_t passes = std::max<size_t>(1, kBenchmarkMessages / exchange.second.size());
+            benchmarkParserRow(exchange.first + " (" + std::to_string(exchange.second.size()) + " recorded)",
+                               exchange.first, exchange.second, passes);
+        }
+        return;
+    }
+
+    std::cout << "Synthetic samples, one message per row" << std::endl;
+    const std::vector<std::pair<std::string, std::string>> samples = {
+        {"OKX books update",
+         R"({"arg":{"channel":"books","instId":"BTC-USDT"},"action":"update","data":[{"asks":[["106803.3","0.39738157","0","10"],["106810.9","0.27284022","0","1"],["106811.2","0.00112","0","1"],["106815","1.204","0","3"]],"bids":[["106803.2","0.50276524","0","12"],["106799.9","0.03249663","0","2"],["106799.1","0","0","0"],["106795.5","0.1181","0","2"]],"ts":"1750148961607","checksum":691172457,"prevSeqId":56657333676,"seqId":56657333800}]})"},
+        {"OKX ticker",
+         R"({"arg":{"channel":"tickers","instId":"BTC-USDT"},"data":[{"instType":"SPOT","instId":"BTC-USDT","last":"109658.1","lastSz":"0.00079322","askPx":"109658.1","askSz":"0.67008012","bidPx":"109658","bidSz":"1.27181544","open24h":"109661.1","high24h":"110393","low24h":"108344.1","sodUtc0":"110274.1","sodUtc8":"109024","volCcy24h":"427003648.298043872","vol24h":"3902.32624992","ts":"1749646867021"}]})"},
+        {"Bybit orderbook delta",
+         R"({"topic":"orderbook.50.BTCUSDT","ts":1750148961528,"type":"delta","data":{"s":"BTCUSDT","b":[["106797.9","0.429797"],["106797.1","0"],["106790","0.5"]],"a":[["106798","1.10634"],["106799.5","0.02"],["106802","0"]],"u":293507,"seq":77377992351},"cts":1750148961525})"},
+        {"Binance ticker",
+         R"({"e":"24hrTicker","E":1750148961528,"s":"BTCUSDT","p":"-12.30","P":"-0.011","w":"106700.2","x":"106810.0","c":"106798.00","Q":"0.002","b":"106797.99","B":"3.1","a":"106798.00","A":"0.4","o":"106810.3","h":"107300.0","l":"106100.0","v":"8123.1","q":"866000000.1","O":1750062561528,"C":1750148961528,"F":1,"L":2,"n":2})"}
+    };
+    for (const auto& sample : samples) {
+        std::string exchange = sample.first.substr(0, sample.first.find(' '));
+        benchmarkParserRow(sample.first, exchange, {sample.second}, kBenchmarkMessages);
+    }
+}
+
+// Plays a recording made by the live feed back through the exchange handlers
+// and the arbitrage detector, no network involved
+void replayMarketData() {
+    std::cout << "\n=== Market Data Replay ===\n" << std::endl;
+
+    std::string directory = EnvLoader::get("MARKET_DATA_RECORD_DIR");
+    std::cout << "Recording directory" << (directory.empty() ? "" : " [" + directory + "]") << ": ";
+    std::string input;
+    std::getline(std::cin, input);
+    if (!input.empty()) {
+        directory = input;
+    }
+
+    std::cout << "Speed (0 = as fast as possible, 1 = real time, N = N times real time) [0]: ";
+    std::getline(std::cin, input);
+    double speed = input.empty() ? 0 : std::atof(input.c_str());
+
+    MarketDataReplay replay;
+    if (replay.addDirectory(directory) == 0) {
+        std::cerr << "No recordings found in " << directory << std::endl;
+        return;
+    }
+    if (speed <= 0) {
+        replay.setMode(ReplayMode::AS_FAST_AS_POSSIBLE);
+    } else if (speed == 1) {
+        replay.setMode(ReplayMode::REAL_TIME);
+    } else {
+        replay.setMode(ReplayMode::SCALED, speed);
+    }
+
+    auto okx = std::make_shared<OKXExchange>();
+    auto bybit = std::make_shared<BybitExchange>();
+    auto binance = std::make_shared<BinanceExchange>();
+
+    ArbitrageDetector arbitrage;
+    uint64_t bookUpdates = 0;
+    uint64_t priceUpdates = 0;
+    auto onBook = [&](const CommonFormatData& data) {
+        bookUpdates++;
+        arbitrage.handle_orderbook_data(data);
+    };
+    okx->setRealTimeOrderBookCallback(onBook);
+    bybit->setRealTimeOrderBookCallback(onBook);
+    // Binance streams tickers only
+    binance->setRealTimePriceCallback([&](const std::string&, double) { priceUpdates++; });
+
+    replay.setHandler("OKX", [&](std::string_view message) { okx->handleWebSocketMessage(message); });
+    replay.setHandler("Bybit", [&](std::string_view message) { bybit->handleWebSocketMessage(message); });
+    replay.setHandler("Binance", [&](std::string_view message) { binance->handleWebSocketMessage(message); });
+
+    ReplayStats stats = replay.run();
+    double wallSeconds = stats.wallNs / 1e9;
+    double recordedSeconds = (stats.lastReceiveNs - stats.firstReceiveNs) / 1e9;
+    std::cout << std::fixed << std::setprecision(1)
+              << "Replayed " << stats.frames << " frames (" << stats.unrouted << " without a handler), "
+              << recordedSeconds << "s recorded in " << wallSeconds << "s, "
+              << std::setprecision(0) << (wallSeconds > 0 ? stats.frames / wallSeconds : 0) << " msg/s" << std::endl;
+    std::cout << bookUpdates << " book updates, " << priceUpdates << " Binance prices, " << arbitrage.getOpportunityCount()
+              << " arbitrage opportunities, detection latency: "
+              << arbitrage.getLatencyHistogram().summary() << std::endl;
+}
+
 int main() {
     EnvLoader::loadEnv(); // Load environment variables if needed    
     std::cout << "\nSelect an option:" << std::endl;
     std::cout << "1. Test WebSocket connections" << std::endl;
-    std::cout << "2. Exit" << std::endl;
+    std::cout << "2. Benchmark market data parsers" << std::endl;
+    std::cout << "3. Replay recorded market data" << std::endl;
+    std::cout << "4. Portfolio backtest" << std::endl;
+    std::cout << "5. Walk-forward optimization" << std::endl;
+    std::cout << "6. Exit" << std::endl;
     
     int choice;
-    std::cout << "Enter your choice (1-2): ";
+    std::cout << "Enter your choice (1-6): ";
     std::cin >> choice;
     std::cin.ignore(); // Clear the newline character
     
@@ -542,6 +984,22 @@ int main() {
         
             
         case 2:
+            benchmarkMarketDataParser();
+            break;
+
+        case 3:
+            replayMarketData();
+            break;
+
+        case 4:
+            runPortfolioBacktest();
+            break;
+
+        case 5:
+            runWalkForward();
+            break;
+
+        case 6:
             std::cout << "Exiting program." << std::endl;
             return 0;
             
@@ -0,0 +1,367 @@
+#include "market_data_parser.h"
+#include <charconv>
+
+namespace {
+    // Forward-only reader over JSON text. Every read returns false on text it
+    // does not expect, which the parsers report as MALFORMED.
+    class JsonCursor {
+    public:
+        explicit JsonCursor(std::string_view text)
+            : p(text.data()), end(text.data() + text.size()) {
+        }
+
+        bool peek(char c) {
+            skipSpace();
+            return p < end && *p == c;
+        }
+
+        bool consume(char c) {
+            skipSpace();
+            if (p < end && *p == c) {
+                ++p;
+                return true;
+            }
+            return false;
+        }
+
+        bool atEnd() {
+            skipSpace();
+            return p == end;
+        }
+
+        // Raw contents between the quotes, escapes are left as they are
+        bool readString(std::string_view& out) {
+            if (!consume('"')) {
+                return false;
+            }
+            const char* start = p;
+            while (p < end && *p != '"') {
+                if (*p == '\\' && ++p == end) {
+                    return false;
+                }
+                ++p;
+            }
+            if (p == end) {
+                return false;
+            }
+            out = std::string_view(start, p - start);
+            ++p;
+            return true;
+        }
+
+        // A number, or a number in quotes as exchanges send prices
+        template <typename T>
+        bool readNumber(T& out, std::string_view* text = nullptr) {
+            std::string_view token;
+            if (peek('"')) {
+                if (!readString(token)) {
+                    return false;
+                }
+            } else {
+                const char* start = p;
+                while (p < end && isNumberChar(*p)) {
+                    ++p;
+                }
+                token = std::string_view(start, p - start);
+            }
+            auto result = std::from_chars(token.data(), token.data() + token.size(), out);
+            if (result.ec != std::errc() || result.ptr != token.data() + token.size()) {
+                return false;
+            }
+            if (text) {
+                *text = token;
+            }
+            return true;
+        }
+
+        bool skipValue() {
+            skipSpace();
+            if (p == end) {
+                return false;
+            }
+            std::string_view ignored;
+            if (*p == '"') {
+                return readString(ignored);
+            }
+            if (*p == '{' || *p == '[') {
+                int depth = 0;
+                while (p < end) {
+                    char c = *p;
+                    if (c == '"') {
+                        if (!readString(ignored)) {
+                            return false;
+                        }
+                        continue;
+                    }
+                    ++p;
+                    if (c == '{' || c == '[') {
+                        depth++;
+                    } else if ((c == '}' || c == ']') && --depth == 0) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+            // Number, true, false or null
+            const char* start = p;
+            while (p < end && *p != ',' && *p != '}' && *p != ']' && !isSpace(*p)) {
+                ++p;
+            }
+            return p != start;
+        }
+
+        // Calls member(key) for each member, which has to consume the value
+        template <typename Fn>
+        bool forEachMember(Fn member) {
+            if (!consume('{')) {
+                return false;
+            }
+            if (consume('}')) {
+                return true;
+            }
+            do {
+                std::string_view key;
+                if (!readString(key) || !consume(':') || !member(key)) {
+                    return false;
+                }
+            } while (consume(','));
+            return consume('}');
+        }
+
+        // Calls element() for each element, which has to consume it
+        template <typename Fn>
+        bool forEachElement(Fn element) {
+            if (!consume('[')) {
+                return false;
+            }
+            if (consume(']')) {
+                return true;
+            }
+            do {
+                if (!element()) {
+                    return false;
+                }
+            } while (consume(','));
+            return consume(']');
+        }
+
+    private:
+        static bool isSpace(char c) {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+        }
+
+        static bool isNumberChar(char c) {
+            return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+        }
+
+        void skipSpace() {
+            while (p < end && isSpace(*p)) {
+                ++p;
+            }
+        }
+
+        const char* p;
+        const char* end;
+    };
+
+    // [["price","size",...], ...], entries after the size are skipped
+    bool readLevels(JsonCursor& cursor, std::vector<ParsedLevel>& levels) {
+        return cursor.forEachElement([&]() {
+            ParsedLevel level{};
+            size_t index = 0;
+            bool valid = cursor.forEachElement([&]() {
+                bool read;
+                if (index == 0) {
+                    read = cursor.readNumber(level.price, &level.priceText);
+                } else if (index == 1) {
+                    read = cursor.readNumber(level.size, &level.sizeText);
+                } else {
+                    read = cursor.skipValue();
+                }
+                index++;
+                return read;
+            });
+            if (!valid || index < 2) {
+                return false;
+            }
+            levels.push_back(level);
+            return true;
+        });
+    }
+}
+
+void MarketDataMessage::clear() {
+    channel = {};
+    symbol = {};
+    type = {};
+    timestamp = 0;
+    sequence = 0;
+    prevSequence = 0;
+    hasPrevSequence = false;
+    checksum = 0;
+    hasChecksum = false;
+    price = 0;
+    hasPrice = false;
+    bids.clear();
+    asks.clear();
+}
+
+ParseResult MarketDataParser::parseOkx(std::string_view text, MarketDataMessage& message) {
+    message.clear();
+    JsonCursor cursor(text);
+    size_t items = 0;
+    bool unsupported = false;
+
+    bool valid = cursor.forEachMember([&](std::string_view key) {
+        if (key == "arg") {
+            return cursor.forEachMember([&](std::string_view field) {
+                if (field == "channel") {
+                    return cursor.readString(message.channel);
+                }
+                if (field == "instId") {
+                    return cursor.readString(message.symbol);
+                }
+                return cursor.skipValue();
+            });
+        }
+        if (key == "action") {
+            return cursor.readString(message.type);
+        }
+        if (key == "data") {
+            return cursor.forEachElement([&]() {
+                // Candles are arrays, several items would need several messages
+                if (++items > 1 || !cursor.peek('{')) {
+                    unsupported = true;
+                    return cursor.skipValue();
+                }
+                return cursor.forEachMember([&](std::string_view field) {
+                    if (field == "asks") {
+                        return readLevels(cursor, message.asks);
+                    }
+                    if (field == "bids") {
+                        return readLevels(cursor, message.bids);
+                    }
+                    if (field == "ts") {
+                        return cursor.readNumber(message.timestamp);
+                    }
+                    if (field == "checksum") {
+                        message.hasChecksum = true;
+                        return cursor.readNumber(message.checksum);
+                    }
+                    if (field == "seqId") {
+                        return cursor.readNumber(message.sequence);
+                    }
+                    if (field == "prevSeqId") {
+                        message.hasPrevSequence = true;
+                        return cursor.readNumber(message.prevSequence);
+                    }
+                    if (field == "last" || field == "markPx") {
+                        message.hasPrice = true;
+                        return cursor.readNumber(message.price);
+                    }
+                    return cursor.skipValue();
+                });
+            });
+        }
+        // event, code, msg, connId, ...
+        return cursor.skipValue();
+    });
+
+    if (!valid || !cursor.atEnd()) {
+        return ParseResult::MALFORMED;
+    }
+    if (unsupported || items != 1 || message.channel.empty()) {
+        return ParseResult::UNSUPPORTED;
+    }
+    return ParseResult::PARSED;
+}
+
+ParseResult MarketDataParser::parseBybit(std::string_view text, MarketDataMessage& message) {
+    message.clear();
+    JsonCursor cursor(text);
+    std::string_view topic;
+    bool hasData = false;
+    bool unsupported = false;
+
+    bool valid = cursor.forEachMember([&](std::string_view key) {
+        if (key == "topic") {
+            return cursor.readString(topic);
+        }
+        if (key == "type") {
+            return cursor.readString(message.type);
+        }
+        if (key == "ts") {
+            return cursor.readNumber(message.timestamp);
+        }
+        if (key == "data") {
+            // Trades and other topics carry arrays
+            if (!cursor.peek('{')) {
+                unsupported = true;
+                return cursor.skipValue();
+            }
+            hasData = true;
+            return cursor.forEachMember([&](std::string_view field) {
+                if (field == "a") {
+                    return readLevels(cursor, message.asks);
+                }
+                if (field == "b") {
+                    return readLevels(cursor, message.bids);
+                }
+                if (field == "u") {
+                    return cursor.readNumber(message.sequence);
+                }
+                if (field == "lastPrice") {
+                    message.hasPrice = true;
+                    return cursor.readNumber(message.price);
+                }
+                return cursor.skipValue();
+            });
+        }
+        // cts, op responses, ...
+        return cursor.skipValue();
+    });
+
+    if (!valid || !cursor.atEnd()) {
+        return ParseResult::MALFORMED;
+    }
+    // "tickers.BTCUSDT" or "orderbook.50.BTCUSDT"
+    size_t firstDot = topic.find('.');
+    if (unsupported || !hasData || firstDot == std::string_view::npos) {
+        return ParseResult::UNSUPPORTED;
+    }
+    message.channel = topic.substr(0, firstDot);
+    message.symbol = topic.substr(topic.rfind('.') + 1);
+    return ParseResult::PARSED;
+}
+
+ParseResult MarketDataParser::parseBinance(std::string_view text, MarketDataMessage& message) {
+    message.clear();
+    JsonCursor cursor(text);
+
+    // Keys are case sensitive: "c" is the last price, "C" the close time
+    bool valid = cursor.forEachMember([&](std::string_view key) {
+        if (key == "e") {
+            return cursor.readString(message.channel);
+        }
+        if (key == "E") {
+            return cursor.readNumber(message.timestamp);
+        }
+        if (key == "s") {
+            return cursor.readString(message.symbol);
+        }
+        if (key == "c") {
+            message.hasPrice = true;
+            return cursor.readNumber(message.price);
+        }
+        return cursor.skipValue();
+    });
+
+    if (!valid || !cursor.atEnd()) {
+        return ParseResult::MALFORMED;
+    }
+    // Klines nest their fields in "k", trades and request results are rare
+    if (message.channel != "24hrTicker" || !message.hasPrice || message.symbol.empty()) {
+        return ParseResult::UNSUPPORTED;
+    }
+    return ParseResult::PARSED;
+}
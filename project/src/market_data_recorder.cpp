@@ -0,0 +1,474 @@
+#include "market_data_recorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <zlib.h>
+
+namespace {
+    const char kFileMagic[4] = {'M', 'D', 'R', '1'};
+    const uint32_t kFileVersion = 1;
+    const uint32_t kBlockMagic = 0x4B4C4252; // "RBLK"
+    const size_t kRingHeaderBytes = sizeof(uint32_t) + sizeof(int64_t);
+    // How long a frame waits before it is merged into the file. Covers the
+    // time between an I/O thread stamping a frame and publishing it to its ring.
+    const int64_t kReorderWindowNs = 50'000'000;
+    // Longest a frame waits in a partly filled block
+    const auto kFlushInterval = std::chrono::milliseconds(200);
+
+    size_t roundUp(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    int64_t wallClockNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    std::string utcStamp() {
+        std::time_t now = std::time(nullptr);
+        std::tm utc;
+#ifdef _WIN32
+        gmtime_s(&utc, &now);
+#else
+        gmtime_r(&now, &utc);
+#endif
+        char buffer[32];
+        std::strftime(buffer, sizeof(buffer), "%Y%m%d-%H%M%S", &utc);
+        return buffer;
+    }
+
+    void appendTo(std::vector<char>& block, RecordKind kind, uint16_t streamId, int64_t receiveNs,
+                  int64_t exchangeMs, std::string_view payload) {
+        RecordingRecordHeader header = {};
+        header.receiveNs = receiveNs;
+        header.exchangeMs = exchangeMs;
+        header.length = static_cast<uint32_t>(payload.size());
+        header.streamId = streamId;
+        header.kind = kind;
+        const char* bytes = reinterpret_cast<const char*>(&header);
+        block.insert(block.end(), bytes, bytes + sizeof(header));
+        block.insert(block.end(), payload.begin(), payload.end());
+    }
+
+    // Compresses and appends one block, returns the bytes written or 0
+    size_t writeBlock(FILE* file, const std::vector<char>& raw, uint32_t records, int64_t firstNs,
+                      int64_t lastNs, std::vector<unsigned char>& compressed) {
+        uLongf compressedSize = compressBound(static_cast<uLong>(raw.size()));
+        compressed.resize(compressedSize);
+        if (compress2(compressed.data(), &compressedSize, reinterpret_cast<const Bytef*>(raw.data()),
+                      static_cast<uLong>(raw.size()), Z_BEST_SPEED) != Z_OK) {
+            return 0;
+        }
+        RecordingBlockHeader header = {};
+        header.magic = kBlockMagic;
+        header.compressedSize = static_cast<uint32_t>(compressedSize);
+        header.rawSize = static_cast<uint32_t>(raw.size());
+        header.recordCount = records;
+        header.firstReceiveNs = firstNs;
+        header.lastReceiveNs = lastNs;
+        if (fwrite(&header, sizeof(header), 1, file) != 1
+            || fwrite(compressed.data(), 1, compressedSize, file) != compressedSize
+            || fflush(file) != 0) {
+            return 0;
+        }
+        return sizeof(header) + compressedSize;
+    }
+}
+
+RecorderStream::RecorderStream(uint16_t id, const std::string& exchange, size_t ringBytes)
+    : streamId(id), exchangeName(exchange), ring(roundUp(ringBytes)), mask(ring.size() - 1) {
+}
+
+bool RecorderStream::record(std::string_view frame) {
+    size_t needed = kRingHeaderBytes + frame.size();
+    size_t position = tail.load(std::memory_order_relaxed);
+    if (needed > ring.size() - (position - cachedHead)) {
+        // Looks full, refresh the writer's position before giving up
+        cachedHead = head.load(std::memory_order_acquire);
+        if (needed > ring.size() - (position - cachedHead)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+    uint32_t length = static_cast<uint32_t>(frame.size());
+    int64_t receiveNs = wallClockNs();
+    write(position, &length, sizeof(length));
+    write(position + sizeof(length), &receiveNs, sizeof(receiveNs));
+    write(position + kRingHeaderBytes, frame.data(), frame.size());
+    tail.store(position + needed, std::memory_order_release);
+    recorded.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool RecorderStream::peek(int64_t& receiveNs) {
+    size_t position = head.load(std::memory_order_relaxed);
+    if (position == cachedTail) {
+        cachedTail = tail.load(std::memory_order_acquire);
+        if (position == cachedTail) {
+            return false;
+        }
+    }
+    read(position + sizeof(uint32_t), &receiveNs, sizeof(receiveNs));
+    return true;
+}
+
+bool RecorderStream::pop(std::string& frame, int64_t& receiveNs) {
+    size_t position = head.load(std::memory_order_relaxed);
+    if (position == cachedTail) {
+        cachedTail = tail.load(std::memory_order_acquire);
+        if (position == cachedTail) {
+            return false;
+        }
+    }
+    uint32_t length;
+    read(position, &length, sizeof(length));
+    read(position + sizeof(length), &receiveNs, sizeof(receiveNs));
+    frame.resize(length);
+    read(position + kRingHeaderBytes, frame.data(), length);
+    head.store(position + kRingHeaderBytes + length, std::memory_order_release);
+    return true;
+}
+
+void RecorderStream::write(size_t position, const void* data, size_t length) {
+    // Wraps around the end of the ring
+    size_t offset = position & mask;
+    size_t first = std::min(length, ring.size() - offset);
+    memcpy(&ring[offset], data, first);
+    memcpy(&ring[0], static_cast<const char*>(data) + first, length - first);
+}
+
+void RecorderStream::read(size_t position, void* data, size_t length) const {
+    size_t offset = position & mask;
+    size_t first = std::min(length, ring.size() - offset);
+    memcpy(data, &ring[offset], first);
+    memcpy(static_cast<char*>(data) + first, &ring[0], length - first);
+}
+
+MarketDataRecorder::MarketDataRecorder(const std::string& directory, const std::string& prefix)
+    : directory(directory), prefix(prefix), ringBytes(64 << 20), blockBytes(256 << 10),
+      maxFileBytes(uint64_t(512) << 20), running(false), file(nullptr), fileSize(0), blockRecords(0),
+      blockFirstNs(0), blockLastNs(0), framesWritten(0), rawBytesWritten(0), fileBytesWritten(0),
+      filesWritten(0) {
+}
+
+MarketDataRecorder::~MarketDataRecorder() {
+    stop();
+}
+
+void MarketDataRecorder::setRingBytes(size_t bytes) {
+    ringBytes = std::max<size_t>(bytes, 4096);
+}
+
+void MarketDataRecorder::setBlockBytes(size_t bytes) {
+    blockBytes = std::max<size_t>(bytes, 4096);
+}
+
+void MarketDataRecorder::setMaxFileBytes(uint64_t bytes) {
+    maxFileBytes = bytes;
+}
+
+RecorderStream* MarketDataRecorder::addStream(const std::string& exchange) {
+    std::lock_guard<std::mutex> lock(streamsMutex);
+    uint16_t id = static_cast<uint16_t>(streams.size());
+    streams.push_back(std::make_unique<RecorderStream>(id, exchange, ringBytes));
+    return streams.back().get();
+}
+
+bool MarketDataRecorder::start() {
+    if (running) {
+        return true;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cerr << "Cannot create recording directory " << directory << ": " << error.message() << std::endl;
+        return false;
+    }
+    block.reserve(blockBytes + (64 << 10));
+    running = true;
+    writerThread = std::thread(&MarketDataRecorder::writerLoop, this);
+    return true;
+}
+
+void MarketDataRecorder::stop() {
+    running = false;
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+}
+
+RecorderStats MarketDataRecorder::getStats() const {
+    RecorderStats stats;
+    stats.frames = framesWritten.load(std::memory_order_relaxed);
+    stats.rawBytes = rawBytesWritten.load(std::memory_order_relaxed);
+    stats.fileBytes = fileBytesWritten.load(std::memory_order_relaxed);
+    stats.files = filesWritten.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(streamsMutex);
+    for (const auto& stream : streams) {
+        stats.dropped += stream->dropped.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+void MarketDataRecorder::writerLoop() {
+    auto lastFlush = std::chrono::steady_clock::now();
+    while (true) {
+        // Checked before draining, so frames queued before stop() are written
+        bool stopping = !running;
+        bool found = drain(stopping);
+
+        auto now = std::chrono::steady_clock::now();
+        if (!block.empty() && now - lastFlush >= kFlushInterval) {
+            flushBlock();
+        }
+        if (block.empty()) {
+            lastFlush = now;
+        }
+        if (!found) {
+            if (stopping) {
+                break;
+            }
+            // The I/O threads never signal, an idle writer polls
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    flushBlock();
+    closeFile();
+}
+
+bool MarketDataRecorder::drain(bool everything) {
+    activeStreams.clear();
+    {
+        std::lock_guard<std::mutex> lock(streamsMutex);
+        for (const auto& stream : streams) {
+            activeStreams.push_back(stream.get());
+        }
+    }
+
+    // A frame stamped after `now` comes from before the wall clock stepped
+    // back, holding it would stall the stream until the clock catches up
+    int64_t now = wallClockNs();
+    int64_t cutoff = everything ? INT64_MAX : now - kReorderWindowNs;
+    auto due = [&](int64_t receiveNs) { return receiveNs <= cutoff || receiveNs > now; };
+
+    // Min-heap of (receive time, stream) over the streams' next due frames
+    auto later = [](const std::pair<int64_t, size_t>& a, const std::pair<int64_t, size_t>& b) { return a > b; };
+    streamHeap.clear();
+    for (size_t i = 0; i < activeStreams.size(); i++) {
+        int64_t receiveNs;
+        if (activeStreams[i]->peek(receiveNs) && due(receiveNs)) {
+            streamHeap.push_back({receiveNs, i});
+        }
+    }
+    std::make_heap(streamHeap.begin(), streamHeap.end(), later);
+
+    bool found = false;
+    while (!streamHeap.empty()) {
+        std::pop_heap(streamHeap.begin(), streamHeap.end(), later);
+        RecorderStream* stream = activeStreams[streamHeap.back().second];
+        int64_t receiveNs;
+        stream->pop(frame, receiveNs);
+        found = true;
+        // Exchange time from the message itself, off the I/O thread
+        ParseResult result = ParseResult::UNSUPPORTED;
+        if (stream->exchange() == "OKX") {
+            result = MarketDataParser::parseOkx(frame, parsed);
+        } else if (stream->exchange() == "Bybit") {
+            result = MarketDataParser::parseBybit(frame, parsed);
+        } else if (stream->exchange() == "Binance") {
+            result = MarketDataParser::parseBinance(frame, parsed);
+        }
+        int64_t exchangeMs = result == ParseResult::PARSED ? parsed.timestamp : 0;
+
+        appendRecord(RecordKind::FRAME, stream->id(), receiveNs, exchangeMs, frame);
+        if (block.size() >= blockBytes) {
+            flushBlock();
+        }
+
+        if (stream->peek(receiveNs) && due(receiveNs)) {
+            streamHeap.back().first = receiveNs;
+            std::push_heap(streamHeap.begin(), streamHeap.end(), later);
+        } else {
+            streamHeap.pop_back();
+        }
+    }
+    return found;
+}
+
+void MarketDataRecorder::appendRecord(RecordKind kind, uint16_t streamId, int64_t receiveNs, int64_t exchangeMs,
+                                      std::string_view payload) {
+    if (blockRecords == 0) {
+        blockFirstNs = receiveNs;
+    }
+    blockLastNs = receiveNs;
+    blockRecords++;
+    appendTo(block, kind, streamId, receiveNs, exchangeMs, payload);
+}
+
+bool MarketDataRecorder::flushBlock() {
+    if (block.empty()) {
+        return true;
+    }
+    bool written = false;
+    if (file || openFile()) {
+        size_t bytes = writeBlock(file, block, blockRecords, blockFirstNs, blockLastNs, compressed);
+        if (bytes > 0) {
+            written = true;
+            fileSize += bytes;
+            framesWritten.fetch_add(blockRecords, std::memory_order_relaxed);
+            rawBytesWritten.fetch_add(block.size(), std::memory_order_relaxed);
+            fileBytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+        } else {
+            std::cerr << "Failed to write market data block, " << blockRecords << " frames lost" << std::endl;
+            closeFile();
+        }
+    }
+    block.clear();
+    blockRecords = 0;
+
+    // Rotate, the next block opens a new file
+    if (file && fileSize >= maxFileBytes) {
+        closeFile();
+    }
+    return written;
+}
+
+bool MarketDataRecorder::openFile() {
+    std::string name = prefix + "-" + utcStamp() + "-" + std::to_string(filesWritten.load()) + ".mdr";
+    std::string path = (std::filesystem::path(directory) / name).string();
+    file = fopen(path.c_str(), "ab");
+    if (!file) {
+        std::cerr << "Cannot open recording file " << path << std::endl;
+        return false;
+    }
+
+    RecordingFileHeader header = {};
+    memcpy(header.magic, kFileMagic, sizeof(header.magic));
+    header.version = kFileVersion;
+    header.createdNs = wallClockNs();
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        closeFile();
+        return false;
+    }
+    fileSize = sizeof(header);
+
+    // Every file names its streams first so it can be read on its own
+    std::vector<char> names;
+    uint32_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(streamsMutex);
+        for (const auto& stream : streams) {
+            appendTo(names, RecordKind::STREAM, stream->id(), header.createdNs, 0, stream->exchange());
+            count++;
+        }
+    }
+    size_t bytes = writeBlock(file, names, count, header.createdNs, header.createdNs, compressed);
+    if (bytes == 0) {
+        closeFile();
+        return false;
+    }
+    fileSize += bytes;
+    fileBytesWritten.fetch_add(fileSize, std::memory_order_relaxed);
+    filesWritten.fetch_add(1, std::memory_order_relaxed);
+    std::cout << "Recording market data to " << path << std::endl;
+    return true;
+}
+
+void MarketDataRecorder::closeFile() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    fileSize = 0;
+}
+
+MarketDataReader::~MarketDataReader() {
+    close();
+}
+
+bool MarketDataReader::open(const std::string& path) {
+    close();
+    file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    RecordingFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, kFileMagic, sizeof(header.magic)) != 0
+        || header.version != kFileVersion) {
+        std::cerr << "Not a market data recording: " << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MarketDataReader::close() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    block.clear();
+    blockPosition = 0;
+    streamNames.clear();
+}
+
+bool MarketDataReader::readBlock() {
+    RecordingBlockHeader header;
+    if (!file || fread(&header, sizeof(header), 1, file) != 1 || header.magic != kBlockMagic) {
+        return false;
+    }
+    compressed.resize(header.compressedSize);
+    if (fread(compressed.data(), 1, header.compressedSize, file) != header.compressedSize) {
+        // Cut off while it was being written
+        return false;
+    }
+    block.resize(header.rawSize);
+    uLongf rawSize = header.rawSize;
+    if (uncompress(reinterpret_cast<Bytef*>(block.data()), &rawSize, compressed.data(),
+                   header.compressedSize) != Z_OK || rawSize != header.rawSize) {
+        std::cerr << "Corrupt market data block" << std::endl;
+        return false;
+    }
+    blockPosition = 0;
+    return true;
+}
+
+bool MarketDataReader::next(RecordedFrame& frame) {
+    while (true) {
+        if (blockPosition + sizeof(RecordingRecordHeader) > block.size()) {
+            if (!readBlock()) {
+                return false;
+            }
+            continue;
+        }
+        RecordingRecordHeader header;
+        memcpy(&header, &block[blockPosition], sizeof(header));
+        blockPosition += sizeof(header);
+        if (blockPosition + header.length > block.size()) {
+            return false;
+        }
+        std::string_view payload(&block[blockPosition], header.length);
+        blockPosition += header.length;
+
+        if (header.kind == RecordKind::STREAM) {
+            if (streamNames.size() <= header.streamId) {
+                streamNames.resize(header.streamId + 1);
+            }
+            streamNames[header.streamId] = std::string(payload);
+            continue;
+        }
+        frame.receiveNs = header.receiveNs;
+        frame.exchangeMs = header.exchangeMs;
+        frame.streamId = header.streamId;
+        frame.exchange = header.streamId < streamNames.size() ? streamNames[header.streamId] : "";
+        frame.payload.assign(payload.data(), payload.size());
+        return true;
+    }
+}
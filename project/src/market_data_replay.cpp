@@ -0,0 +1,160 @@
+#include "market_data_replay.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+namespace {
+    const char kRecordingExtension[] = ".mdr";
+    // Waits shorter than this are not worth a sleep
+    const auto kMinSleep = std::chrono::microseconds(50);
+
+    struct HeapEntry {
+        int64_t receiveNs;
+        size_t source;
+    };
+
+    // Min-heap on (receiveNs, source) through the std heap functions
+    bool laterThan(const HeapEntry& a, const HeapEntry& b) {
+        if (a.receiveNs != b.receiveNs) {
+            return a.receiveNs > b.receiveNs;
+        }
+        return a.source > b.source;
+    }
+}
+
+MarketDataReplay::MarketDataReplay()
+    : mode(ReplayMode::AS_FAST_AS_POSSIBLE), speed(1.0), stopRequested(false) {}
+
+MarketDataReplay::~MarketDataReplay() = default;
+
+bool MarketDataReplay::addFile(const std::string& path) {
+    auto source = std::make_unique<Source>();
+    if (!source->reader.open(path)) {
+        std::cerr << "Failed to open market data recording " << path << std::endl;
+        return false;
+    }
+    sources.push_back(std::move(source));
+    return true;
+}
+
+size_t MarketDataReplay::addDirectory(const std::string& directory, const std::string& prefix) {
+    std::vector<std::string> paths;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_regular_file() && entry.path().extension() == kRecordingExtension
+            && name.compare(0, prefix.size(), prefix) == 0) {
+            paths.push_back(entry.path().string());
+        }
+    }
+    if (error) {
+        std::cerr << "Failed to list " << directory << ": " << error.message() << std::endl;
+    }
+    // Name order keeps the tie-break between sources the same on every run
+    std::sort(paths.begin(), paths.end());
+    size_t added = 0;
+    for (const std::string& path : paths) {
+        added += addFile(path) ? 1 : 0;
+    }
+    return added;
+}
+
+void MarketDataReplay::setHandler(const std::string& exchange, MessageHandler handler) {
+    handlers[exchange] = std::move(handler);
+    for (auto& source : sources) {
+        source->handlerResolved = false;
+    }
+}
+
+void MarketDataReplay::setFrameCallback(FrameCallback callback) {
+    frameCallback = std::move(callback);
+}
+
+void MarketDataReplay::setMode(ReplayMode replayMode, double replaySpeed) {
+    mode = replayMode;
+    speed = replaySpeed > 0 ? replaySpeed : 1.0;
+}
+
+void MarketDataReplay::stop() {
+    stopRequested = true;
+}
+
+bool MarketDataReplay::advance(Source& source) {
+    if (!source.reader.next(source.frame)) {
+        return false;
+    }
+    if (!source.handlerResolved || source.frame.exchange != source.handlerExchange) {
+        source.handlerExchange = source.frame.exchange;
+        source.handlerResolved = true;
+        auto found = handlers.find(source.handlerExchange);
+        source.handler = found != handlers.end() && found->second ? &found->second : nullptr;
+    }
+    return true;
+}
+
+ReplayStats MarketDataReplay::run() {
+    ReplayStats stats;
+    stopRequested = false;
+    auto wallStart = std::chrono::steady_clock::now();
+
+    std::vector<HeapEntry> heap;
+    heap.reserve(sources.size());
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (advance(*sources[i])) {
+            heap.push_back({sources[i]->frame.receiveNs, i});
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), laterThan);
+
+    // Recorded time maps onto the wall clock from the first frame on
+    double rate = mode == ReplayMode::REAL_TIME ? 1.0 : speed;
+    bool paced = mode != ReplayMode::AS_FAST_AS_POSSIBLE;
+    auto paceStart = std::chrono::steady_clock::now();
+    int64_t paceStartNs = 0;
+
+    while (!heap.empty() && !stopRequested) {
+        std::pop_heap(heap.begin(), heap.end(), laterThan);
+        HeapEntry entry = heap.back();
+        Source& source = *sources[entry.source];
+        const RecordedFrame& frame = source.frame;
+
+        if (stats.frames + stats.unrouted == 0) {
+            paceStartNs = frame.receiveNs;
+            stats.firstReceiveNs = frame.receiveNs;
+        }
+        stats.firstReceiveNs = std::min(stats.firstReceiveNs, frame.receiveNs);
+        stats.lastReceiveNs = std::max(stats.lastReceiveNs, frame.receiveNs);
+
+        if (paced) {
+            auto offset = std::chrono::nanoseconds(
+                static_cast<int64_t>((frame.receiveNs - paceStartNs) / rate));
+            auto due = paceStart + offset;
+            if (due - std::chrono::steady_clock::now() > kMinSleep) {
+                std::this_thread::sleep_until(due);
+            }
+        }
+
+        if (frameCallback) {
+            frameCallback(frame);
+        }
+        if (source.handler) {
+            (*source.handler)(frame.payload);
+            stats.frames++;
+        } else {
+            stats.unrouted++;
+        }
+
+        if (advance(source)) {
+            heap.back() = {source.frame.receiveNs, entry.source};
+            std::push_heap(heap.begin(), heap.end(), laterThan);
+        } else {
+            heap.pop_back();
+        }
+    }
+
+    stats.wallNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - wallStart).count();
+    return stats;
+}
@@ -8,122 +8,142 @@
 #include <algorithm>
 #include <nlohmann/json.hpp>
 #include "env_loader.h"
+#include "history_downloader.h"
+#include "http_engine.h"
 using json = nlohmann::json;
 
-OKXExchange::OKXExchange(): curl(nullptr), websocket(nullptr)
+OKXExchange::OKXExchange(): websocket(nullptr)
 {
     apiKey = EnvLoader::get("OKX_API_KEY");
     apiSecret = EnvLoader::get("OKX_API_SECRET");
     passphrase = EnvLoader::get("OKX_PASSPHRASE");
     std::cout << "OKX API Key: " << apiKey << std::endl;
-    name = "test2";
+    name = "OKX";
     connected = false;
-
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl = curl_easy_init();
-    
-    if (!curl) {
-        std::cerr << "Failed to initialize libcurl for OKX Exchange" << std::endl;
-    }
 }
 OKXExchange::~OKXExchange() {
     disconnectWebSocket();
-    if (curl) {
-        curl_easy_cleanup(curl);
-    }
-    curl_global_cleanup();
 }
 bool OKXExchange::connectWebSocket(const std::string& symbol, const std::string& channel) {
-    // Create WebSocket client if needed
-    if (!websocket) {
-        websocket = std::make_unique<WebSocketClient>();
-        
-        if (!websocket->initialize()) {
-            std::cerr << "Failed to initialize WebSocket client" << std::endl;
-            return false;
+    if (channel != "tickers" && channel.find("candle") != 0 && channel != "trades"
+        && channel != "mark-price" && channel != "books") {
+        std::cerr << "Unsupported OKX channel: " << channel << std::endl;
+        return false;
+    }
+
+    // Every symbol/channel pair shares one connection
+    std::pair<std::string, std::string> subscription(channel, symbol);
+    {
+        std::lock_guard<std::mutex> lock(subscriptionMutex);
+        if (std::find(subscriptions.begin(), subscriptions.end(), subscription) != subscriptions.end()) {
+            return true;
         }
-        
-        // Set callbacks
-        websocket->setMessageCallback([this](const std::string& msg) {
-            handleWebSocketMessage(msg);
-        });
-        
-        websocket->setConnectionCallback([this,&channel, &symbol](bool connected) {
-            std::cout << "OKX WebSocket " << (connected ? "connected" : "disconnected") << std::endl;
-            
-            // Subscribe to channels after connection is established
-            if (connected) {
-                // Add a small delay to ensure the connection is fully established
-                std::this_thread::sleep_for(std::chrono::milliseconds(500));
-                
-                // Send subscription message
-                json subscribeMsg = {
-                    {"op", "subscribe"},
-                    {"args", json::array()}
-                };
-                
-                // Add subscription args
-                if (channel == "tickers") {
-                    subscribeMsg["args"].push_back({
-                        {"channel", "tickers"},
-                        {"instId", symbol}
-                    });
-                } else if (channel.find("candle") == 0) {
-                    // Extract interval from channel name (e.g., "candle1m" -> "1m")
-                    std::string interval = channel.substr(6);
-                    subscribeMsg["args"].push_back({
-                        {"channel", "candle" + interval},
-                        {"instId", symbol}
-                    });
-                } else if (channel == "trades") {
-                    subscribeMsg["args"].push_back({
-                        {"channel", "trades"},
-                        {"instId", symbol}
-                    });
-                } else if (channel == "mark-price") {
-                    subscribeMsg["args"].push_back({
-                        {"channel", "mark-price"},
-                        {"instId", symbol}
-                    });
-                } else if (channel == "books") {
-                    subscribeMsg["args"].push_back({
-                        {"channel", "books"},
-                        {"instId", symbol}
-                    });
-                }
-                
-                websocket->send(subscribeMsg.dump());
-            }
-        });
-        
-        websocket->setErrorCallback([](const std::string& error) {
-            std::cerr << "OKX WebSocket error: " << error << std::endl;
-        });
+        subscriptions.push_back(subscription);
     }
-    
+
+    // Already open: add the pair to the live connection, or it is
+    // subscribed with the others once the connection is up
+    if (websocket) {
+        if (websocket->isConnected()) {
+            sendSubscription("subscribe", {subscription});
+        }
+        return true;
+    }
+
+    websocket = std::make_unique<WebSocketClient>();
+    websocket->setRecorder(recorderStream);
+
+    if (!websocket->initialize()) {
+        std::cerr << "Failed to initialize WebSocket client" << std::endl;
+        websocket.reset();
+        return false;
+    }
+
+    // Set callbacks
+    websocket->setMessageCallback([this](std::string_view msg) {
+        handleWebSocketMessage(msg);
+    });
+
+    websocket->setConnectionCallback([this](bool connected) {
+        std::cout << "OKX WebSocket " << (connected ? "connected" : "disconnected") << std::endl;
+
+        // Subscribe to all channels after connection is established
+        if (connected) {
+            std::vector<std::pair<std::string, std::string>> pending;
+            {
+                std::lock_guard<std::mutex> lock(subscriptionMutex);
+                pending = subscriptions;
+            }
+            sendSubscription("subscribe", pending);
+        } else {
+            // Stale until the snapshots of the next connection
+            for (auto& entry : books) {
+                entry.second.clear();
+            }
+        }
+    });
+
+    websocket->setErrorCallback([](const std::string& error) {
+        std::cerr << "OKX WebSocket error: " << error << std::endl;
+    });
+
     // OKX WebSocket URL
     std::string wsUrl = "wss://ws.okx.com:8443/ws/v5/public";
-    
+
     // Connect to WebSocket
-    return websocket->connect(wsUrl);
+    if (!websocket->connect(wsUrl)) {
+        websocket.reset();
+        return false;
+    }
+    return true;
+}
+
+void OKXExchange::sendSubscription(const std::string& op,
+                                   const std::vector<std::pair<std::string, std::string>>& pairs) {
+    // Keeps each request well below OKX's 64KB message limit
+    const size_t batchSize = 100;
+    for (size_t first = 0; first < pairs.size(); first += batchSize) {
+        json message = {
+            {"op", op},
+            {"args", json::array()}
+        };
+        size_t last = std::min(first + batchSize, pairs.size());
+        for (size_t i = first; i < last; i++) {
+            message["args"].push_back({
+                {"channel", pairs[i].first},
+                {"instId", pairs[i].second}
+            });
+        }
+        websocket->send(message.dump());
+    }
 }
 
 void OKXExchange::disconnectWebSocket() {
     if (websocket) {
         // Send unsubscribe message if connected
         if (websocket->isConnected()) {
-            json unsubscribeMsg = {
-                {"op", "unsubscribe"},
-                {"args", json::array()}
-            };
-            websocket->send(unsubscribeMsg.dump());
-            
+            std::vector<std::pair<std::string, std::string>> active;
+            {
+                std::lock_guard<std::mutex> lock(subscriptionMutex);
+                active = subscriptions;
+            }
+            sendSubscription("unsubscribe", active);
+
             // Give it a moment to process the unsubscribe
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
-        
+
         websocket->disconnect();
+        websocket.reset();
     }
+    // The dispatch thread is gone, nothing else touches the books
+    books.clear();
+    std::lock_guard<std::mutex> lock(subscriptionMutex);
+    subscriptions.clear();
+}
+
+void OKXExchange::setMarketDataRecorder(MarketDataRecorder* recorder) {
+    recorderStream = recorder ? recorder->addStream(name) : nullptr;
 }
 
 bool OKXExchange::isWebSocketConnected() const {
@@ -141,7 +161,17 @@ void OKXExchange::setRealTimeOrderBookCallback(std::function<void(const CommonFo
     orderbookCallback = callback;
 }
 
-void OKXExchange::handleWebSocketMessage(const std::string& message) {
+void OKXExchange::setOrderBookUpdateCallback(std::function<void(const OrderBook&)> callback) {
+    bookUpdateCallback = callback;
+}
+
+void OKXExchange::handleWebSocketMessage(std::string_view message) {
+    // Book and ticker updates take the fast path, everything else the full parse
+    if (MarketDataParser::parseOkx(message, parsedMessage) == ParseResult::PARSED
+        && handleParsedMessage(parsedMessage)) {
+        return;
+    }
+
     try {
         json data = json::parse(message);
 /*
@@ -237,30 +267,7 @@ Received OKX WebSocket message: {
                     }
                 }
             }
-            else if (channel == "books" && orderbookCallback) {
-                for(const auto& item : data["data"]) {
-                    // Process order book updates
-                    CommonFormatData orderbook_data;
-                    orderbook_data.exchange = "OKX";
-                    orderbook_data.symbol = symbol;
-                    orderbook_data.timestamp = std::stoll(item["ts"].get<std::string>());
-
-                    if(item.contains("asks") && item.contains("bids")) 
-                    {
-                        const auto& asks = item["asks"];
-                        const auto& bids = item["bids"];
-                        
-                        for(const auto& ask : asks) {
-                            orderbook_data.asks.push_back(ask[0].get<std::string>());
-                        }
-
-                        for(const auto& bid : bids) {
-                            orderbook_data.bids.push_back(bid[0].get<std::string>());
-                        }
-                        orderbookCallback(orderbook_data);
-                    }
-                }
-               
+            else if (channel == "books") {
                 /*
                  {
     "action": "update",
@@ -306,6 +313,12 @@ Received OKX WebSocket message: {
     ]
 }
                 */
+                // The fast path takes every book message OKX sends, one data item each
+                std::cerr << "Unexpected OKX books message for " << symbol << std::endl;
+                auto found = books.find(symbol);
+                if (found != books.end()) {
+                    resyncOrderBook(found->second);
+                }
             }
         }
     } catch (const std::exception& e) {
@@ -313,6 +326,77 @@ Received OKX WebSocket message: {
     }
 }
 
+bool OKXExchange::handleParsedMessage(const MarketDataMessage& message) {
+    if (message.channel == "books") {
+        handleBookMessage(message);
+        return true;
+    }
+    if ((message.channel == "tickers" || message.channel == "mark-price") && message.hasPrice) {
+        if (priceUpdateCallback) {
+            priceUpdateCallback(std::string(message.symbol), message.price, std::to_string(message.timestamp));
+        }
+        return true;
+    }
+    return false;
+}
+
+void OKXExchange::handleBookMessage(const MarketDataMessage& message) {
+    auto found = books.find(message.symbol);
+    if (found == books.end()) {
+        std::string symbol(message.symbol);
+        found = books.emplace(symbol, OrderBook("OKX", symbol)).first;
+    }
+    OrderBook& book = found->second;
+
+    if (message.type == "snapshot") {
+        book.clear();
+    } else if (!book.isValid()) {
+        // Updates before the snapshot of a resync
+        return;
+    } else if (!message.hasPrevSequence || message.prevSequence != book.sequence) {
+        std::cerr << "OKX " << book.symbol << " book sequence gap: expected prevSeqId " << book.sequence
+                  << ", got " << message.prevSequence << std::endl;
+        resyncOrderBook(book);
+        return;
+    }
+
+    if (!book.apply(message.asks, message.bids)) {
+        std::cerr << "OKX " << book.symbol << " book level could not be parsed" << std::endl;
+        resyncOrderBook(book);
+        return;
+    }
+    book.sequence = message.sequence;
+    book.timestamp = message.timestamp;
+
+    if (message.hasChecksum && book.okxChecksum() != static_cast<int32_t>(message.checksum)) {
+        std::cerr << "OKX " << book.symbol << " book checksum mismatch at seqId " << book.sequence << std::endl;
+        resyncOrderBook(book);
+        return;
+    }
+    book.setValid(true);
+    publishOrderBook(book);
+}
+
+void OKXExchange::resyncOrderBook(OrderBook& book) {
+    book.clear();
+    if (websocket && websocket->isConnected()) {
+        std::pair<std::string, std::string> subscription("books", book.symbol);
+        sendSubscription("unsubscribe", {subscription});
+        sendSubscription("subscribe", {subscription});
+    }
+}
+
+void OKXExchange::publishOrderBook(const OrderBook& book) {
+    if (bookUpdateCallback) {
+        bookUpdateCallback(book);
+    }
+    if (orderbookCallback) {
+        CommonFormatData orderbook_data;
+        book.copyTop(orderbook_data);
+        orderbookCallback(orderbook_data);
+    }
+}
+
 bool OKXExchange::webSocketLogin() {
     if (!websocket || !websocket->isConnected() || 
         api_key.empty() || api_secret.empty() || passphrase.empty()) {
@@ -384,43 +468,79 @@ std::vector<OHLCV> OKXExchange::fetchHistoricalData(const std::string& symbol,
     // Debug output
     std::cout << "Fetching data for instrument: " << formattedSymbol << std::endl;
 
-    // Map timeframe to OKX format
-    std::string okxTimeframe;
-    if (timeframe == "1m") okxTimeframe = "1m";
-    else if (timeframe == "5m") okxTimeframe = "5m";
-    else if (timeframe == "15m") okxTimeframe = "15m";
-    else if (timeframe == "30m") okxTimeframe = "30m";
-    else if (timeframe == "1h") okxTimeframe = "1H";
-    else if (timeframe == "4h") okxTimeframe = "4H";
-    else if (timeframe == "1d") okxTimeframe = "1D";
-    else {
+    std::string okxTimeframe = barInterval(timeframe);
+    if (okxTimeframe.empty()) {
         std::cerr << "Unsupported timeframe: " << timeframe << std::endl;
         return result;
     }
 
-// Build API endpoint
-    std::stringstream ss;
-    ss << "/api/v5/market/candles?instId=" << formattedSymbol;
-    ss << "&bar=" << okxTimeframe;
+    // Without a range, return the latest page
+    if (start_time.empty() || end_time.empty()) {
+        std::string url = buildApiUrl("/api/v5/market/candles?instId=" + formattedSymbol +
+                                      "&bar=" + okxTimeframe + "&limit=100");
+        std::cout << "Request URL: " << url << std::endl; // Debug output
+        parseCandles(makeRequest(url), result);
+        return result;
+    }
 
-    if (!start_time.empty()) {
-        ss << "&after=" << start_time;
+    std::time_t startTime = 0;
+    std::time_t endTime = 0;
+    if (parseTimeRange(start_time, end_time, startTime, endTime)) {
+        fetchHistoricalRange(symbol, timeframe, startTime, endTime, result);
     }
+    return result;
+}
 
-    if (!end_time.empty()) {
-        ss << "&before=" << end_time;
+bool OKXExchange::fetchHistoricalRange(const std::string& symbol, const std::string& timeframe,
+                                       std::time_t startTime, std::time_t endTime, std::vector<OHLCV>& bars) {
+    bars.clear();
+    std::string formattedSymbol = formatSymbol(symbol);
+    std::string okxTimeframe = barInterval(timeframe);
+    if (okxTimeframe.empty()) {
+        std::cerr << "Unsupported timeframe: " << timeframe << std::endl;
+        return false;
     }
 
-    ss << "&limit=100"; // OKX has a maximum limit of 100
+    // history-candles reaches back to the instrument's listing, 100 bars per
+    // request at 20 requests per 2 seconds
+    auto pageUrl = [this, formattedSymbol, okxTimeframe](std::time_t pageStart, std::time_t pageEnd) {
+        // OKX paginates backwards: "after" returns bars older than the given ts and
+        // "before" bars newer than it, both exclusive
+        std::stringstream ss;
+        ss << "/api/v5/market/history-candles?instId=" << formattedSymbol;
+        ss << "&bar=" << okxTimeframe;
+        ss << "&after=" << (static_cast<long long>(pageEnd) * 1000 + 1);
+        ss << "&before=" << (static_cast<long long>(pageStart) * 1000 - 1);
+        ss << "&limit=100";
 
-    std::string url = buildApiUrl(ss.str());
-    std::cout << "Request URL: " << url << std::endl; // Debug output
+        return buildApiUrl(ss.str());
+    };
 
-    std::string response = makeRequest(url);
+    auto parsePage = [this](const std::string& response, std::vector<OHLCV>& pageBars) {
+        return parseCandles(response, pageBars);
+    };
+
+    HistoryDownloader downloader(4, 9.0);
+    return downloader.download(startTime, endTime, HistoryDownloader::timeframeSeconds(timeframe), 100,
+                               pageUrl, parsePage, bars);
+}
 
+std::string OKXExchange::barInterval(const std::string& timeframe) {
+    // Map timeframe to OKX format
+    if (timeframe == "1m") return "1m";
+    if (timeframe == "5m") return "5m";
+    if (timeframe == "15m") return "15m";
+    if (timeframe == "30m") return "30m";
+    if (timeframe == "1h") return "1H";
+    if (timeframe == "4h") return "4H";
+    if (timeframe == "1d") return "1D";
+    return "";
+}
+
+bool OKXExchange::parseCandles(const std::string& response, std::vector<OHLCV>& candles) {
     if (response.empty()) {
         std::cerr << "Empty response from OKX API" << std::endl;
-        return result;
+        return false;
     }
 
     try {
@@ -439,16 +559,15 @@ std::vector<OHLCV> OKXExchange::fetchHistoricalData(const std::string& symbol,
                 candle.close = std::stod(item[4].get<std::string>());
                 candle.volume = std::stod(item[5].get<std::string>());
 
-                result.push_back(candle);
+                candles.push_back(candle);
             }
-    } else {
-            std::cerr << "Error in OKX API response: " << response << std::endl;
+            return true;
         }
-    }catch (const std::exception& e) {
+        std::cerr << "Error in OKX API response: " << response << std::endl;
+    } catch (const std::exception& e) {
         std::cerr << "Error parsing OKX response: " << e.what() << std::endl;
     }
-
-    return result;
+    return false;
 }
 double OKXExchange::getCurrentPrice(const std::string& symbol) {
     std::string formattedSymbol = formatSymbol(symbol);
@@ -693,33 +812,14 @@ std::string OKXExchange::getTimestamp() {
     return ss.str();
 }
 
-size_t OKXExchange::WriteCallback(void* contents, size_t size, size_t nmemb, std::string* s) {
-    size_t newLength = size * nmemb;
-    try {
-        s->append((char*)contents, newLength);
-        return newLength;
-    } catch (const std::bad_alloc& e) {
-        // Handle memory problem
-        return 0;
-    }
-}
-
 std::string OKXExchange::makeRequest(const std::string& url, const std::string& method, 
                                      const std::string& data, const std::string& timestamp) {
-    if (!curl) {
-        std::cerr << "CURL not initialized" << std::endl;
-        return "";
-    }
-    
-    std::string responseString;
     std::string actualTimestamp = timestamp.empty() ? getTimestamp() : timestamp;
-    
-    curl_easy_reset(curl);
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseString);
-    
-    struct curl_slist* headers = NULL;
+
+    HttpRequest request;
+    request.method = method;
+    request.url = url;
+    request.body = data;
     
     // For authenticated requests
     if (!api_key.empty() && !api_secret.empty()) {
@@ -736,36 +836,20 @@ std::string OKXExchange::makeRequest(const std::string& url, const std::string&
         
         std::string signature = signRequest(signData);
         
-        headers = curl_slist_append(headers, ("OK-ACCESS-KEY: " + api_key).c_str());
-        headers = curl_slist_append(headers, ("OK-ACCESS-SIGN: " + signature).c_str());
-        headers = curl_slist_append(headers, ("OK-ACCESS-TIMESTAMP: " + actualTimestamp).c_str());
-        headers = curl_slist_append(headers, ("OK-ACCESS-PASSPHRASE: " + passphrase).c_str());
+        request.headers.push_back("OK-ACCESS-KEY: " + api_key);
+        request.headers.push_back("OK-ACCESS-SIGN: " + signature);
+        request.headers.push_back("OK-ACCESS-TIMESTAMP: " + actualTimestamp);
+        request.headers.push_back("OK-ACCESS-PASSPHRASE: " + passphrase);
     }
     
     // Common headers
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    
-    // Set HTTP method and data
-    if (method == "POST") {
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        if (!data.empty()) {
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
-        }
-    } else if (method != "GET") {
-        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.c_str());
-        if (!data.empty()) {
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
-        }
-    }
-    
-    CURLcode res = curl_easy_perform(curl);
-    curl_slist_free_all(headers);
+    request.headers.push_back("Content-Type: application/json");
     
-    if (res != CURLE_OK) {
-        std::cerr << "CURL error: " << curl_easy_strerror(res) << std::endl;
+    HttpResponse response = HttpEngine::instance().perform(std::move(request));
+    if (!response.error.empty()) {
+        std::cerr << "CURL error: " << response.error << std::endl;
         return "";
     }
     
-    return responseString;
+    return response.body;
 }
\ No newline at end of file
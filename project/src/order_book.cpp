@@ -0,0 +1,159 @@
+#include "order_book.h"
+#include "exchange.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+
+namespace {
+    // OKX checksums cover this many levels per side
+    const size_t kChecksumDepth = 25;
+
+    std::array<uint32_t, 256> makeCrcTable() {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+
+    // Standard CRC-32 (the zlib one)
+    uint32_t crc32(const char* data, size_t length) {
+        static const std::array<uint32_t, 256> table = makeCrcTable();
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < length; i++) {
+            crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    bool parseNumber(std::string_view text, double& value) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == std::errc() && result.ptr == text.data() + text.size();
+    }
+
+    bool copyText(std::string_view text, char (&target)[24]) {
+        if (text.size() >= sizeof(target)) {
+            return false;
+        }
+        memcpy(target, text.data(), text.size());
+        target[text.size()] = '\0';
+        return true;
+    }
+
+    void appendLevel(std::string& out, const BookLevel& level) {
+        out += level.priceText;
+        out += ':';
+        out += level.sizeText;
+        out += ':';
+    }
+}
+
+OrderBook::OrderBook(const std::string& exchange, const std::string& symbol)
+    : exchange(exchange), symbol(symbol) {
+}
+
+void OrderBook::clear() {
+    bids.clear();
+    asks.clear();
+    sequence = 0;
+    valid = false;
+}
+
+bool OrderBook::update(OrderSide side, std::string_view price, std::string_view size) {
+    double priceValue;
+    double sizeValue;
+    if (!parseNumber(price, priceValue) || !parseNumber(size, sizeValue)) {
+        return false;
+    }
+    return update(side, priceValue, sizeValue, price, size);
+}
+
+bool OrderBook::update(OrderSide side, double price, double size, std::string_view priceText,
+                       std::string_view sizeText) {
+    BookLevel level;
+    level.price = price;
+    level.size = size;
+    if (!copyText(priceText, level.priceText) || !copyText(sizeText, level.sizeText)) {
+        return false;
+    }
+
+    std::vector<BookLevel>& levels = side == OrderSide::BUY ? bids : asks;
+    // Bids ascend and asks descend, both towards the best price at the back
+    auto position = side == OrderSide::BUY
+        ? std::lower_bound(levels.begin(), levels.end(), level.price,
+                           [](const BookLevel& l, double p) { return l.price < p; })
+        : std::lower_bound(levels.begin(), levels.end(), level.price,
+                           [](const BookLevel& l, double p) { return l.price > p; });
+
+    bool exists = position != levels.end() && position->price == level.price;
+    if (level.size == 0) {
+        if (exists) {
+            levels.erase(position);
+        }
+    } else if (exists) {
+        *position = level;
+    } else {
+        levels.insert(position, level);
+    }
+    return true;
+}
+
+bool OrderBook::apply(const std::vector<ParsedLevel>& askLevels, const std::vector<ParsedLevel>& bidLevels) {
+    // Size "0" removes a level
+    bool parsed = true;
+    for (const ParsedLevel& ask : askLevels) {
+        parsed &= update(OrderSide::SELL, ask.price, ask.size, ask.priceText, ask.sizeText);
+    }
+    for (const ParsedLevel& bid : bidLevels) {
+        parsed &= update(OrderSide::BUY, bid.price, bid.size, bid.priceText, bid.sizeText);
+    }
+    return parsed;
+}
+
+size_t OrderBook::depth(OrderSide side) const {
+    return side == OrderSide::BUY ? bids.size() : asks.size();
+}
+
+const BookLevel& OrderBook::level(OrderSide side, size_t index) const {
+    const std::vector<BookLevel>& levels = side == OrderSide::BUY ? bids : asks;
+    return levels[levels.size() - 1 - index];
+}
+
+void OrderBook::copyTop(CommonFormatData& out) const {
+    out.exchange = exchange;
+    out.symbol = symbol;
+    out.timestamp = timestamp;
+    out.askCount = std::min<size_t>(ORDERBOOK_DEPTH, asks.size());
+    for (size_t i = 0; i < out.askCount; i++) {
+        const BookLevel& ask = level(OrderSide::SELL, i);
+        out.asks[i] = {ask.price, ask.size};
+    }
+    out.bidCount = std::min<size_t>(ORDERBOOK_DEPTH, bids.size());
+    for (size_t i = 0; i < out.bidCount; i++) {
+        const BookLevel& bid = level(OrderSide::BUY, i);
+        out.bids[i] = {bid.price, bid.size};
+    }
+}
+
+int32_t OrderBook::okxChecksum() const {
+    // Reused so checking every update does not allocate
+    thread_local std::string text;
+    text.clear();
+    for (size_t i = 0; i < kChecksumDepth; i++) {
+        if (i < bids.size()) {
+            appendLevel(text, level(OrderSide::BUY, i));
+        }
+        if (i < asks.size()) {
+            appendLevel(text, level(OrderSide::SELL, i));
+        }
+    }
+    if (!text.empty()) {
+        text.pop_back();
+    }
+    return static_cast<int32_t>(crc32(text.data(), text.size()));
+}
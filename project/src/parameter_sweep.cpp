@@ -0,0 +1,154 @@
+#include "parameter_sweep.h"
+#include <algorithm>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+ParameterSweep::ParameterSweep(size_t threadCount)
+: indicatorCache(std::make_shared<IndicatorCache>()),
+  pool(std::make_unique<ThreadPool>(threadCount))
+{
+}
+
+void ParameterSweep::setInitialCapital(double capital)
+{
+    initialCapital = capital;
+}
+void ParameterSweep::setCommissionRate(double rate)
+{
+    commissionRate = rate;
+}
+void ParameterSweep::setIndicatorCache(std::shared_ptr<IndicatorCache> cache)
+{
+    indicatorCache = std::move(cache);
+}
+
+std::vector<std::map<std::string, double>> ParameterSweep::buildGrid(
+    const std::map<std::string, std::vector<double>>& axes)
+{
+    std::vector<std::map<std::string, double>> grid(1);
+    for (const auto& axis : axes)
+    {
+        if (axis.second.empty())
+        {
+            continue;
+        }
+        std::vector<std::map<std::string, double>> expanded;
+        expanded.reserve(grid.size() * axis.second.size());
+        for (const auto& partial : grid)
+        {
+            for (double value : axis.second)
+            {
+                std::map<std::string, double> combination = partial;
+                combination[axis.first] = value;
+                expanded.push_back(std::move(combination));
+            }
+        }
+        grid = std::move(expanded);
+    }
+    return grid;
+}
+
+std::vector<SweepResult> ParameterSweep::run(
+    const Strategy& prototype,
+    std::span<const OHLCV> data,
+    const std::vector<std::map<std::string, double>>& parameterSets
+)
+{
+    return runJobs(prototype, parameterSets,
+        [data](BacktestEngine& engine, std::shared_ptr<Strategy> strategy, double capital) {
+            return engine.runBacktest(strategy, data, capital);
+        });
+}
+
+std::vector<SweepResult> ParameterSweep::run(
+    const Strategy& prototype,
+    const BarSeriesView& data,
+    const std::vector<std::map<std::string, double>>& parameterSets
+)
+{
+    // Hashed once here, not per job
+    uint64_t datasetId = indicatorCache ? IndicatorCache::datasetId(data) : 0;
+    return runJobs(prototype, parameterSets,
+        [this, data, datasetId](BacktestEngine& engine, std::shared_ptr<Strategy> strategy, double capital) {
+            strategy->setIndicatorCache(indicatorCache, datasetId);
+            return engine.runBacktest(strategy, data, capital);
+        });
+}
+
+std::vector<SweepResult> ParameterSweep::runJobs(
+    const Strategy& prototype,
+    const std::vector<std::map<std::string, double>>& parameterSets,
+    const BacktestJob& backtest
+)
+{
+    std::vector<std::future<BacktestResult>> jobs;
+    jobs.reserve(parameterSets.size());
+    for (const auto& params : parameterSets)
+    {
+        // The clone is made up front, jobs never touch the prototype
+        std::shared_ptr<Strategy> strategy = prototype.clone();
+        strategy->setVerbose(false);
+        jobs.push_back(pool->submit([this, strategy, &backtest, &params]() {
+            strategy->initialize(params);
+            BacktestEngine engine;
+            engine.setVerbose(false);
+            // Metrics are accumulated per bar, no job needs its equity curve
+            engine.setEquityCurveStep(0);
+            engine.setCommissionRate(commissionRate);
+            return backtest(engine, strategy, initialCapital);
+        }));
+    }
+
+    std::vector<SweepResult> results;
+    results.reserve(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        try
+        {
+            results.push_back(SweepResult{parameterSets[i], jobs[i].get()});
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Sweep job " << i << " failed: " << e.what() << std::endl;
+        }
+    }
+
+    rank(results);
+    return results;
+}
+
+void ParameterSweep::rank(std::vector<SweepResult>& results)
+{
+    // Stable so equal results keep the order they were submitted in
+    std::stable_sort(results.begin(), results.end(), [](const SweepResult& a, const SweepResult& b) {
+        if (a.result.totalReturn != b.result.totalReturn)
+        {
+            return a.result.totalReturn > b.result.totalReturn;
+        }
+        return a.result.maxDrawdown < b.result.maxDrawdown;
+    });
+}
+
+std::string ParameterSweep::generateReport(const std::vector<SweepResult>& results, size_t maxRows) const
+{
+    std::stringstream ss;
+    ss << "===== PARAMETER SWEEP RESULTS (" << results.size() << " runs) =====\n\n";
+    for (size_t i = 0; i < results.size() && i < maxRows; i++)
+    {
+        const SweepResult& row = results[i];
+        ss << "#" << (i + 1) << " ";
+        for (const auto& param : row.parameters)
+        {
+            ss << param.first << "=" << param.second << " ";
+        }
+        ss << "| Return: " << std::fixed << std::setprecision(2) << row.result.totalReturn << "%"
+           << " | Max DD: " << (row.result.maxDrawdown * 100.0) << "%"
+           << " | Sharpe: " << row.result.metrics.sharpe
+           << " | Trades: " << row.result.totalTrades
+           << " | Win Rate: " << (row.result.winRate * 100.0) << "%\n";
+        ss << std::defaultfloat << std::setprecision(6);
+    }
+    return ss.str();
+}
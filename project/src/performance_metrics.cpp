@@ -0,0 +1,148 @@
+#include "performance_metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include "backtest_engine.h"
+
+namespace {
+    const double kSecondsPerYear = 365.0 * 24 * 60 * 60;
+}
+
+void PerformanceMetrics::reset(double equity) {
+    double periods = periodsPerYear;
+    *this = PerformanceMetrics();
+    periodsPerYear = periods;
+    initialEquity = equity;
+    lastEquity = equity;
+    peakEquity = equity;
+}
+
+void PerformanceMetrics::setPeriodsPerYear(double periods) {
+    periodsPerYear = periods;
+}
+
+void PerformanceMetrics::addBar(std::time_t time, double equity, bool inMarket) {
+    if (bars == 0) {
+        firstTime = time;
+        peakTime = time;
+    } else if (inMarket) {
+        // The bar spans the time since the previous one
+        timeInMarket += time - lastTime;
+    }
+    bars++;
+
+    if (lastEquity > 0) {
+        double value = equity / lastEquity - 1;
+        returnCount++;
+        double delta = value - returnMean;
+        returnMean += delta / returnCount;
+        returnM2 += delta * (value - returnMean);
+        if (value < 0) {
+            downsideSquares += value * value;
+        }
+    }
+
+    if (equity >= peakEquity) {
+        peakEquity = equity;
+        peakTime = time;
+    } else if (peakEquity > 0) {
+        maxDrawdown = std::max(maxDrawdown, (peakEquity - equity) / peakEquity);
+    }
+    if (equity < peakEquity) {
+        maxDrawdownDuration = std::max(maxDrawdownDuration, time - peakTime);
+    }
+
+    lastEquity = equity;
+    lastTime = time;
+}
+
+void PerformanceMetrics::addTrade(const Trade& trade) {
+    trades++;
+    if (trade.profit > 0) {
+        wins++;
+        grossProfit += trade.profit;
+    } else {
+        grossLoss -= trade.profit;
+    }
+    totalMAE += trade.mae;
+    totalMFE += trade.mfe;
+    worstMAE = std::max(worstMAE, trade.mae);
+    bestMFE = std::max(bestMFE, trade.mfe);
+}
+
+void PerformanceMetrics::mergeTrades(const PerformanceMetrics& other) {
+    trades += other.trades;
+    wins += other.wins;
+    grossProfit += other.grossProfit;
+    grossLoss += other.grossLoss;
+    totalMAE += other.totalMAE;
+    totalMFE += other.totalMFE;
+    worstMAE = std::max(worstMAE, other.worstMAE);
+    bestMFE = std::max(bestMFE, other.bestMFE);
+}
+
+PerformanceSummary PerformanceMetrics::summary() const {
+    PerformanceSummary result;
+    result.bars = bars;
+    result.trades = trades;
+    result.maxDrawdown = maxDrawdown;
+    result.maxDrawdownDuration = maxDrawdownDuration;
+
+    double elapsed = static_cast<double>(lastTime - firstTime);
+    if (elapsed > 0) {
+        result.exposure = static_cast<double>(timeInMarket) / elapsed;
+    }
+    double periods = periodsPerYear;
+    if (periods <= 0 && elapsed > 0 && returnCount > 0) {
+        periods = returnCount * kSecondsPerYear / elapsed;
+    }
+    if (elapsed > 0 && initialEquity > 0 && lastEquity > 0) {
+        result.annualizedReturn = std::pow(lastEquity / initialEquity, kSecondsPerYear / elapsed) - 1;
+    }
+    if (returnCount > 1 && periods > 0) {
+        double deviation = std::sqrt(returnM2 / (returnCount - 1));
+        double downside = std::sqrt(downsideSquares / returnCount);
+        result.volatility = deviation * std::sqrt(periods);
+        if (deviation > 0) {
+            result.sharpe = returnMean / deviation * std::sqrt(periods);
+        }
+        if (downside > 0) {
+            result.sortino = returnMean / downside * std::sqrt(periods);
+        }
+    }
+    if (maxDrawdown > 0) {
+        result.calmar = result.annualizedReturn / maxDrawdown;
+    }
+
+    if (trades > 0) {
+        uint64_t losses = trades - wins;
+        result.averageTrade = (grossProfit - grossLoss) / trades;
+        result.averageWin = wins > 0 ? grossProfit / wins : 0;
+        result.averageLoss = losses > 0 ? -grossLoss / losses : 0;
+        result.averageMAE = totalMAE / trades;
+        result.averageMFE = totalMFE / trades;
+        result.worstMAE = worstMAE;
+        result.bestMFE = bestMFE;
+    }
+    if (grossLoss > 0) {
+        result.profitFactor = grossProfit / grossLoss;
+    }
+    return result;
+}
+
+std::string PerformanceMetrics::format(const PerformanceSummary& summary) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "Drawdown Duration: " << summary.maxDrawdownDuration / 86400.0 << " days\n";
+    ss << "Annualized Return: " << (summary.annualizedReturn * 100.0) << "%\n";
+    ss << "Volatility: " << (summary.volatility * 100.0) << "%\n";
+    ss << "Sharpe: " << summary.sharpe << "  Sortino: " << summary.sortino << "  Calmar: " << summary.calmar << "\n";
+    ss << "Exposure: " << (summary.exposure * 100.0) << "%\n";
+    ss << "Profit Factor: " << summary.profitFactor << "\n";
+    ss << "Average Trade: $" << summary.averageTrade
+       << " (win $" << summary.averageWin << ", loss $" << summary.averageLoss << ")\n";
+    ss << "MAE avg/worst: " << (summary.averageMAE * 100.0) << "% / " << (summary.worstMAE * 100.0) << "%\n";
+    ss << "MFE avg/best: " << (summary.averageMFE * 100.0) << "% / " << (summary.bestMFE * 100.0) << "%\n";
+    return ss.str();
+}
@@ -0,0 +1,259 @@
+#include "portfolio_backtest.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include "fill_simulator.h"
+
+namespace {
+    struct HeapEntry {
+        std::time_t timestamp;
+        size_t stream;
+    };
+
+    // Min-heap on (timestamp, stream) through the std heap functions
+    bool laterThan(const HeapEntry& a, const HeapEntry& b) {
+        if (a.timestamp != b.timestamp) {
+            return a.timestamp > b.timestamp;
+        }
+        return a.stream > b.stream;
+    }
+}
+
+PortfolioBacktest::PortfolioBacktest() = default;
+
+void PortfolioBacktest::setCommissionRate(double rate) {
+    commissionRate = rate;
+}
+
+void PortfolioBacktest::setSlippage(double fraction) {
+    slippage = fraction;
+}
+
+void PortfolioBacktest::setMaxLeverage(double leverage) {
+    maxLeverage = leverage;
+}
+
+void PortfolioBacktest::setMaxPositionFraction(double fraction) {
+    maxPositionFraction = fraction;
+}
+
+void PortfolioBacktest::setMaintenanceMargin(double fraction) {
+    maintenanceMargin = fraction;
+}
+
+void PortfolioBacktest::setCurveInterval(std::time_t seconds) {
+    curveInterval = std::max<std::time_t>(seconds, 1);
+}
+
+void PortfolioBacktest::setRecordHistory(bool enabled) {
+    recordHistory = enabled;
+}
+
+void PortfolioBacktest::setFillCallback(std::function<void(const FillEvent&)> callback) {
+    fillCallback = std::move(callback);
+}
+
+void PortfolioBacktest::setVerbose(bool enabled) {
+    verbose = enabled;
+}
+
+void PortfolioBacktest::addSymbol(std::shared_ptr<Strategy> strategy, const BarSeriesView& bars) {
+    streams.push_back(Stream{std::move(strategy), bars});
+}
+
+PortfolioResult PortfolioBacktest::run(double initialCapital) {
+    PortfolioResult result;
+    result.initialBalance = initialCapital;
+
+    TradingAccount account(initialCapital);
+    account.setCommissionRate(commissionRate);
+    account.setSlippage(slippage);
+    account.setMaxLeverage(maxLeverage);
+    account.setMaxPositionFraction(maxPositionFraction);
+    account.setMaintenanceMargin(maintenanceMargin);
+    account.setFillCallback(fillCallback);
+
+    const size_t count = streams.size();
+    result.symbols.resize(count);
+    std::vector<FillSimulator> simulators;
+    simulators.reserve(count);
+    std::vector<size_t> cursors(count, 0);
+    std::vector<HeapEntry> heap;
+    heap.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        SymbolResult& symbol = result.symbols[i];
+        symbol.symbol = streams[i].bars.symbolName();
+        symbol.result = BacktestResult{};
+        simulators.emplace_back(account, symbol.result, verbose, recordHistory);
+        streams[i].strategy->reset();
+        if (!streams[i].bars.empty()) {
+            heap.push_back({streams[i].bars.timestamp()[0], i});
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), laterThan);
+
+    auto sample = [&](std::time_t time) {
+        result.curveTimes.push_back(time);
+        result.equityCurve.push_back(account.equity());
+        for (size_t i = 0; i < count; i++) {
+            result.symbols[i].result.equityCurve.push_back(initialCapital + simulators[i].profit());
+        }
+    };
+
+    // The portfolio takes one metrics point per timestamp, each symbol one
+    // per bar with its profit on top of the initial capital
+    PerformanceMetrics metrics;
+    metrics.reset(initialCapital);
+    std::vector<PerformanceMetrics> symbolMetrics(count);
+    for (size_t i = 0; i < count; i++) {
+        symbolMetrics[i].reset(initialCapital);
+        simulators[i].setMetrics(&symbolMetrics[i]);
+    }
+
+    std::vector<PathPoint> path;
+    size_t openPositions = 0;
+    std::time_t lastTime = 0;
+    std::time_t currentBucket = 0;
+    bool started = false;
+    bool inMarket = false;
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), laterThan);
+        HeapEntry entry = heap.back();
+        const size_t i = entry.stream;
+        const BarSeriesView& bars = streams[i].bars;
+        const size_t index = cursors[i];
+
+        if (started && entry.timestamp != lastTime) {
+            metrics.addBar(lastTime, account.equity(), inMarket);
+            inMarket = openPositions > 0;
+        }
+        // Curve points are taken before the first bar of each interval
+        std::time_t bucket = entry.timestamp / curveInterval;
+        if (!started || bucket != currentBucket) {
+            sample(started ? lastTime : entry.timestamp);
+            currentBucket = bucket;
+            started = true;
+        }
+        lastTime = entry.timestamp;
+
+        // As in BacktestEngine the first bar of a series only seeds the strategy
+        FillSimulator& simulator = simulators[i];
+        bool hadPosition = simulator.hasPosition();
+        int tradesBefore = result.symbols[i].result.totalTrades;
+        std::vector<Signal> signals = streams[i].strategy->onBar(bars, index);
+        if (index > 0) {
+            for (const Signal& signal : signals) {
+                simulator.queue(signal);
+            }
+        }
+        ohlcPath(bars.timestamp()[index], bars.open()[index], bars.high()[index], bars.low()[index],
+                 bars.close()[index], path);
+        simulator.walk(path, true);
+        bool lastBar = index + 1 == bars.size();
+        if (lastBar) {
+            // No prices after this, the position cannot be held any longer
+            simulator.closeOut();
+        }
+        bool symbolInMarket = hadPosition || simulator.hasPosition()
+            || result.symbols[i].result.totalTrades != tradesBefore;
+        inMarket = inMarket || symbolInMarket;
+        if (simulator.hasPosition() && !hadPosition) {
+            openPositions++;
+        } else if (!simulator.hasPosition() && hadPosition) {
+            openPositions--;
+        }
+
+        if (account.isMarginCall()) {
+            result.marginCalls++;
+            for (FillSimulator& position : simulators) {
+                position.closeOut(FillReason::LIQUIDATION);
+            }
+            openPositions = 0;
+        }
+
+        double equity = account.equity();
+        if (equity > 0) {
+            result.maxLeverageUsed = std::max(result.maxLeverageUsed, account.grossExposure() / equity);
+        }
+        result.maxOpenPositions = std::max(result.maxOpenPositions, openPositions);
+        symbolMetrics[i].addBar(entry.timestamp, initialCapital + simulator.profit(), symbolInMarket);
+
+        if (!lastBar) {
+            cursors[i]++;
+            heap.back() = {bars.timestamp()[cursors[i]], i};
+            std::push_heap(heap.begin(), heap.end(), laterThan);
+        } else {
+            heap.pop_back();
+        }
+    }
+
+    if (started) {
+        metrics.addBar(lastTime, account.equity(), inMarket);
+        sample(lastTime);
+    }
+
+    result.finalBalance = account.equity();
+    result.totalReturn = ((result.finalBalance - initialCapital) / initialCapital) * 100.0;
+    result.totalFees = account.totalFees();
+    for (size_t i = 0; i < count; i++) {
+        result.symbols[i].profit = simulators[i].profit();
+        BacktestResult& symbolResult = result.symbols[i].result;
+        symbolResult.initialBalance = initialCapital;
+        symbolResult.finalBalance = initialCapital + result.symbols[i].profit;
+        symbolResult.totalReturn = (result.symbols[i].profit / initialCapital) * 100.0;
+        symbolResult.winRate = symbolResult.totalTrades > 0
+            ? static_cast<double>(symbolResult.winningTrades) / symbolResult.totalTrades : 0.0;
+        symbolResult.metrics = symbolMetrics[i].summary();
+        symbolResult.maxDrawdown = symbolResult.metrics.maxDrawdown;
+        metrics.mergeTrades(symbolMetrics[i]);
+        result.totalTrades += symbolResult.totalTrades;
+        result.winningTrades += symbolResult.winningTrades;
+        result.losingTrades += symbolResult.losingTrades;
+        result.cancelledOrders += symbolResult.cancelledOrders;
+    }
+    result.winRate = result.totalTrades > 0 ? static_cast<double>(result.winningTrades) / result.totalTrades : 0.0;
+    result.metrics = metrics.summary();
+    result.maxDrawdown = result.metrics.maxDrawdown;
+    return result;
+}
+
+std::string PortfolioBacktest::generateReport(const PortfolioResult& result, size_t maxSymbols) const {
+    std::stringstream ss;
+    ss << "===== PORTFOLIO BACKTEST RESULTS (" << result.symbols.size() << " symbols) =====\n\n";
+    ss << std::fixed << std::setprecision(2);
+    ss << "Initial Capital: $" << result.initialBalance << "\n";
+    ss << "Final Capital: $" << result.finalBalance << "\n";
+    ss << "Total Return: " << result.totalReturn << "%\n";
+    ss << "Max Drawdown: " << (result.maxDrawdown * 100.0) << "%\n\n";
+
+    ss << "Total Trades: " << result.totalTrades << "\n";
+    ss << "Win Rate: " << (result.winRate * 100.0) << "%\n";
+    ss << "Fees Paid: $" << result.totalFees << "\n";
+    ss << "Cancelled Orders: " << result.cancelledOrders << "\n";
+    ss << "Max Open Positions: " << result.maxOpenPositions << "\n";
+    ss << "Max Leverage Used: " << result.maxLeverageUsed << "x\n";
+    ss << "Margin Calls: " << result.marginCalls << "\n";
+    ss << PerformanceMetrics::format(result.metrics) << "\n";
+
+    // Biggest contributors first, winners and losers alike
+    std::vector<const SymbolResult*> ranked;
+    for (const SymbolResult& symbol : result.symbols) {
+        ranked.push_back(&symbol);
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const SymbolResult* a, const SymbolResult* b) {
+        return std::abs(a->profit) > std::abs(b->profit);
+    });
+    for (size_t i = 0; i < ranked.size() && i < maxSymbols; i++) {
+        const BacktestResult& symbol = ranked[i]->result;
+        ss << std::left << std::setw(16) << ranked[i]->symbol << std::right
+           << " profit $" << ranked[i]->profit
+           << " (" << symbol.totalReturn << "%)"
+           << " trades " << symbol.totalTrades
+           << " win " << (symbol.winRate * 100.0) << "%"
+           << " fees $" << symbol.totalFees
+           << " sharpe " << symbol.metrics.sharpe << "\n";
+    }
+    return ss.str();
+}
@@ -0,0 +1,332 @@
+#include "session_calendar.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace {
+    const int64_t kSecondsPerDay = 86400;
+    const int kLastRuleYear = 2100;
+
+    // Floor division and modulo for b > 0, without branches
+    int64_t floorDiv(int64_t a, int64_t b) {
+        return a / b - ((a % b) < 0);
+    }
+
+    int64_t floorMod(int64_t a, int64_t b) {
+        int64_t r = a % b;
+        return r + b * (r < 0);
+    }
+
+    // Proleptic Gregorian date <-> days since 1970-01-01 (Howard Hinnant's algorithms)
+    int64_t daysFromCivil(int64_t year, int month, int day) {
+        year -= month <= 2;
+        int64_t era = floorDiv(year, 400);
+        int64_t yearOfEra = year - era * 400;
+        int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + dayOfEra - 719468;
+    }
+
+    void civilFromDays(int64_t days, int64_t& year, int& month, int& day) {
+        days += 719468;
+        int64_t era = floorDiv(days, 146097);
+        int64_t dayOfEra = days - era * 146097;
+        int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+        day = static_cast<int>(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+        month = static_cast<int>(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+        year = yearOfEra + era * 400 + (month <= 2);
+    }
+
+    int64_t readBigEndian(const unsigned char* data, size_t bytes) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; i++) {
+            value = (value << 8) | data[i];
+        }
+        // Sign-extend 4-byte values
+        if (bytes == 4) {
+            return static_cast<int32_t>(static_cast<uint32_t>(value));
+        }
+        return static_cast<int64_t>(value);
+    }
+
+    // One side of a POSIX TZ rule, "Mm.w.d[/time]": weekday d (0 = Sunday)
+    // of week w (5 = last) in month m, at time local wall clock
+    struct RuleDate {
+        int month = 0;
+        int week = 0;
+        int weekday = 0;
+        int32_t time = 2 * 3600;
+    };
+
+    // POSIX TZ rule from a TZif footer such as "EST5EDT,M3.2.0,M11.1.0"
+    struct PosixRule {
+        int32_t standardOffset = 0;
+        int32_t daylightOffset = 0;
+        bool hasDaylight = false;
+        RuleDate start;
+        RuleDate end;
+    };
+
+    void skipName(const std::string& text, size_t& pos) {
+        if (pos < text.size() && text[pos] == '<') {
+            pos = text.find('>', pos);
+            pos = pos == std::string::npos ? text.size() : pos + 1;
+            return;
+        }
+        while (pos < text.size() && std::isalpha(static_cast<unsigned char>(text[pos]))) {
+            pos++;
+        }
+    }
+
+    // [+-]hh[:mm[:ss]] in seconds
+    bool parseTime(const std::string& text, size_t& pos, int32_t& seconds) {
+        int sign = 1;
+        if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+            sign = text[pos] == '-' ? -1 : 1;
+            pos++;
+        }
+        int32_t parts[3] = {0, 0, 0};
+        for (int part = 0; part < 3; part++) {
+            if (pos >= text.size() || !std::isdigit(static_cast<unsigned char>(text[pos]))) {
+                if (part == 0) {
+                    return false;
+                }
+                break;
+            }
+            while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+                parts[part] = parts[part] * 10 + (text[pos++] - '0');
+            }
+            if (pos >= text.size() || text[pos] != ':') {
+                break;
+            }
+            pos++;
+        }
+        seconds = sign * (parts[0] * 3600 + parts[1] * 60 + parts[2]);
+        return true;
+    }
+
+    bool parseRuleDate(const std::string& text, size_t& pos, RuleDate& date) {
+        if (pos >= text.size() || text[pos] != 'M') {
+            return false;  // Julian day forms are not used by current zones
+        }
+        if (std::sscanf(text.c_str() + pos, "M%d.%d.%d", &date.month, &date.week, &date.weekday) != 3) {
+            return false;
+        }
+        pos = text.find_first_of(",/", pos);
+        if (pos != std::string::npos && text[pos] == '/') {
+            pos++;
+            if (!parseTime(text, pos, date.time)) {
+                return false;
+            }
+        }
+        pos = pos == std::string::npos ? text.size() : pos;
+        return true;
+    }
+
+    bool parsePosixRule(const std::string& text, PosixRule& rule) {
+        size_t pos = 0;
+        int32_t offset;
+        skipName(text, pos);
+        if (!parseTime(text, pos, offset)) {
+            return false;
+        }
+        // POSIX offsets are west of Greenwich
+        rule.standardOffset = -offset;
+        rule.daylightOffset = rule.standardOffset + 3600;
+        if (pos >= text.size()) {
+            return true;
+        }
+        skipName(text, pos);
+        if (pos < text.size() && text[pos] != ',') {
+            if (!parseTime(text, pos, offset)) {
+                return false;
+            }
+            rule.daylightOffset = -offset;
+        }
+        if (pos >= text.size() || text[pos] != ',') {
+            return false;
+        }
+        pos++;
+        if (!parseRuleDate(text, pos, rule.start) || pos >= text.size() || text[pos] != ',') {
+            return false;
+        }
+        pos++;
+        rule.hasDaylight = parseRuleDate(text, pos, rule.end);
+        return rule.hasDaylight;
+    }
+
+    // UTC time of a rule date in year, while offset is in effect
+    std::time_t ruleTransition(int64_t year, const RuleDate& date, int32_t offset) {
+        int64_t first = daysFromCivil(year, date.month, 1);
+        int64_t firstWeekday = floorMod(first + 4, 7);  // 1970-01-01 was a Thursday
+        int64_t day = first + floorMod(date.weekday - firstWeekday, 7) + (date.week - 1) * 7;
+        int64_t nextMonth = date.month == 12 ? daysFromCivil(year + 1, 1, 1) : daysFromCivil(year, date.month + 1, 1);
+        while (day >= nextMonth) {
+            day -= 7;
+        }
+        return day * kSecondsPerDay + date.time - offset;
+    }
+}
+
+SessionCalendar SessionCalendar::fixedOffset(int32_t offsetSeconds) {
+    SessionCalendar calendar;
+    calendar.offsets = {offsetSeconds};
+    return calendar;
+}
+
+SessionCalendar SessionCalendar::fromTransitions(std::vector<OffsetTransition> transitions) {
+    SessionCalendar calendar;
+    if (transitions.empty()) {
+        return calendar;
+    }
+    std::sort(transitions.begin(), transitions.end(), [](const OffsetTransition& a, const OffsetTransition& b) {
+        return a.from < b.from;
+    });
+    calendar.offsets = {transitions.front().offset};
+    for (const OffsetTransition& transition : transitions) {
+        calendar.transitionTimes.push_back(transition.from);
+        calendar.offsets.push_back(transition.offset);
+    }
+    return calendar;
+}
+
+bool SessionCalendar::loadZone(const std::string& name, const std::string& directory) {
+    std::ifstream file(directory + "/" + name, std::ios::binary);
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < 44 || data[0] != 'T' || data[1] != 'Z' || data[2] != 'i' || data[3] != 'f') {
+        std::cerr << "Cannot read time zone " << name << " from " << directory << std::endl;
+        return false;
+    }
+
+    // Header counts: UT/local flags, standard/wall flags, leap seconds,
+    // transitions, local time types, abbreviation bytes
+    auto counts = [&data](size_t header, int64_t* out) {
+        for (int i = 0; i < 6; i++) {
+            out[i] = readBigEndian(&data[header + 20 + i * 4], 4);
+        }
+    };
+    int64_t count[6];
+    counts(0, count);
+    size_t header = 0;
+    size_t timeBytes = 4;
+    if (data[4] >= '2') {
+        // Skip the 32-bit block, the 64-bit one after it covers every year
+        size_t skipped = count[3] * 5 + count[4] * 6 + count[5] + count[2] * 8 + count[1] + count[0];
+        header = 44 + skipped;
+        if (data.size() < header + 44) {
+            std::cerr << "Truncated time zone file for " << name << std::endl;
+            return false;
+        }
+        counts(header, count);
+        timeBytes = 8;
+    }
+    size_t times = header + 44;
+    size_t indices = times + count[3] * timeBytes;
+    size_t types = indices + count[3];
+    size_t end = types + count[4] * 6 + count[5] + count[2] * (timeBytes + 4) + count[1] + count[0];
+    if (count[4] == 0 || data.size() < end) {
+        std::cerr << "Truncated time zone file for " << name << std::endl;
+        return false;
+    }
+
+    auto typeOffset = [&](size_t type) {
+        return static_cast<int32_t>(readBigEndian(&data[types + std::min<size_t>(type, count[4] - 1) * 6], 4));
+    };
+    std::vector<OffsetTransition> transitions;
+    for (int64_t i = 0; i < count[3]; i++) {
+        transitions.push_back({static_cast<std::time_t>(readBigEndian(&data[times + i * timeBytes], timeBytes)),
+                               typeOffset(data[indices + i])});
+    }
+    // Type 0 applies before the first transition
+    int32_t initialOffset = typeOffset(0);
+
+    // The footer rule continues the table past its last transition
+    if (timeBytes == 8 && end + 1 < data.size() && data[end] == '\n') {
+        std::string footer(data.begin() + end + 1, data.end());
+        footer = footer.substr(0, footer.find('\n'));
+        PosixRule rule;
+        if (parsePosixRule(footer, rule) && rule.hasDaylight) {
+            // Fat files end on a 2038-01-19 sentinel, the rule takes over
+            // from there even within that year
+            int64_t firstYear = 1970;
+            std::time_t last = std::numeric_limits<std::time_t>::min();
+            if (!transitions.empty()) {
+                last = transitions.back().from;
+                int month;
+                int day;
+                civilFromDays(floorDiv(last, kSecondsPerDay), firstYear, month, day);
+            }
+            for (int64_t year = firstYear; year <= kLastRuleYear; year++) {
+                OffsetTransition start{ruleTransition(year, rule.start, rule.standardOffset), rule.daylightOffset};
+                OffsetTransition end{ruleTransition(year, rule.end, rule.daylightOffset), rule.standardOffset};
+                for (const OffsetTransition& transition : {start, end}) {
+                    if (transition.from > last) {
+                        transitions.push_back(transition);
+                    }
+                }
+            }
+        }
+    }
+
+    int32_t start = sessionStart;
+    *this = fromTransitions(std::move(transitions));
+    offsets.front() = initialOffset;
+    sessionStart = start;
+    return true;
+}
+
+void SessionCalendar::setSessionStart(int minuteOfDay) {
+    sessionStart = static_cast<int32_t>(floorMod(minuteOfDay, 24 * 60) * 60);
+}
+
+int32_t SessionCalendar::utcOffset(std::time_t time) const {
+    if (offsets.size() == 1) {
+        return offsets.front();
+    }
+    auto it = std::upper_bound(transitionTimes.begin(), transitionTimes.end(), time);
+    return offsets[it - transitionTimes.begin() - 1];
+}
+
+int64_t SessionCalendar::dayIndex(std::time_t time) const {
+    return floorDiv(static_cast<int64_t>(time) + utcOffset(time) - sessionStart, kSecondsPerDay);
+}
+
+std::time_t SessionCalendar::startOfDay(std::time_t time) const {
+    int64_t localStart = dayIndex(time) * kSecondsPerDay + sessionStart;
+    // The offset at the start can differ from the one at time when a DST
+    // change falls inside the day
+    int32_t offset = utcOffset(localStart - utcOffset(time));
+    return localStart - offset;
+}
+
+int SessionCalendar::minuteOfDay(std::time_t time) const {
+    return static_cast<int>(floorMod(static_cast<int64_t>(time) + utcOffset(time), kSecondsPerDay) / 60);
+}
+
+std::string SessionCalendar::formatDate(std::time_t time) const {
+    int64_t year;
+    int month;
+    int day;
+    civilFromDays(dayIndex(time), year, month, day);
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%04lld-%02d-%02d", static_cast<long long>(year), month, day);
+    return buffer;
+}
+
+uint64_t SessionCalendar::id() const {
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ static_cast<uint32_t>(sessionStart);
+    auto mix = [&hash](uint64_t value) {
+        hash = (hash ^ value) * 0x100000001B3ULL;
+        hash ^= hash >> 29;
+    };
+    for (size_t i = 0; i < offsets.size(); i++) {
+        mix(static_cast<uint64_t>(transitionTimes[i]));
+        mix(static_cast<uint32_t>(offsets[i]));
+    }
+    return hash;
+}
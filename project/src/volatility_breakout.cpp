@@ -6,6 +6,43 @@
 #include <sstream>
 #include <iomanip>
 
+namespace {
+    const double kNoHigh = -1;
+    const double kNoLow = 999999999;
+    // Price action filters: trend over the 5 bars before the current one,
+    // range 20% above the mean of the 5 bars before it
+    const int kTrendLookback = 5;
+    const int kRangeWindow = 5;
+    const double kRangeExpansion = 1.2;
+
+    // What processBar finds as the previous day's high (or low) on the first
+    // bar of each day: the extreme of the day just finished if it is exactly
+    // one calendar day back, otherwise no data. Other bars repeat the value.
+    std::vector<double> previousDayLevels(const BarSeriesView& bars, const std::vector<double>& dayStarts,
+                                          const SessionCalendar& calendar, bool high) {
+        const double none = high ? kNoHigh : kNoLow;
+        std::span<const double> prices = high ? bars.high() : bars.low();
+        std::vector<double> levels(bars.size(), none);
+        double level = none;
+        double running = none;
+        double currentDay = 0;
+        for (size_t i = 0; i < bars.size(); i++) {
+            double day = dayStarts[i];
+            if (i > 0 && day != currentDay) {
+                double previousDay = static_cast<double>(calendar.startOfDay(static_cast<std::time_t>(day) - 1));
+                level = currentDay == previousDay ? running : none;
+            }
+            if (i == 0 || day != currentDay) {
+                currentDay = day;
+                running = none;
+            }
+            running = high ? std::max(running, prices[i]) : std::min(running, prices[i]);
+            levels[i] = level;
+        }
+        return levels;
+    }
+}
+
 VolatilityBreakout::VolatilityBreakout() {
     // Initialize with default parameters
     breakoutFactor = 0.25;  // Larry Williams' default value
@@ -17,12 +54,13 @@ VolatilityBreakout::VolatilityBreakout() {
     atrPeriod = 14;         // Standard ATR period
     exitHour = 21;          // Exit time (21:59)
     exitMinute = 59;
+    skipFirstHour = false;
+    avoidLastHalfHour = false;
+    trendFilter = false;
+    rangeFilter = false;
     
     // Initialize tracking data
-    previousDayHigh.high = -1;
-    previousDayHigh.timestamp = 0;
-    previousDayLow.low = 999999999;
-    previousDayLow.timestamp = 0;
+    reset();
     
     // Store in parameters map for initialization
     parameters["breakoutFactor"] = breakoutFactor;
@@ -52,90 +90,199 @@ bool VolatilityBreakout::initialize(const std::map<std::string, double>& params)
     if (parameters.count("atrPeriod") > 0) atrPeriod = static_cast<int>(parameters["atrPeriod"]);
     if (parameters.count("exitHour") > 0) exitHour = static_cast<int>(parameters["exitHour"]);
     if (parameters.count("exitMinute") > 0) exitMinute = static_cast<int>(parameters["exitMinute"]);
+    skipFirstHour = parameters.count("skipFirstHour") > 0 && parameters["skipFirstHour"] != 0;
+    avoidLastHalfHour = parameters.count("avoidLastHalfHour") > 0 && parameters["avoidLastHalfHour"] > 0.5;
+    trendFilter = parameters.count("trendFilter") > 0 && parameters["trendFilter"] > 0.5;
+    rangeFilter = parameters.count("rangeFilter") > 0 && parameters["rangeFilter"] > 0.5;
+    
+    if (verbose) {
+        std::cout << "Initialized Larry Williams Volatility Breakout strategy with:" << std::endl;
+        std::cout << "- Breakout Factor: " << breakoutFactor << std::endl;
+        std::cout << "- Profit Factor: " << profitFactor << std::endl;
+        std::cout << "- Stop Loss Factor: " << stopLossFactor << std::endl;
+        std::cout << "- Using ATR: " << (useATR ? "Yes" : "No") << std::endl;
+        if (useATR) std::cout << "- ATR Period: " << atrPeriod << std::endl;
+        std::cout << "- Exit Time: " << exitHour << ":" << exitMinute << std::endl;
+    }
     
-    std::cout << "Initialized Larry Williams Volatility Breakout strategy with:" << std::endl;
-    std::cout << "- Breakout Factor: " << breakoutFactor << std::endl;
-    std::cout << "- Profit Factor: " << profitFactor << std::endl;
-    std::cout << "- Stop Loss Factor: " << stopLossFactor << std::endl;
-    std::cout << "- Using ATR: " << (useATR ? "Yes" : "No") << std::endl;
-    if (useATR) std::cout << "- ATR Period: " << atrPeriod << std::endl;
-    std::cout << "- Exit Time: " << exitHour << ":" << exitMinute << std::endl;
+    // Parameters may resize the rolling windows, start from a clean series
+    reset();
     
     return true;
 }
 
+std::shared_ptr<Strategy> VolatilityBreakout::clone() const {
+    // Same parameters, fresh series state
+    auto copy = std::make_shared<VolatilityBreakout>(*this);
+    copy->indicatorCache.reset();
+    copy->reset();
+    return copy;
+}
+
 std::vector<Signal> VolatilityBreakout::processData(const std::vector<OHLCV>& data) {
-    std::vector<Signal> signals;
+    // Batch path: replay the whole series through onBar from a clean state,
+    // so batch and streaming signals are identical by construction
+    reset();
     
-    // Need at least requiredBars bars to calculate
-    if (data.size() < requiredBars) {
-        return signals;
+    std::vector<Signal> signals;
+    for (const auto& bar : data) {
+        std::vector<Signal> barSignals = onBar(bar);
+        signals.insert(signals.end(), barSignals.begin(), barSignals.end());
     }
     
-    // Get the current symbol from the data
-    std::string symbol = "UNKNOWN";
-    if (!data.empty() && !data[0].symbol.empty()) {
-        symbol = data[0].symbol;
-    } else if (exchange) {
-        // In real implementation, extract symbol from data or context
-        symbol = "BTC-USDT"; // Default for testing
-    }
+    return signals;
+}
+
+void VolatilityBreakout::reset() {
+    hasTradingDay = false;
+    activeTrades.clear();
+    upperBreakoutLevels.clear();
+    lowerBreakoutLevels.clear();
+    profitTargets.clear();
+    stopLosses.clear();
+    positionEntryTimes.clear();
     
-    // Calculate ATR if needed
-    double atr = 0.0;
-    if (useATR && data.size() >= atrPeriod) {
-        atr = calculateATR(data, atrPeriod);
+    previousDayHigh.high = -1;
+    previousDayHigh.timestamp = 0;
+    previousDayLow.low = 999999999;
+    previousDayLow.timestamp = 0;
+    
+    symbol.clear();
+    barCount = 0;
+    currentDay = 0;
+    currentDayHigh = -1;
+    currentDayLow = 999999999;
+    lastClose = 0.0;
+    trueRanges.assign(std::max(atrPeriod, 1), 0.0);
+    trueRangeHead = 0;
+    trueRangeCount = 0;
+    recentBars.clear();
+    dayStarts.reset();
+    previousDayHighs.reset();
+    previousDayLows.reset();
+    atrValues.reset();
+    trendFlags.reset();
+    rangeExpansionFlags.reset();
+}
+
+void VolatilityBreakout::setSessionCalendar(const SessionCalendar& sessionCalendar) {
+    calendar = sessionCalendar;
+}
+
+void VolatilityBreakout::setIndicatorCache(std::shared_ptr<IndicatorCache> cache, uint64_t id) {
+    indicatorCache = std::move(cache);
+    datasetId = id;
+}
+
+void VolatilityBreakout::loadIndicatorColumns(const BarSeriesView& series) {
+    // Day boundaries depend on the calendar, its id goes into the key
+    uint64_t calendarId = calendar.id();
+    std::vector<double> calendarKey = {static_cast<double>(calendarId >> 32),
+                                       static_cast<double>(calendarId & 0xFFFFFFFFu)};
+    dayStarts = indicatorCache->get(datasetId, "sessionDayStart", calendarKey, [this, &series]() {
+        std::vector<double> starts(series.size());
+        for (size_t i = 0; i < series.size(); i++) {
+            starts[i] = static_cast<double>(getStartOfDay(series.timestamp()[i]));
+        }
+        return starts;
+    });
+    previousDayHighs = indicatorCache->get(datasetId, "sessionPreviousDayHigh", calendarKey, [&series, this]() {
+        return previousDayLevels(series, *dayStarts, calendar, true);
+    });
+    previousDayLows = indicatorCache->get(datasetId, "sessionPreviousDayLow", calendarKey, [&series, this]() {
+        return previousDayLevels(series, *dayStarts, calendar, false);
+    });
+    if (useATR) {
+        atrValues = indicatorCache->atr(series, datasetId, atrPeriod);
+    }
+    // Same windows as isStrongTrend and isRangeExpansion
+    if (trendFilter) {
+        trendFlags = indicatorCache->trendMask(series, datasetId, kTrendLookback);
+    }
+    if (rangeFilter) {
+        rangeExpansionFlags = indicatorCache->rangeExpansionMask(series, datasetId, kRangeWindow, kRangeExpansion);
     }
     
-    // Find day boundaries in the data
-    std::vector<size_t> dayBoundaries;
-    for (size_t i = 1; i < data.size(); i++) {
-        if (isNewDay(data[i], data[i-1])) {
-            dayBoundaries.push_back(i);
+    // A dataset id that is not this series' would index past the columns
+    for (const IndicatorCache::Column* column : {&dayStarts, &previousDayHighs, &previousDayLows, &atrValues,
+                                                 &trendFlags, &rangeExpansionFlags}) {
+        if (*column && (*column)->size() != series.size()) {
+            std::cerr << "Indicator cache columns do not match the series, computing them per bar" << std::endl;
+            dayStarts.reset();
+            previousDayHighs.reset();
+            previousDayLows.reset();
+            atrValues.reset();
+            trendFlags.reset();
+            rangeExpansionFlags.reset();
+            return;
         }
     }
+}
+
+std::vector<Signal> VolatilityBreakout::onBar(const OHLCV& bar) {
+    return processBar(bar.timestamp, bar.open, bar.high, bar.low, bar.close, bar.symbol);
+}
+
+std::vector<Signal> VolatilityBreakout::onBar(const BarSeriesView& series, size_t index) {
+    // Read the columns directly, no OHLCV is materialized. The symbol is only
+    // used by the first bar of a series, skip the table lookup otherwise.
+    static const std::string noSymbol;
+    if (barCount == 0 && index == 0 && indicatorCache) {
+        loadIndicatorColumns(series);
+    }
+    return processBar(series.timestamp()[index], series.open()[index], series.high()[index],
+                      series.low()[index], series.close()[index],
+                      barCount == 0 ? series.symbolName() : noSymbol);
+}
+
+std::vector<Signal> VolatilityBreakout::processBar(std::time_t timestamp, double open, double high,
+                                                   double low, double close, const std::string& barSymbol) {
+    std::vector<Signal> signals;
     
-    // If we don't have day boundaries yet, initialize from scratch
-    if (dayBoundaries.empty() && previousDayHigh.timestamp == 0) {
-        // Find the highest high and lowest low from the previous day
-        std::time_t currentDay = getStartOfDay(data.back().timestamp);
-        std::time_t previousDay = currentDay - 86400; // Previous day
-        
-        double prevDayHigh = -1;
-        double prevDayLow = 999999999;
-        
-        for (const auto& bar : data) {
-            std::time_t barDay = getStartOfDay(bar.timestamp);
-            if (barDay == previousDay) {
-                prevDayHigh = std::max(prevDayHigh, bar.high);
-                prevDayLow = std::min(prevDayLow, bar.low);
-            }
+    // Position of this bar in the series, as in data[index] of the batch loop
+    size_t index = barCount++;
+    
+    // Get the current symbol from the first bar
+    if (index == 0) {
+        if (!barSymbol.empty()) {
+            symbol = barSymbol;
+        } else if (exchange) {
+            // In real implementation, extract symbol from data or context
+            symbol = "BTC-USDT"; // Default for testing
+        } else {
+            symbol = "UNKNOWN";
         }
-        
-        // Initialize with previous day data
-        previousDayHigh.high = prevDayHigh;
-        previousDayHigh.timestamp = previousDay;
-        previousDayLow.low = prevDayLow;
-        previousDayLow.timestamp = previousDay;
     }
     
-    // Process each day boundary
-    for (size_t i = 0; i < dayBoundaries.size(); i++) {
-        size_t dayStart = dayBoundaries[i];
-        
-        // Find previous day's data
-        double prevDayHigh = -1;
-        double prevDayLow = 999999999;
-        std::time_t currentDay = getStartOfDay(data[dayStart].timestamp);
-        std::time_t previousDay = currentDay - 86400;
-        
-        // Determine previous day's high and low
-        for (const auto& bar : data) {
-            std::time_t barDay = getStartOfDay(bar.timestamp);
-            if (barDay == previousDay) {
-                prevDayHigh = std::max(prevDayHigh, bar.high);
-                prevDayLow = std::min(prevDayLow, bar.low);
-            }
+    // Roll the true range window (needs the previous close)
+    if (index > 0 && useATR && !atrValues) {
+        double trueHigh = std::max(high, lastClose);
+        double trueLow = std::min(low, lastClose);
+        trueRanges[trueRangeHead] = trueHigh - trueLow;
+        trueRangeHead = (trueRangeHead + 1) % trueRanges.size();
+        trueRangeCount = std::min(trueRangeCount + 1, trueRanges.size());
+    }
+    lastClose = close;
+    
+    // Roll the price action filter window
+    recentBars.push_back(BarStats{high, low, timestamp});
+    if (recentBars.size() > 7) {
+        recentBars.pop_front();
+    }
+    
+    std::time_t barDay = dayStarts ? static_cast<std::time_t>((*dayStarts)[index]) : getStartOfDay(timestamp);
+    if (index > 0 && barDay != currentDay) {
+        // New day: the day that just finished is the previous day only if it is
+        // exactly one calendar day back, otherwise there is no previous-day data
+        std::time_t previousDay = getStartOfDay(barDay - 1);
+        double prevDayHigh = kNoHigh;
+        double prevDayLow = kNoLow;
+        if (previousDayHighs) {
+            prevDayHigh = (*previousDayHighs)[index];
+            prevDayLow = (*previousDayLows)[index];
+        } else if (currentDay == previousDay) {
+            prevDayHigh = currentDayHigh;
+            prevDayLow = currentDayLow;
         }
         
         // Update tracking
@@ -144,7 +291,11 @@ std::vector<Signal> VolatilityBreakout::processData(const std::vector<OHLCV>& da
         previousDayLow.low = prevDayLow;
         previousDayLow.timestamp = previousDay;
         
-        // Calculate range (either simple range or ATR)
+        // Calculate range (either simple range or ATR as of the day's first bar)
+        double atr = 0.0;
+        if (useATR) {
+            atr = atrValues ? (*atrValues)[index] : calculateATR(atrPeriod);
+        }
         double rangeSize;
         if (useATR && atr > 0) {
             rangeSize = atr * breakoutFactor;
@@ -153,243 +304,266 @@ std::vector<Signal> VolatilityBreakout::processData(const std::vector<OHLCV>& da
         }
         
         // Calculate breakout levels for today
-        double upperBound = data[dayStart].open + rangeSize;
-        double lowerBound = data[dayStart].open - rangeSize;
+        double upperBound = open + rangeSize;
+        double lowerBound = open - rangeSize;
         
         // Store in maps
         upperBreakoutLevels[symbol] = upperBound;
         lowerBreakoutLevels[symbol] = lowerBound;
         
-        // Store in trading day map
-        std::time_t dayTimestamp = getStartOfDay(data[dayStart].timestamp);
-        tradingDays[dayTimestamp] = TradingDay{
-            .date = dayTimestamp,
-            .open = data[dayStart].open,
+        // Only today's levels are needed going forward
+        currentTradingDay = TradingDay{
+            .date = barDay,
+            .open = open,
             .upperBound = upperBound,
             .lowerBound = lowerBound,
             .rangeSize = rangeSize,
             .hasLongSignal = false,
             .hasShortSignal = false
         };
+        hasTradingDay = true;
         
-        std::cout << "New day detected " << formatTimestamp(dayTimestamp) << ". Breakout levels for " << symbol 
+        if (verbose) std::cout << "New day detected " << formatTimestamp(barDay) << ". Breakout levels for " << symbol 
                   << ": Upper=" << upperBound << ", Lower=" << lowerBound << std::endl;
     }
     
-    // Process each bar for entry and exit signals
-    for (size_t i = excludeFirstNBars; i < data.size(); i++) {
-        const OHLCV& currentBar = data[i];
-        
-        // Skip if outside valid trading hours
-        if (!isValidTradingTime(currentBar)) {
-            continue;
-        }
-        
-        // Find which trading day this bar belongs to
-        std::time_t currentDay = getStartOfDay(currentBar.timestamp);
+    // Roll the running high/low of the current day
+    if (index == 0 || barDay != currentDay) {
+        currentDay = barDay;
+        currentDayHigh = -1;
+        currentDayLow = 999999999;
+    }
+    if (!previousDayHighs) {
+        currentDayHigh = std::max(currentDayHigh, high);
+        currentDayLow = std::min(currentDayLow, low);
+    }
+    
+    // Warm-up bars only feed the rolling state
+    if (index < static_cast<size_t>(std::max(excludeFirstNBars, 0)) ||
+        barCount < static_cast<size_t>(std::max(requiredBars, 0))) {
+        return signals;
+    }
+    
+    // Skip if outside valid trading hours
+    if (!isValidTradingTime(timestamp)) {
+        return signals;
+    }
+    
+    // Check for breakout entry signals
+    if (hasTradingDay && currentTradingDay.date == barDay) {
+        TradingDay& day = currentTradingDay;
         
-        // Check for breakout entry signals
-        if (tradingDays.count(currentDay) > 0) {
-            TradingDay& day = tradingDays[currentDay];
+        // Only generate signals if we haven't already for this day
+        // Long entry
+        if (!day.hasLongSignal && isLongSignal(high, day.upperBound)) {
+            // Check additional filters
+            bool takeTrade = true;
             
-            // Only generate signals if we haven't already for this day
-            // Long entry
-            if (!day.hasLongSignal && isLongSignal(currentBar.high, day.upperBound)) {
-                // Check additional filters
-                bool takeTrade = true;
+            // Optional: Add trend filter
+            if (trendFilter) {
+                takeTrade = trendFlags ? (*trendFlags)[index] != 0 : isStrongTrend(recentBars, kTrendLookback);
+            }
+            
+            // Optional: Add range expansion filter
+            if (takeTrade && rangeFilter) {
+                takeTrade = rangeExpansionFlags ? (*rangeExpansionFlags)[index] != 0 : isRangeExpansion(recentBars);
+            }
+            
+            if (takeTrade) {
+                day.hasLongSignal = true;
                 
-                // Optional: Add trend filter
-                if (parameters.count("trendFilter") > 0 && parameters["trendFilter"] > 0.5) {
-                    takeTrade = isStrongTrend(data, i, 5);
-                }
+                // Calculate entry price (at the breakout level)
+                double entryPrice = day.upperBound;
+                double rangeSize = day.rangeSize;
                 
-                // Optional: Add range expansion filter
-                if (takeTrade && parameters.count("rangeFilter") > 0 && parameters["rangeFilter"] > 0.5) {
-                    takeTrade = isRangeExpansion(data, i);
-                }
+                // Calculate stop loss
+                double stopLoss = entryPrice - (rangeSize * stopLossFactor);
                 
-                if (takeTrade) {
-                    day.hasLongSignal = true;
-                    
-                    // Calculate entry price (at the breakout level)
-                    double entryPrice = day.upperBound;
-                    double rangeSize = day.rangeSize;
-                    
-                    // Calculate stop loss
-                    double stopLoss = entryPrice - (rangeSize * stopLossFactor);
-                    
-                    // Calculate profit target
-                    double profitTarget = entryPrice + (rangeSize * profitFactor);
-                    
-                    // Create position size - risk 1% of account per trade (10000 HKD starter)
-                    double accountSize = 10000.0; // Your initial capital
-                    double riskPercent = 0.01;    // 1% risk
-                    double positionSize = calculatePositionSize(accountSize, riskPercent, entryPrice, stopLoss);
-                    
-                    // Create signal
-                    Signal signal;
-                    signal.symbol = symbol;
-                    signal.side = OrderSide::BUY;
-                    signal.suggestedPrice = entryPrice;
-                    signal.suggestedQuantity = positionSize;
-                    signal.timestamp = currentBar.timestamp;
-                    signal.reason = "Volatility Breakout Long";
-                    
-                    // Store trade data
-                    ActiveTrade trade;
-                    trade.symbol = symbol;
-                    trade.entryPrice = entryPrice;
-                    trade.entryTime = currentBar.timestamp;
-                    trade.direction = OrderSide::BUY;
-                    trade.profitTarget = profitTarget;
-                    trade.stopLoss = stopLoss;
-                    trade.quantity = positionSize;
-                    activeTrades[symbol] = trade;
-                    
-                    // Store for legacy code compatibility
-                    profitTargets[symbol] = profitTarget;
-                    stopLosses[symbol] = stopLoss;
-                    positionEntryTimes[symbol] = currentBar.timestamp;
-                    
-                    signals.push_back(signal);
-                    
-                    std::cout << "LONG signal for " << symbol << " at " << entryPrice 
-                              << " (Target: " << profitTarget << ", Stop: " << stopLoss 
-                              << ", Size: " << positionSize << ")" << std::endl;
-                }
-            }
-            
-            // Short entry
-            if (!day.hasShortSignal && isShortSignal(currentBar.low, day.lowerBound)) {
-                // Check additional filters
-                bool takeTrade = true;
+                // Calculate profit target
+                double profitTarget = entryPrice + (rangeSize * profitFactor);
+                
+                // Create position size - risk 1% of account per trade (10000 HKD starter)
+                double accountSize = 10000.0; // Your initial capital
+                double riskPercent = 0.01;    // 1% risk
+                double positionSize = calculatePositionSize(accountSize, riskPercent, entryPrice, stopLoss);
+                
+                // Create signal
+                Signal signal;
+                signal.symbol = symbol;
+                signal.side = OrderSide::BUY;
+                signal.suggestedPrice = entryPrice;
+                signal.suggestedQuantity = positionSize;
+                signal.timestamp = timestamp;
+                signal.reason = "Volatility Breakout Long";
+                // Resting stop at the breakout level with its bracket
+                signal.orderType = OrderType::STOP;
+                signal.takeProfit = profitTarget;
+                signal.stopLoss = stopLoss;
                 
-                // Optional: Add trend filter
-                if (parameters.count("trendFilter") > 0 && parameters["trendFilter"] > 0.5) {
-                    takeTrade = isStrongTrend(data, i, 5);
-                }
+                // Store trade data
+                ActiveTrade trade;
+                trade.symbol = symbol;
+                trade.entryPrice = entryPrice;
+                trade.entryTime = timestamp;
+                trade.direction = OrderSide::BUY;
+                trade.profitTarget = profitTarget;
+                trade.stopLoss = stopLoss;
+                trade.quantity = positionSize;
+                activeTrades[symbol] = trade;
                 
-                // Optional: Add range expansion filter
-                if (takeTrade && parameters.count("rangeFilter") > 0 && parameters["rangeFilter"] > 0.5) {
-                    takeTrade = isRangeExpansion(data, i);
-                }
+                // Store for legacy code compatibility
+                profitTargets[symbol] = profitTarget;
+                stopLosses[symbol] = stopLoss;
+                positionEntryTimes[symbol] = timestamp;
                 
-                if (takeTrade) {
-                    day.hasShortSignal = true;
-                    
-                    // Calculate entry price (at the breakout level)
-                    double entryPrice = day.lowerBound;
-                    double rangeSize = day.rangeSize;
-                    
-                    // Calculate stop loss
-                    double stopLoss = entryPrice + (rangeSize * stopLossFactor);
-                    
-                    // Calculate profit target
-                    double profitTarget = entryPrice - (rangeSize * profitFactor);
-                    
-                    // Create position size - risk 1% of account per trade
-                    double accountSize = 10000.0; // Your initial capital
-                    double riskPercent = 0.01;    // 1% risk
-                    double positionSize = calculatePositionSize(accountSize, riskPercent, entryPrice, stopLoss);
-                    
-                    // Create signal
-                    Signal signal;
-                    signal.symbol = symbol;
-                    signal.side = OrderSide::SELL;
-                    signal.suggestedPrice = entryPrice;
-                    signal.suggestedQuantity = positionSize;
-                    signal.timestamp = currentBar.timestamp;
-                    signal.reason = "Volatility Breakout Short";
-                    
-                    // Store trade data
-                    ActiveTrade trade;
-                    trade.symbol = symbol;
-                    trade.entryPrice = entryPrice;
-                    trade.entryTime = currentBar.timestamp;
-                    trade.direction = OrderSide::SELL;
-                    trade.profitTarget = profitTarget;
-                    trade.stopLoss = stopLoss;
-                    trade.quantity = positionSize;
-                    activeTrades[symbol] = trade;
-                    
-                    // Store for legacy code compatibility
-                    profitTargets[symbol] = profitTarget;
-                    stopLosses[symbol] = stopLoss;
-                    positionEntryTimes[symbol] = currentBar.timestamp;
-                    
-                    signals.push_back(signal);
-                    
-                    std::cout << "SHORT signal for " << symbol << " at " << entryPrice 
-                              << " (Target: " << profitTarget << ", Stop: " << stopLoss 
-                              << ", Size: " << positionSize << ")" << std::endl;
-                }
+                signals.push_back(signal);
+                
+                if (verbose) std::cout << "LONG signal for " << symbol << " at " << entryPrice 
+                          << " (Target: " << profitTarget << ", Stop: " << stopLoss 
+                          << ", Size: " << positionSize << ")" << std::endl;
             }
         }
         
-        // Check for exit signals if we have an active trade
-        if (activeTrades.count(symbol) > 0) {
-            const ActiveTrade& trade = activeTrades[symbol];
+        // Short entry
+        if (!day.hasShortSignal && isShortSignal(low, day.lowerBound)) {
+            // Check additional filters
+            bool takeTrade = true;
             
-            // Check for profit target hit
-            if ((trade.direction == OrderSide::BUY && currentBar.high >= trade.profitTarget) ||
-                (trade.direction == OrderSide::SELL && currentBar.low <= trade.profitTarget)) {
-                
-                Signal exitSignal;
-                exitSignal.symbol = symbol;
-                exitSignal.side = (trade.direction == OrderSide::BUY) ? OrderSide::SELL : OrderSide::BUY;
-                exitSignal.suggestedPrice = trade.profitTarget;
-                exitSignal.suggestedQuantity = trade.quantity;
-                exitSignal.timestamp = currentBar.timestamp;
-                exitSignal.reason = "Take Profit";
-                
-                signals.push_back(exitSignal);
-                
-                std::cout << "PROFIT TARGET HIT for " << symbol << " at " << trade.profitTarget << std::endl;
-                
-                // Remove from active trades
-                activeTrades.erase(symbol);
+            // Optional: Add trend filter
+            if (trendFilter) {
+                takeTrade = trendFlags ? (*trendFlags)[index] != 0 : isStrongTrend(recentBars, kTrendLookback);
+            }
+            
+            // Optional: Add range expansion filter
+            if (takeTrade && rangeFilter) {
+                takeTrade = rangeExpansionFlags ? (*rangeExpansionFlags)[index] != 0 : isRangeExpansion(recentBars);
             }
             
-            // Check for stop loss hit
-            else if ((trade.direction == OrderSide::BUY && currentBar.low <= trade.stopLoss) ||
-                     (trade.direction == OrderSide::SELL && currentBar.high >= trade.stopLoss)) {
+            if (takeTrade) {
+                day.hasShortSignal = true;
                 
-                Signal exitSignal;
-                exitSignal.symbol = symbol;
-                exitSignal.side = (trade.direction == OrderSide::BUY) ? OrderSide::SELL : OrderSide::BUY;
-                exitSignal.suggestedPrice = trade.stopLoss;
-                exitSignal.suggestedQuantity = trade.quantity;
-                exitSignal.timestamp = currentBar.timestamp;
-                exitSignal.reason = "Stop Loss";
+                // Calculate entry price (at the breakout level)
+                double entryPrice = day.lowerBound;
+                double rangeSize = day.rangeSize;
                 
-                signals.push_back(exitSignal);
+                // Calculate stop loss
+                double stopLoss = entryPrice + (rangeSize * stopLossFactor);
                 
-                std::cout << "STOP LOSS HIT for " << symbol << " at " << trade.stopLoss << std::endl;
+                // Calculate profit target
+                double profitTarget = entryPrice - (rangeSize * profitFactor);
                 
-                // Remove from active trades
-                activeTrades.erase(symbol);
-            }
-            
-            // Check for time-based exit
-            else if (isPastExitTime(currentBar)) {
-                Signal exitSignal;
-                exitSignal.symbol = symbol;
-                exitSignal.side = (trade.direction == OrderSide::BUY) ? OrderSide::SELL : OrderSide::BUY;
-                exitSignal.suggestedPrice = currentBar.close;
-                exitSignal.suggestedQuantity = trade.quantity;
-                exitSignal.timestamp = currentBar.timestamp;
-                exitSignal.reason = "Time Exit";
+                // Create position size - risk 1% of account per trade
+                double accountSize = 10000.0; // Your initial capital
+                double riskPercent = 0.01;    // 1% risk
+                double positionSize = calculatePositionSize(accountSize, riskPercent, entryPrice, stopLoss);
+                
+                // Create signal
+                Signal signal;
+                signal.symbol = symbol;
+                signal.side = OrderSide::SELL;
+                signal.suggestedPrice = entryPrice;
+                signal.suggestedQuantity = positionSize;
+                signal.timestamp = timestamp;
+                signal.reason = "Volatility Breakout Short";
+                // Resting stop at the breakout level with its bracket
+                signal.orderType = OrderType::STOP;
+                signal.takeProfit = profitTarget;
+                signal.stopLoss = stopLoss;
+                
+                // Store trade data
+                ActiveTrade trade;
+                trade.symbol = symbol;
+                trade.entryPrice = entryPrice;
+                trade.entryTime = timestamp;
+                trade.direction = OrderSide::SELL;
+                trade.profitTarget = profitTarget;
+                trade.stopLoss = stopLoss;
+                trade.quantity = positionSize;
+                activeTrades[symbol] = trade;
                 
-                signals.push_back(exitSignal);
+                // Store for legacy code compatibility
+                profitTargets[symbol] = profitTarget;
+                stopLosses[symbol] = stopLoss;
+                positionEntryTimes[symbol] = timestamp;
                 
-                std::cout << "TIME-BASED EXIT for " << symbol << " at " << currentBar.close << std::endl;
+                signals.push_back(signal);
                 
-                // Remove from active trades
-                activeTrades.erase(symbol);
+                if (verbose) std::cout << "SHORT signal for " << symbol << " at " << entryPrice 
+                          << " (Target: " << profitTarget << ", Stop: " << stopLoss 
+                          << ", Size: " << positionSize << ")" << std::endl;
             }
         }
     }
     
+    // Check for exit signals if we have an active trade
+    if (activeTrades.count(symbol) > 0) {
+        const ActiveTrade& trade = activeTrades[symbol];
+        
+        // Check for profit target hit
+        if ((trade.direction == OrderSide::BUY && high >= trade.profitTarget) ||
+            (trade.direction == OrderSide::SELL && low <= trade.profitTarget)) {
+            
+            Signal exitSignal;
+            exitSignal.symbol = symbol;
+            exitSignal.side = (trade.direction == OrderSide::BUY) ? OrderSide::SELL : OrderSide::BUY;
+            exitSignal.suggestedPrice = trade.profitTarget;
+            exitSignal.suggestedQuantity = trade.quantity;
+            exitSignal.timestamp = timestamp;
+            exitSignal.reason = "Take Profit";
+            exitSignal.orderType = OrderType::LIMIT;
+            exitSignal.closesPosition = true;
+            
+            signals.push_back(exitSignal);
+            
+            if (verbose) std::cout << "PROFIT TARGET HIT for " << symbol << " at " << trade.profitTarget << std::endl;
+            
+            // Remove from active trades
+            activeTrades.erase(symbol);
+        }
+        
+        // Check for stop loss hit
+        else if ((trade.direction == OrderSide::BUY && low <= trade.stopLoss) ||
+                 (trade.direction == OrderSide::SELL && high >= trade.stopLoss)) {
+            
+            Signal exitSignal;
+            exitSignal.symbol = symbol;
+            exitSignal.side = (trade.direction == OrderSide::BUY) ? OrderSide::SELL : OrderSide::BUY;
+            exitSignal.suggestedPrice = trade.stopLoss;
+            exitSignal.suggestedQuantity = trade.quantity;
+            exitSignal.timestamp = timestamp;
+            exitSignal.reason = "Stop Loss";
+            exitSignal.orderType = OrderType::STOP;
+            exitSignal.closesPosition = true;
+            
+            signals.push_back(exitSignal);
+            
+            if (verbose) std::cout << "STOP LOSS HIT for " << symbol << " at " << trade.stopLoss << std::endl;
+            
+            // Remove from active trades
+            activeTrades.erase(symbol);
+        }
+        
+        // Check for time-based exit
+        else if (isPastExitTime(timestamp)) {
+            Signal exitSignal;
+            exitSignal.symbol = symbol;
+            exitSignal.side = (trade.direction == OrderSide::BUY) ? OrderSide::SELL : OrderSide::BUY;
+            exitSignal.suggestedPrice = close;
+            exitSignal.suggestedQuantity = trade.quantity;
+            exitSignal.timestamp = timestamp;
+            exitSignal.reason = "Time Exit";
+            exitSignal.orderType = OrderType::MARKET;
+            exitSignal.closesPosition = true;
+            
+            signals.push_back(exitSignal);
+            
+            if (verbose) std::cout << "TIME-BASED EXIT for " << symbol << " at " << close << std::endl;
+            
+            // Remove from active trades
+            activeTrades.erase(symbol);
+        }
+    }
+    
     return signals;
 }
 
@@ -403,23 +577,12 @@ bool VolatilityBreakout::isNewDay(const OHLCV& current, const OHLCV& previous) c
 }
 
 std::time_t VolatilityBreakout::getStartOfDay(std::time_t timestamp) const {
-    // Convert timestamp to tm struct
-    std::tm* tmTime = std::localtime(&timestamp);
-    
-    // Set time components to midnight (00:00:00)
-    tmTime->tm_hour = 0;
-    tmTime->tm_min = 0;
-    tmTime->tm_sec = 0;
-    
-    // Convert back to time_t
-    return std::mktime(tmTime);
+    // Session start of the calendar day, DST changes included
+    return calendar.startOfDay(timestamp);
 }
 
 std::string VolatilityBreakout::formatTimestamp(std::time_t timestamp) const {
-    char buffer[80];
-    std::tm* timeinfo = std::localtime(&timestamp);
-    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d", timeinfo);
-    return std::string(buffer);
+    return calendar.formatDate(timestamp);
 }
 
 bool VolatilityBreakout::isLongSignal(double price, double upperBound) const {
@@ -430,13 +593,9 @@ bool VolatilityBreakout::isShortSignal(double price, double lowerBound) const {
     return price < lowerBound;
 }
 
-bool VolatilityBreakout::isPastExitTime(const OHLCV& currentBar) const {
-    std::time_t barTime = currentBar.timestamp;
-    std::tm* barTm = std::localtime(&barTime);
-    
+bool VolatilityBreakout::isPastExitTime(std::time_t barTime) const {
     // Check if we're past the exit time
-    return (barTm->tm_hour > exitHour || 
-            (barTm->tm_hour == exitHour && barTm->tm_min >= exitMinute));
+    return calendar.minuteOfDay(barTime) >= exitHour * 60 + exitMinute;
 }
 
 double VolatilityBreakout::calculatePositionSize(double accountBalance, double riskPercent, 
@@ -464,31 +623,26 @@ double VolatilityBreakout::calculatePositionSize(double accountBalance, double r
     return positionSize;
 }
 
-double VolatilityBreakout::calculateATR(const std::vector<OHLCV>& data, int period) const {
-    if (data.size() < period + 1) {
+double VolatilityBreakout::calculateATR(int period) const {
+    // Need period true ranges, i.e. period + 1 bars
+    if (period <= 0 || trueRangeCount < static_cast<size_t>(period)) {
         return 0.0;
     }
     
-    // Calculate initial TR values
-    std::vector<double> trValues;
-    for (size_t i = 1; i < data.size(); i++) {
-        double trueHigh = std::max(data[i].high, data[i-1].close);
-        double trueLow = std::min(data[i].low, data[i-1].close);
-        double tr = trueHigh - trueLow;
-        trValues.push_back(tr);
-    }
-    
-    // Calculate ATR using simple moving average
+    // Calculate ATR using simple moving average, newest true range first
     double sum = 0.0;
-    for (int i = 0; i < period && i < trValues.size(); i++) {
-        sum += trValues[trValues.size() - 1 - i];
+    size_t slot = trueRangeHead;
+    for (int i = 0; i < period; i++) {
+        slot = (slot + trueRanges.size() - 1) % trueRanges.size();
+        sum += trueRanges[slot];
     }
     
-    return sum / std::min(period, static_cast<int>(trValues.size()));
+    return sum / period;
 }
 
-bool VolatilityBreakout::isStrongTrend(const std::vector<OHLCV>& data, size_t index, int lookback) const {
-    if (index < lookback) {
+bool VolatilityBreakout::isStrongTrend(const std::deque<BarStats>& recentBars, int lookback) const {
+    // Compares lookback consecutive pairs before the current bar
+    if (recentBars.size() < static_cast<size_t>(lookback) + 2) {
         return false;
     }
     
@@ -497,18 +651,19 @@ bool VolatilityBreakout::isStrongTrend(const std::vector<OHLCV>& data, size_t in
     
     bool uptrend = true;
     bool downtrend = true;
+    size_t index = recentBars.size() - 1;
     
     for (int i = 1; i <= lookback; i++) {
-        if (data[index - i].high <= data[index - i - 1].high) {
+        if (recentBars[index - i].high <= recentBars[index - i - 1].high) {
             uptrend = false;
         }
-        if (data[index - i].low <= data[index - i - 1].low) {
+        if (recentBars[index - i].low <= recentBars[index - i - 1].low) {
             uptrend = false;
         }
-        if (data[index - i].high >= data[index - i - 1].high) {
+        if (recentBars[index - i].high >= recentBars[index - i - 1].high) {
             downtrend = false;
         }
-        if (data[index - i].low >= data[index - i - 1].low) {
+        if (recentBars[index - i].low >= recentBars[index - i - 1].low) {
             downtrend = false;
         }
     }
@@ -516,43 +671,46 @@ bool VolatilityBreakout::isStrongTrend(const std::vector<OHLCV>& data, size_t in
     return uptrend || downtrend;
 }
 
-bool VolatilityBreakout::isRangeExpansion(const std::vector<OHLCV>& data, size_t index) const {
-    if (index < 5) {
+bool VolatilityBreakout::isRangeExpansion(const std::deque<BarStats>& recentBars) const {
+    if (recentBars.size() < static_cast<size_t>(kRangeWindow) + 1) {
         return false;
     }
+    size_t index = recentBars.size() - 1;
     
     // Calculate the average range of the last 5 bars
     double totalRange = 0.0;
-    for (int i = 1; i <= 5; i++) {
-        totalRange += (data[index - i].high - data[index - i].low);
+    for (int i = 1; i <= kRangeWindow; i++) {
+        totalRange += (recentBars[index - i].high - recentBars[index - i].low);
     }
-    double avgRange = totalRange / 5.0;
+    double avgRange = totalRange / kRangeWindow;
     
     // Check if current bar's range is larger than average
-    double currentRange = data[index].high - data[index].low;
+    double currentRange = recentBars[index].high - recentBars[index].low;
     
-    return currentRange > avgRange * 1.2; // 20% higher than average
+    return currentRange > avgRange * kRangeExpansion; // 20% higher than average
 }
 
-bool VolatilityBreakout::isValidTradingTime(const OHLCV& bar) const {
-    std::time_t barTime = bar.timestamp;
-    std::tm* barTm = std::localtime(&barTime);
+bool VolatilityBreakout::isValidTradingTime(std::time_t barTime) const {
+    if (!skipFirstHour && !avoidLastHalfHour) {
+        return true;
+    }
+    int minute = calendar.minuteOfDay(barTime);
     
     // Skip bars in the first hour of trading (often erratic)
     // This will depend on the market opening time
     // For example, if market opens at 9:30, skip until 10:30
-    if (parameters.count("skipFirstHour") > 0 && parameters.at("skipFirstHour")) {
+    if (skipFirstHour) {
         int marketOpenHour = 9; // Adjust based on your market
-        if (barTm->tm_hour == marketOpenHour) {
+        if (minute / 60 == marketOpenHour) {
             return false;
         }
     }
     
     // Skip bars near market close
     // For example, if market closes at 16:00, skip after 15:30
-    if (parameters.count("avoidLastHalfHour") > 0 && parameters.at("avoidLastHalfHour") > 0.5) {
+    if (avoidLastHalfHour) {
         int marketCloseHour = 16; // Adjust based on your market
-        if (barTm->tm_hour == marketCloseHour - 1 && barTm->tm_min >= 30) {
+        if (minute / 60 == marketCloseHour - 1 && minute % 60 >= 30) {
             return false;
         }
     }
@@ -0,0 +1,238 @@
+#include "walk_forward.h"
+#include <algorithm>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    std::string formatDate(std::time_t time) {
+        std::tm utc;
+#ifdef _WIN32
+        gmtime_s(&utc, &time);
+#else
+        gmtime_r(&time, &utc);
+#endif
+        char buffer[16];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%d", &utc);
+        return buffer;
+    }
+}
+
+WalkForwardOptimizer::WalkForwardOptimizer(size_t threadCount)
+    : indicatorCache(std::make_shared<IndicatorCache>()),
+      pool(std::make_unique<ThreadPool>(threadCount)) {
+}
+
+void WalkForwardOptimizer::setInitialCapital(double capital) {
+    initialCapital = capital;
+}
+
+void WalkForwardOptimizer::setCommissionRate(double rate) {
+    commissionRate = rate;
+}
+
+void WalkForwardOptimizer::setSlippage(double fraction) {
+    slippage = fraction;
+}
+
+void WalkForwardOptimizer::setWindows(size_t inSample, size_t outOfSample) {
+    inSampleBars = inSample;
+    outOfSampleBars = outOfSample;
+}
+
+void WalkForwardOptimizer::setWarmupBars(size_t bars) {
+    warmupBars = bars;
+}
+
+void WalkForwardOptimizer::setIndicatorCache(std::shared_ptr<IndicatorCache> cache) {
+    indicatorCache = std::move(cache);
+}
+
+BarSeriesView WalkForwardOptimizer::windowBars(const BarSeriesView& data, size_t start, size_t end) const {
+    size_t first = start - std::min(warmupBars, start);
+    return data.subview(first, end - first);
+}
+
+BacktestResult WalkForwardOptimizer::runWindow(
+    const Strategy& prototype,
+    const BarSeriesView& bars,
+    size_t warmup,
+    uint64_t datasetId,
+    const std::map<std::string, double>& parameters,
+    bool keepCurve
+) const {
+    std::shared_ptr<Strategy> strategy = prototype.clone();
+    strategy->setVerbose(false);
+    strategy->initialize(parameters);
+    strategy->setIndicatorCache(indicatorCache, datasetId);
+
+    BacktestEngine engine;
+    engine.setVerbose(false);
+    engine.setCommissionRate(commissionRate);
+    engine.setSlippage(slippage);
+    engine.setWarmupBars(warmup);
+    engine.setEquityCurveStep(keepCurve ? 1 : 0);
+    return engine.runBacktest(strategy, bars, initialCapital);
+}
+
+WalkForwardResult WalkForwardOptimizer::run(
+    const Strategy& prototype,
+    const BarSeriesView& data,
+    const std::vector<std::map<std::string, double>>& parameterSets
+) {
+    WalkForwardResult result;
+    result.initialBalance = initialCapital;
+    result.finalBalance = initialCapital;
+    if (inSampleBars == 0 || outOfSampleBars == 0 || parameterSets.empty()) {
+        std::cerr << "Walk-forward needs window sizes and at least one parameter set" << std::endl;
+        return result;
+    }
+
+    // Every window's in-sample jobs are queued up front
+    std::vector<WalkForwardWindow> windows;
+    for (size_t start = 0; start + inSampleBars < data.size(); start += outOfSampleBars) {
+        WalkForwardWindow window;
+        window.inSampleStart = start;
+        window.inSampleEnd = start + inSampleBars;
+        window.outOfSampleEnd = std::min(window.inSampleEnd + outOfSampleBars, data.size());
+        window.outOfSampleStartTime = data.timestamp()[window.inSampleEnd];
+        window.outOfSampleEndTime = data.timestamp()[window.outOfSampleEnd - 1];
+        windows.push_back(std::move(window));
+    }
+    std::vector<std::vector<std::future<BacktestResult>>> inSampleJobs(windows.size());
+    for (size_t w = 0; w < windows.size(); w++) {
+        // Hashed once per window, not per job
+        size_t start = windows[w].inSampleStart;
+        BarSeriesView bars = windowBars(data, start, windows[w].inSampleEnd);
+        size_t warmup = std::min(warmupBars, start);
+        uint64_t datasetId = indicatorCache ? IndicatorCache::datasetId(bars) : 0;
+        for (size_t i = 0; i < parameterSets.size(); i++) {
+            inSampleJobs[w].push_back(pool->submit([this, &prototype, &parameterSets, bars, warmup, datasetId, i]() {
+                return runWindow(prototype, bars, warmup, datasetId, parameterSets[i], false);
+            }));
+        }
+    }
+
+    // Rank each window as its jobs finish and queue its out-of-sample run,
+    // the pool keeps working on later windows meanwhile
+    std::vector<size_t> bestSets(windows.size(), parameterSets.size());
+    std::vector<std::future<BacktestResult>> outOfSampleJobs(windows.size());
+    for (size_t w = 0; w < windows.size(); w++) {
+        std::vector<SweepResult> ranked;
+        for (size_t i = 0; i < parameterSets.size(); i++) {
+            try {
+                ranked.push_back(SweepResult{parameterSets[i], inSampleJobs[w][i].get()});
+            } catch (const std::exception& e) {
+                std::cerr << "Walk-forward window " << w << " set " << i << " failed: " << e.what() << std::endl;
+            }
+        }
+        if (ranked.empty()) {
+            continue;
+        }
+        ParameterSweep::rank(ranked);
+        // Equal sets are interchangeable, any of them will do
+        size_t best = std::find(parameterSets.begin(), parameterSets.end(), ranked.front().parameters)
+            - parameterSets.begin();
+        bestSets[w] = best;
+        windows[w].parameters = parameterSets[best];
+        windows[w].inSample = std::move(ranked.front().result);
+        size_t start = windows[w].inSampleEnd;
+        BarSeriesView bars = windowBars(data, start, windows[w].outOfSampleEnd);
+        size_t warmup = std::min(warmupBars, start);
+        uint64_t datasetId = indicatorCache ? IndicatorCache::datasetId(bars) : 0;
+        outOfSampleJobs[w] = pool->submit([this, &prototype, &parameterSets, bars, warmup, datasetId, best]() {
+            return runWindow(prototype, bars, warmup, datasetId, parameterSets[best], true);
+        });
+    }
+
+    // Stitch the out-of-sample curves, each window compounding on the last.
+    // Curve point 0 of a window is its last seeding bar at the initial
+    // capital, the previous window's last point, so later windows drop it.
+    PerformanceMetrics metrics;
+    metrics.reset(initialCapital);
+    double equity = initialCapital;
+    double inSampleReturns = 0;
+    std::time_t outOfSampleTime = 0;
+    double timeInMarket = 0;
+    for (size_t w = 0; w < windows.size(); w++) {
+        if (bestSets[w] == parameterSets.size()) {
+            continue;
+        }
+        WalkForwardWindow& window = windows[w];
+        try {
+            window.outOfSample = outOfSampleJobs[w].get();
+        } catch (const std::exception& e) {
+            std::cerr << "Walk-forward window " << w << " out-of-sample run failed: " << e.what() << std::endl;
+            continue;
+        }
+        const BacktestResult& outOfSample = window.outOfSample;
+        size_t firstBar = warmupBars > 0 ? window.inSampleEnd - 1 : window.inSampleEnd;
+        double scale = equity / initialCapital;
+        for (size_t k = result.equityCurve.empty() ? 0 : 1; k < outOfSample.equityCurve.size(); k++) {
+            std::time_t time = data.timestamp()[firstBar + k];
+            double value = outOfSample.equityCurve[k] * scale;
+            result.curveTimes.push_back(time);
+            result.equityCurve.push_back(value);
+            metrics.addBar(time, value, false);
+        }
+        equity = outOfSample.finalBalance * scale;
+
+        for (const Trade& trade : outOfSample.trades) {
+            metrics.addTrade(trade);
+        }
+        result.totalTrades += outOfSample.totalTrades;
+        result.winningTrades += outOfSample.winningTrades;
+        result.losingTrades += outOfSample.losingTrades;
+        result.totalFees += outOfSample.totalFees * scale;
+        inSampleReturns += window.inSample.metrics.annualizedReturn;
+        std::time_t span = window.outOfSampleEndTime - window.outOfSampleStartTime;
+        outOfSampleTime += span;
+        timeInMarket += outOfSample.metrics.exposure * span;
+        result.windows.push_back(std::move(window));
+    }
+
+    result.finalBalance = equity;
+    result.totalReturn = ((equity - initialCapital) / initialCapital) * 100.0;
+    result.winRate = result.totalTrades > 0 ? static_cast<double>(result.winningTrades) / result.totalTrades : 0.0;
+    result.metrics = metrics.summary();
+    // The stitched curve has no position flags, weigh the windows' own exposure
+    result.metrics.exposure = outOfSampleTime > 0 ? timeInMarket / outOfSampleTime : 0.0;
+    result.maxDrawdown = result.metrics.maxDrawdown;
+    if (!result.windows.empty() && inSampleReturns > 0) {
+        result.efficiency = result.metrics.annualizedReturn / (inSampleReturns / result.windows.size());
+    }
+    return result;
+}
+
+std::string WalkForwardOptimizer::generateReport(const WalkForwardResult& result, size_t maxWindows) const {
+    std::stringstream ss;
+    ss << "===== WALK-FORWARD RESULTS (" << result.windows.size() << " windows, "
+       << inSampleBars << " in-sample / " << outOfSampleBars << " out-of-sample bars) =====\n\n";
+    ss << std::fixed << std::setprecision(2);
+    ss << "Initial Capital: $" << result.initialBalance << "\n";
+    ss << "Final Capital: $" << result.finalBalance << "\n";
+    ss << "Total Return: " << result.totalReturn << "%\n";
+    ss << "Max Drawdown: " << (result.maxDrawdown * 100.0) << "%\n";
+    ss << "Walk-Forward Efficiency: " << result.efficiency << "\n\n";
+
+    ss << "Total Trades: " << result.totalTrades << "\n";
+    ss << "Win Rate: " << (result.winRate * 100.0) << "%\n";
+    ss << "Fees Paid: $" << result.totalFees << "\n";
+    ss << PerformanceMetrics::format(result.metrics) << "\n";
+
+    for (size_t i = 0; i < result.windows.size() && i < maxWindows; i++) {
+        const WalkForwardWindow& window = result.windows[i];
+        ss << formatDate(window.outOfSampleStartTime) << " - " << formatDate(window.outOfSampleEndTime) << " ";
+        ss << std::defaultfloat << std::setprecision(6);
+        for (const auto& param : window.parameters) {
+            ss << param.first << "=" << param.second << " ";
+        }
+        ss << std::fixed << std::setprecision(2)
+           << "| IS: " << window.inSample.totalReturn << "%"
+           << " | OOS: " << window.outOfSample.totalReturn << "%"
+           << " | Max DD: " << (window.outOfSample.maxDrawdown * 100.0) << "%"
+           << " | Trades: " << window.outOfSample.totalTrades << "\n";
+    }
+    return ss.str();
+}
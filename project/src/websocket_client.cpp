@@ -1,97 +1,83 @@
 #include "websocket_client.h"
+#include "websocket_hub.h"
+#include "market_data_recorder.h"
 #include <libwebsockets.h>
 #include <iostream>
 #include <cstring>
 #include <algorithm>
 
-// Structure to hold per-session data
-struct PerSessionData {
-    WebSocketClient* client;
-    std::string receivedMessage;
-};
+namespace {
+    const size_t kDefaultReceiveQueueCapacity = 4096;
+    // Covers tickers and book deltas, snapshots grow their slot once
+    const size_t kDefaultReceiveBufferSize = 2048;
+    // How long disconnect() waits for the service thread to drop the connection
+    const auto kCloseTimeout = std::chrono::seconds(5);
+}
 
-// Protocols we implement
-struct lws_protocols WebSocketClient::protocols[] = {
-    {
-        "trading-protocol",        // Protocol name
-        WebSocketClient::callbackFunction,  // Callback
-        sizeof(PerSessionData),    // Per-session data size
-        0,                         // Rx buffer size (0 = default)
-    },
-    { NULL, NULL, 0, 0 }  // End of list
-};
-
-WebSocketClient::WebSocketClient() 
-    : context(nullptr), connection(nullptr), running(false), connected(false), sessionData(nullptr) {
+WebSocketClient::WebSocketClient(WebSocketHub* hub)
+    : hub(hub ? hub : &WebSocketHub::instance()), registered(false), port(0), secure(false),
+      connection(nullptr), closeReported(true), pendingFrame(nullptr), droppingFrame(false), recorder(nullptr),
+      running(false), connected(false),
+      connectRequested(false), closeRequested(false), writeRequested(false), detachRequested(false),
+      closed(true),
+      sendHead(0), sendCount(0),
+      receiveQueueCapacity(kDefaultReceiveQueueCapacity), receiveBufferSize(kDefaultReceiveBufferSize),
+      overflowPolicy(OverflowPolicy::PAUSE_READS),
+      receiveSignal(0), readsPaused(false), resumeRequested(false), eventsPending(false),
+      receivedCount(0), deliveredCount(0), droppedCount(0), readPauseCount(0), queueHighWater(0) {
 }
 
 WebSocketClient::~WebSocketClient() {
     disconnect();
-    
-    if (context) {
-        lws_context_destroy(context);
-        context = nullptr;
-    }
 }
-// Add the implementation of the new static method
 
 bool WebSocketClient::initialize() {
-    struct lws_context_creation_info info;
-    memset(&info, 0, sizeof(info));
-    
-    info.port = CONTEXT_PORT_NO_LISTEN;  // Client-only
-    // info.protocols = protocols;
-    info.protocols = protocols; // Use the static method to get protocols
-    info.gid = -1;
-    info.uid = -1;
-    info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
-    
-    // Initialize libwebsockets logs
-    lws_set_log_level(LLL_ERR | LLL_WARN | LLL_NOTICE, NULL);
-    
-    context = lws_create_context(&info);
-    
-    if (!context) {
+    // The context is shared and created with the hub
+    if (!hub->isRunning()) {
         if (errorCallback) {
             errorCallback("Failed to create WebSocket context");
         }
         return false;
     }
-    
     return true;
 }
 
 bool WebSocketClient::connect(const std::string& url) {
-    if (!context) {
+    if (!hub->isRunning()) {
         if (errorCallback) {
             errorCallback("WebSocket context not initialized");
         }
         return false;
     }
-    
+    if (registered) {
+        if (errorCallback) {
+            errorCallback("WebSocket already connected, disconnect first");
+        }
+        return false;
+    }
+
     std::cout << "Connecting to WebSocket: " << url << std::endl;
-    
+
     // Parse URL components
-    std::string protocol, host, path, port;
-    bool secure = false;
-    
+    std::string protocol, portText;
+
     if (url.substr(0, 6) == "wss://") {
         protocol = "wss";
         host = url.substr(6);
         secure = true;
-        port = "443";
+        portText = "443";
     } else if (url.substr(0, 5) == "ws://") {
         protocol = "ws";
         host = url.substr(5);
         secure = false;
-        port = "80";
+        portText = "80";
     } else {
         if (errorCallback) {
             errorCallback("Invalid WebSocket URL: " + url);
         }
         return false;
     }
-    
+
     // Extract path
     size_t pathPos = host.find_first_of('/');
     if (pathPos != std::string::npos) {
@@ -100,110 +86,104 @@ bool WebSocketClient::connect(const std::string& url) {
     } else {
         path = "/";
     }
-    
+
     // Extract port if specified
     size_t portPos = host.find_first_of(':');
     if (portPos != std::string::npos) {
-        port = host.substr(portPos + 1);
+        portText = host.substr(portPos + 1);
         host = host.substr(0, portPos);
     }
-    std::cout << "Protocol: " << protocol << ", Host: " << host 
+    port = std::stoi(portText);
+    std::cout << "Protocol: " << protocol << ", Host: " << host
               << ", Path: " << path << ", Port: " << port << std::endl;
-    // Setup connection info
-    struct lws_client_connect_info ccinfo;
-    memset(&ccinfo, 0, sizeof(ccinfo));
-    ccinfo.context = context;
-    ccinfo.address = host.c_str();
-    ccinfo.port = std::stoi(port);
-    ccinfo.path = path.c_str();
-    
-    // FIX: Use the actual host for SSL verification
-    ccinfo.host = host.c_str();
-    
-    ccinfo.origin = host.c_str();
-    ccinfo.protocol = protocols[0].name;
-    
-    // OPTION 1: Standard SSL verification
-    if (host == "ws.okx.com") {
-        std::cout << "Using OKX-specific SSL settings..." << std::endl;
-        // Use TLS 1.2 minimum, with more permissive settings
-        ccinfo.ssl_connection = LCCSCF_USE_SSL | 
-                               LCCSCF_ALLOW_SELFSIGNED | 
-                               LCCSCF_SKIP_SERVER_CERT_HOSTNAME_CHECK;
-                               
-        // Optionally force TLS 1.2 if needed
-        // This requires libwebsockets to be compiled with correct options
-        // lws_set_ssl_options(wsi, SSL_OP_NO_TLSv1 | SSL_OP_NO_TLSv1_1);
-    } else {
-        // Standard SSL for other exchanges
-        ccinfo.ssl_connection = secure ? LCCSCF_USE_SSL : 0;
-    }
-    
-    // OPTION 2: Disable SSL certificate verification (less secure, use only for testing)
-    // ccinfo.ssl_connection = secure ? (LCCSCF_USE_SSL | LCCSCF_ALLOW_SELFSIGNED | LCCSCF_SKIP_SERVER_CERT_HOSTNAME_CHECK) : 0;
-    
-    // User data to be accessible in the callback
-    if (sessionData == nullptr) {
-        sessionData = new PerSessionData();
-        sessionData->client = this;
-    }
-    ccinfo.userdata = sessionData;
-    // Initiate connection
-    connection = lws_client_connect_via_info(&ccinfo);
-    if (!connection) {
-        if (errorCallback) {
-            errorCallback("Failed to connect to: " + url);
-        }
-        return false;
+
+    // Start the dispatch thread before any frame can arrive
+    receiveQueue = std::make_unique<SpscRing<ReceivedFrame>>(receiveQueueCapacity);
+    receiveQueue->forEachSlot([this](ReceivedFrame& frame) {
+        frame.payload.reserve(receiveBufferSize);
+    });
+    pendingFrame = nullptr;
+    droppingFrame = false;
+    readsPaused = false;
+    resumeRequested = false;
+    closeRequested = false;
+    detachRequested = false;
+    {
+        std::lock_guard<std::mutex> lock(closeMutex);
+        closed = false;
     }
-    // Start event loop in a separate thread
     running = true;
-    eventThread = std::thread(&WebSocketClient::eventLoop, this);
+    dispatchThread = std::thread(&WebSocketClient::dispatchLoop, this);
+
+    // The hub's service thread opens the connection
+    connectRequested = true;
+    hub->addClient(this);
+    registered = true;
+    hub->wake();
     return true;
 }
 
 void WebSocketClient::disconnect() {
-    // Signal the event loop to stop
-    running = false;
-    // Wait for the event thread to finish
-    if (eventThread.joinable()) {
-        eventThread.join();
+    if (dispatchThread.joinable() && std::this_thread::get_id() == dispatchThread.get_id()) {
+        // Joining ourselves would hang, the caller has to disconnect from another thread
+        std::cerr << "WebSocket disconnect from its own callback ignored" << std::endl;
+        return;
     }
-    // Clean up connection
-    connection = nullptr;
-    connected = false;
-    
-    // Clean up session data
-    if (sessionData) {
-        delete sessionData;
-        sessionData = nullptr;
+
+    if (registered) {
+        // Ask the service thread to close and wait until lws is done with us
+        closeRequested = true;
+        hub->wake();
+        {
+            std::unique_lock<std::mutex> lock(closeMutex);
+            if (!closeCondition.wait_for(lock, kCloseTimeout, [this]() { return closed; })) {
+                // lws would still call back into this client once it is gone,
+                // the service thread has to detach the connection first
+                std::cerr << "WebSocket close timed out, dropping the connection" << std::endl;
+                detachRequested = true;
+                hub->wake();
+                closeCondition.wait(lock, [this]() { return closed; });
+            }
+        }
+        hub->removeClient(this);
+        registered = false;
     }
-    
-    // Notify about disconnection
-    if (connectionCallback) {
-        connectionCallback(false);
+
+    stopDispatch();
+    if (dispatchLatency.count() > 0) {
+        std::cout << "WebSocket tick-to-callback latency: " << dispatchLatency.summary() << std::endl;
     }
 }
 
-bool WebSocketClient::send(const std::string& message) {
-    if (!connected || !connection) {
+bool WebSocketClient::send(std::string_view message) {
+    if (!connected) {
         if (errorCallback) {
             errorCallback("Cannot send message: not connected");
         }
         return false;
     }
-    
+
     std::cout << "Sending WebSocket message: " << message << std::endl;
-    
-    // Add message to send queue
+
+    // Copy into the next free send buffer behind the LWS_PRE padding
     {
         std::lock_guard<std::mutex> lock(sendMutex);
-        sendQueue.push(message);
+        if (sendCount == sendBuffers.size()) {
+            // All in use, grow the ring with the queued messages first
+            std::rotate(sendBuffers.begin(), sendBuffers.begin() + sendHead, sendBuffers.end());
+            sendHead = 0;
+            sendBuffers.emplace_back();
+        }
+        std::vector<unsigned char>& buffer = sendBuffers[(sendHead + sendCount) % sendBuffers.size()];
+        buffer.resize(LWS_PRE + message.size());
+        memcpy(buffer.data() + LWS_PRE, message.data(), message.size());
+        sendCount++;
     }
-    
-    // Request a callback when the socket is writeable
-    lws_callback_on_writable(connection);
-    
+
+    // Only the service thread may ask for a writeable callback, wake it to do so
+    writeRequested = true;
+    hub->wake();
+
     return true;
 }
 
@@ -223,127 +203,329 @@ void WebSocketClient::setErrorCallback(ErrorCallback callback) {
     errorCallback = callback;
 }
 
-void WebSocketClient::onMessage(const std::string& message) {
-    //std::cout << "WebSocket received: " << message << std::endl;
-    if (messageCallback) {
-        messageCallback(message);
+void WebSocketClient::setReceiveQueueCapacity(size_t frames) {
+    receiveQueueCapacity = std::max<size_t>(frames, 2);
+}
+
+void WebSocketClient::setReceiveBufferSize(size_t bytes) {
+    receiveBufferSize = bytes;
+}
+
+void WebSocketClient::setOverflowPolicy(OverflowPolicy policy) {
+    overflowPolicy = policy;
+}
+
+void WebSocketClient::setRecorder(RecorderStream* stream) {
+    recorder = stream;
+}
+
+WebSocketStats WebSocketClient::getStats() const {
+    WebSocketStats stats;
+    stats.received = receivedCount.load(std::memory_order_relaxed);
+    stats.delivered = deliveredCount.load(std::memory_order_relaxed);
+    stats.dropped = droppedCount.load(std::memory_order_relaxed);
+    stats.readPauses = readPauseCount.load(std::memory_order_relaxed);
+    stats.highWater = queueHighWater.load(std::memory_order_relaxed);
+    if (receiveQueue) {
+        stats.queued = receiveQueue->size();
+        stats.capacity = receiveQueue->capacity();
     }
+    return stats;
+}
+
+const LatencyHistogram& WebSocketClient::getLatencyHistogram() const {
+    return dispatchLatency;
 }
 
 bool WebSocketClient::getConnectionStatus() const {
     return connected;
 }
 
-void WebSocketClient::setConnectionStatus(bool status) {
-    connected = status;
-    if (connectionCallback) {
-        connectionCallback(status);
+void WebSocketClient::serviceRequests(lws_context* context) {
+    if (connectRequested.exchange(false)) {
+        openConnection(context);
+    }
+    if (detachRequested.exchange(false)) {
+        if (connection) {
+            // Later callbacks of the connection get no client, it dies on its own
+            lws_set_wsi_user(connection, nullptr);
+            lws_set_timeout(connection, PENDING_TIMEOUT_USER_OK, LWS_TO_KILL_ASYNC);
+        }
+        onDestroyed();
+        return;
+    }
+    if (!connection) {
+        return;
+    }
+
+    if (closeRequested) {
+        if (connected) {
+            // Sends a close frame from the writeable callback
+            lws_callback_on_writable(connection);
+        } else {
+            // Still handshaking, nothing to say goodbye to
+            lws_set_timeout(connection, PENDING_TIMEOUT_USER_OK, LWS_TO_KILL_ASYNC);
+        }
+        return;
+    }
+    if (resumeRequested.exchange(false) && readsPaused) {
+        readsPaused = false;
+        lws_rx_flow_control(connection, 1);
+    }
+    if (writeRequested.exchange(false)) {
+        lws_callback_on_writable(connection);
+    }
+}
+
+void WebSocketClient::openConnection(lws_context* context) {
+    // Setup connection info
+    struct lws_client_connect_info ccinfo;
+    memset(&ccinfo, 0, sizeof(ccinfo));
+    ccinfo.context = context;
+    ccinfo.address = host.c_str();
+    ccinfo.port = port;
+    ccinfo.path = path.c_str();
+
+    // FIX: Use the actual host for SSL verification
+    ccinfo.host = host.c_str();
+
+    ccinfo.origin = host.c_str();
+    ccinfo.protocol = "trading-protocol";
+
+    // OPTION 1: Standard SSL verification
+    if (host == "ws.okx.com") {
+        std::cout << "Using OKX-specific SSL settings..." << std::endl;
+        // Use TLS 1.2 minimum, with more permissive settings
+        ccinfo.ssl_connection = LCCSCF_USE_SSL |
+                               LCCSCF_ALLOW_SELFSIGNED |
+                               LCCSCF_SKIP_SERVER_CERT_HOSTNAME_CHECK;
+    } else {
+        // Standard SSL for other exchanges
+        ccinfo.ssl_connection = secure ? LCCSCF_USE_SSL : 0;
+    }
+
+    // Every callback of this connection gets the client as user data
+    ccinfo.userdata = this;
+    // Set before any callback runs, cleared again if the connection fails
+    ccinfo.pwsi = &connection;
+    closeReported = false;
+
+    if (!lws_client_connect_via_info(&ccinfo)) {
+        connection = nullptr;
+        if (!closeReported) {
+            onClosed("Failed to connect to: " + host);
+        }
+        onDestroyed();
+    }
+}
+
+void WebSocketClient::onEstablished() {
+    std::cout << "WebSocket connection established" << std::endl;
+    connected = true;
+    pushEvent({true, ""});
+
+    // Anything queued while connecting
+    std::lock_guard<std::mutex> lock(sendMutex);
+    if (sendCount > 0 && connection) {
+        lws_callback_on_writable(connection);
+    }
+}
+
+void WebSocketClient::onReceive(struct lws* wsi, const void* in, size_t len) {
+    // Every frame, single fragment or not, is copied once into its queue
+    // slot: lws reuses `in` as soon as we return and the callback runs later
+    // on the dispatch thread. Slots keep their capacity, so the copy does
+    // not allocate. First fragment: claim the next slot and reassemble into it.
+    if (!pendingFrame && !droppingFrame) {
+        pendingFrame = receiveQueue ? receiveQueue->producerSlot() : nullptr;
+        if (pendingFrame) {
+            pendingFrame->receivedAt = std::chrono::steady_clock::now();
+            pendingFrame->payload.clear();
+        } else {
+            droppingFrame = true;
+        }
+    }
+    if (pendingFrame) {
+        pendingFrame->payload.append(static_cast<const char*>(in), len);
+    }
+
+    // If this is the final fragment
+    if (lws_is_final_fragment(wsi)) {
+        onMessage();
     }
 }
 
-void WebSocketClient::eventLoop() {
-    int n = 0;
-    while (running && n >= 0) {
-        n = lws_service(context, 50); // 50ms timeout
-        // Small sleep to prevent high CPU usage
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+int WebSocketClient::onWriteable(struct lws* wsi) {
+    if (closeRequested) {
+        lws_close_reason(wsi, LWS_CLOSE_STATUS_NORMAL, nullptr, 0);
+        return -1;
+    }
+
+    // Take the oldest message, its buffer goes back to the ring in exchange
+    bool more = false;
+    {
+        std::lock_guard<std::mutex> lock(sendMutex);
+        if (sendCount == 0) {
+            return 0;
+        }
+        writeBuffer.swap(sendBuffers[sendHead]);
+        sendHead = (sendHead + 1) % sendBuffers.size();
+        sendCount--;
+        more = sendCount > 0;
+    }
+
+    // Written in place, the LWS_PRE padding is already in front
+    size_t length = writeBuffer.size() - LWS_PRE;
+    int result = lws_write(wsi, writeBuffer.data() + LWS_PRE, length, LWS_WRITE_TEXT);
+    if (result < 0) {
+        onClosed("Error writing to WebSocket");
+        return -1;
+    }
+
+    // If more messages, request another callback
+    if (more) {
+        lws_callback_on_writable(wsi);
     }
+    return 0;
 }
 
-int WebSocketClient::callbackFunction(struct lws* wsi, enum lws_callback_reasons reason,
-                                     void* user, void* in, size_t len) {
-    PerSessionData* data = static_cast<PerSessionData*>(user);
-    WebSocketClient* client = nullptr;
-    if (data) {
-        client = data->client;
-    }
-    switch (reason) {
-        case LWS_CALLBACK_CLIENT_ESTABLISHED:
-            // Connection established
-            if (client) {
-                std::cout << "WebSocket connection established" << std::endl;
-                client->setConnectionStatus(true);
+void WebSocketClient::onClosed(const std::string& error) {
+    // Connection errors and closes can both be reported for one connection
+    if (closeReported) {
+        return;
+    }
+    closeReported = true;
+    connected = false;
+    pushEvent({false, error});
+}
+
+void WebSocketClient::onDestroyed() {
+    connection = nullptr;
+    connected = false;
+    // A frame cut off by the close is never published
+    pendingFrame = nullptr;
+    droppingFrame = false;
+    {
+        std::lock_guard<std::mutex> lock(closeMutex);
+        closed = true;
+    }
+    closeCondition.notify_all();
+}
+
+void WebSocketClient::pushEvent(ConnectionEvent event) {
+    {
+        std::lock_guard<std::mutex> lock(eventMutex);
+        events.push_back(std::move(event));
+    }
+    eventsPending.store(true, std::memory_order_release);
+    receiveSignal.fetch_add(1, std::memory_order_release);
+    receiveSignal.notify_one();
+}
+
+void WebSocketClient::onMessage() {
+    // Service thread: never waits for the dispatch thread
+    receivedCount.fetch_add(1, std::memory_order_relaxed);
+    if (droppingFrame || !pendingFrame) {
+        droppingFrame = false;
+        uint64_t dropped = droppedCount.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (dropped == 1 || dropped % 1000 == 0) {
+            std::cerr << "WebSocket receive queue full, " << dropped << " frames dropped" << std::endl;
+        }
+        return;
+    }
+    ReceivedFrame* frame = pendingFrame;
+    pendingFrame = nullptr;
+    receiveQueue->commitPush();
+
+    // The dispatch thread only reads the slot and it is not reused before
+    // this thread's next frame, so the recorder can copy it after publishing
+    if (recorder) {
+        recorder->record(frame->payload);
+    }
+
+    size_t queued = receiveQueue->size();
+    if (queued > queueHighWater.load(std::memory_order_relaxed)) {
+        queueHighWater.store(queued, std::memory_order_relaxed);
+    }
+    receiveSignal.fetch_add(1, std::memory_order_release);
+    receiveSignal.notify_one();
+
+    // Stop reading at 3/4 full; the dispatch thread asks for a resume at 1/4
+    if (overflowPolicy == OverflowPolicy::PAUSE_READS && connection && !readsPaused
+        && queued >= receiveQueue->capacity() / 4 * 3) {
+        readsPaused = true;
+        readPauseCount.fetch_add(1, std::memory_order_relaxed);
+        lws_rx_flow_control(connection, 0);
+        // The queue may have drained before the dispatch thread saw the flag
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (receiveQueue->size() <= receiveQueue->capacity() / 4) {
+            readsPaused = false;
+            lws_rx_flow_control(connection, 1);
+        }
+    }
+}
+
+void WebSocketClient::dispatchLoop() {
+    std::deque<ConnectionEvent> pendingEvents;
+    while (true) {
+        uint32_t signal = receiveSignal.load(std::memory_order_acquire);
+
+        // Connection changes first, so a connect is seen before its frames
+        if (eventsPending.exchange(false, std::memory_order_acquire)) {
+            {
+                std::lock_guard<std::mutex> lock(eventMutex);
+                pendingEvents.swap(events);
             }
-            break;
-        case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
-            // Connection error
-            if (client) {
-                client->setConnectionStatus(false);
-                const char* msg = in ? static_cast<const char*>(in) : "Unknown connection error";
-                std::cerr << "WebSocket connection error: " << (in ? msg : "Unknown error") << std::endl;
-                
-                if (client->errorCallback) {
-                    client->errorCallback(in ? msg : "Unknown connection error");
+            for (const ConnectionEvent& event : pendingEvents) {
+                if (connectionCallback) {
+                    connectionCallback(event.connected);
                 }
-            }
-            break;
-            
-        case LWS_CALLBACK_CLIENT_RECEIVE:
-            // Data received
-            if (client && in && len > 0) {
-                // Append to buffer
-                data->receivedMessage.append(static_cast<const char*>(in), len);
-                
-                // If this is the final fragment
-                if (lws_is_final_fragment(wsi)) {
-                    client->onMessage(data->receivedMessage);
-                    data->receivedMessage.clear();
+                if (!event.error.empty() && errorCallback) {
+                    errorCallback(event.error);
                 }
             }
-            break;
-            
-        case LWS_CALLBACK_CLIENT_WRITEABLE:
-            // Socket is writeable, send queued messages
-            if (client) {
-                std::string message;
-                
-                // Get a message from the queue
-                {
-                    std::lock_guard<std::mutex> lock(client->sendMutex);
-                    if (!client->sendQueue.empty()) {
-                        message = client->sendQueue.front();
-                        client->sendQueue.pop();
-                    }
-                }
-                
-                if (!message.empty()) {
-                    // LWS_PRE bytes of padding are needed
-                    unsigned char* buf = new unsigned char[LWS_PRE + message.length()];
-                    memcpy(&buf[LWS_PRE], message.c_str(), message.length());
-                    
-                    // Write the message
-                    int result = lws_write(wsi, &buf[LWS_PRE], message.length(), LWS_WRITE_TEXT);
-                    
-                    delete[] buf;
-                    
-                    if (result < 0) {
-                        if (client->errorCallback) {
-                            client->errorCallback("Error writing to WebSocket");
-                        }
-                        return -1;
-                    }
-                    
-                    // If more messages, request another callback
-                    {
-                        std::lock_guard<std::mutex> lock(client->sendMutex);
-                        if (!client->sendQueue.empty()) {
-                            lws_callback_on_writable(wsi);
-                        }
-                    }
-                }
+            pendingEvents.clear();
+            continue;
+        }
+
+        // Read in place, the slot goes back to the ring after the callback
+        ReceivedFrame* frame = receiveQueue->consumerSlot();
+        if (!frame) {
+            if (!running) {
+                break;
             }
-            break;
-            
-        case LWS_CALLBACK_CLIENT_CLOSED:
-            // Connection closed
-            if (client) {
-                std::cout << "WebSocket connection closed" << std::endl;
-                client->setConnectionStatus(false);
+            // Sleeps until the service thread or disconnect bumps the signal
+            receiveSignal.wait(signal, std::memory_order_acquire);
+            continue;
+        }
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (readsPaused && receiveQueue->size() <= receiveQueue->capacity() / 4
+            && !resumeRequested.exchange(true)) {
+            // Flow control may only be changed on the service thread
+            hub->wake();
+        }
+
+        deliveredCount.fetch_add(1, std::memory_order_relaxed);
+        dispatchLatency.record(std::chrono::steady_clock::now() - frame->receivedAt);
+        if (messageCallback) {
+            try {
+                messageCallback(frame->payload);
+            } catch (const std::exception& e) {
+                std::cerr << "WebSocket message callback failed: " << e.what() << std::endl;
             }
-            break;
-            
-        default:
-            break;
+        }
+        receiveQueue->commitPop();
     }
-    return 0;
-}
\ No newline at end of file
+}
+
+void WebSocketClient::stopDispatch() {
+    if (!dispatchThread.joinable()) {
+        return;
+    }
+    // Nothing is pushed any more, let the dispatch thread drain and exit
+    running = false;
+    receiveSignal.fetch_add(1, std::memory_order_release);
+    receiveSignal.notify_one();
+    dispatchThread.join();
+}
@@ -0,0 +1,164 @@
+#include "websocket_hub.h"
+#include "websocket_client.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// Protocols we implement
+struct lws_protocols WebSocketHub::protocols[] = {
+    {
+        "trading-protocol",        // Protocol name
+        WebSocketHub::callbackFunction,  // Callback
+        0,                         // Per-session data, each connection passes its client
+        0,                         // Rx buffer size (0 = default)
+    },
+    { NULL, NULL, 0, 0 }  // End of list
+};
+
+WebSocketHub::WebSocketHub()
+    : context(nullptr), running(false) {
+    struct lws_context_creation_info info;
+    memset(&info, 0, sizeof(info));
+
+    info.port = CONTEXT_PORT_NO_LISTEN;  // Client-only
+    info.protocols = protocols;
+    info.gid = -1;
+    info.uid = -1;
+    info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
+    // Lets callbacks without a connection (service cancellation) find the hub
+    info.user = this;
+
+    // Initialize libwebsockets logs
+    lws_set_log_level(LLL_ERR | LLL_WARN | LLL_NOTICE, NULL);
+
+    context = lws_create_context(&info);
+    if (!context) {
+        std::cerr << "Failed to create WebSocket context" << std::endl;
+        return;
+    }
+
+    running = true;
+    serviceThread = std::thread(&WebSocketHub::serviceLoop, this);
+}
+
+WebSocketHub::~WebSocketHub() {
+    running = false;
+    if (context) {
+        lws_cancel_service(context);
+    }
+    if (serviceThread.joinable()) {
+        serviceThread.join();
+    }
+    if (context) {
+        lws_context_destroy(context);
+        context = nullptr;
+    }
+}
+
+WebSocketHub& WebSocketHub::instance() {
+    static WebSocketHub hub;
+    return hub;
+}
+
+bool WebSocketHub::isRunning() const {
+    return running;
+}
+
+void WebSocketHub::addClient(WebSocketClient* client) {
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    clients.push_back(client);
+}
+
+void WebSocketHub::removeClient(WebSocketClient* client) {
+    // Waits for a running serviceRequests() pass to finish
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    clients.erase(std::remove(clients.begin(), clients.end(), client), clients.end());
+}
+
+size_t WebSocketHub::clientCount() const {
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    return clients.size();
+}
+
+void WebSocketHub::wake() {
+    if (context) {
+        lws_cancel_service(context);
+    }
+}
+
+void WebSocketHub::serviceLoop() {
+    // lws_service sleeps in poll() until a socket is ready, a timer is due or
+    // lws_cancel_service() wakes it
+    while (running) {
+        if (lws_service(context, 0) < 0) {
+            break;
+        }
+    }
+}
+
+void WebSocketHub::serviceRequests() {
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    for (WebSocketClient* client : clients) {
+        client->serviceRequests(context);
+    }
+}
+
+int WebSocketHub::callbackFunction(struct lws* wsi, enum lws_callback_reasons reason,
+                                   void* user, void* in, size_t len) {
+    // Connections carry their client as user data
+    WebSocketClient* client = static_cast<WebSocketClient*>(user);
+    switch (reason) {
+        case LWS_CALLBACK_EVENT_WAIT_CANCELLED: {
+            // Woken by wake(), not tied to a connection
+            WebSocketHub* hub = static_cast<WebSocketHub*>(lws_context_user(lws_get_context(wsi)));
+            if (hub) {
+                hub->serviceRequests();
+            }
+            break;
+        }
+
+        case LWS_CALLBACK_CLIENT_ESTABLISHED:
+            if (client) {
+                client->onEstablished();
+            }
+            break;
+
+        case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
+            if (client) {
+                const char* msg = in ? static_cast<const char*>(in) : "Unknown connection error";
+                std::cerr << "WebSocket connection error: " << msg << std::endl;
+                client->onClosed(msg);
+            }
+            break;
+
+        case LWS_CALLBACK_CLIENT_RECEIVE:
+            if (client && in && len > 0) {
+                client->onReceive(wsi, in, len);
+            }
+            break;
+
+        case LWS_CALLBACK_CLIENT_WRITEABLE:
+            if (client) {
+                return client->onWriteable(wsi);
+            }
+            break;
+
+        case LWS_CALLBACK_CLIENT_CLOSED:
+            if (client) {
+                std::cout << "WebSocket connection closed" << std::endl;
+                client->onClosed("");
+            }
+            break;
+
+        case LWS_CALLBACK_WSI_DESTROY:
+            // Last callback for a connection, its client may go away after this
+            if (client) {
+                client->onDestroyed();
+            }
+            break;
+
+        default:
+            break;
+    }
+    return 0;
+}